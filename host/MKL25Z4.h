@@ -0,0 +1,150 @@
+/*
+ * MKL25Z4.h
+ *
+ * Created on: 17-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef MKL25Z4_H_
+#define MKL25Z4_H_
+
+/*
+ * Host stand-in for the device header of the KL25Z, found before the CMSIS one by the host build
+ * (-Ihost). It declares the peripherals the I2C and MMA8451 drivers use with the same names and
+ * field masks, as plain structures in memory held by board_model.c. I2C0 and I2C1 are register
+ * models of i2c_model.h, reached through the macros of source/i2c_regs.h, and the core functions
+ * of CMSIS (NVIC, PRIMASK) are implemented by board_model.c, which runs the interrupt handlers.
+ * Only what the drivers touch is declared; the other drivers of the board do not build here.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include "i2c_model.h"
+
+//MACROS
+#define I2C_HOST_MODEL (1)			//I2C_Type is the register model, see i2c_regs.h
+
+/* public types*/
+
+typedef enum
+{
+	SysTick_IRQn = -1,
+	DMA0_IRQn = 0,
+	I2C0_IRQn = 8,
+	I2C1_IRQn = 9,
+	PORTA_IRQn = 30
+} IRQn_Type;
+
+typedef i2c_model_t I2C_Type;
+
+typedef struct
+{
+	uint32_t SCGC4;
+	uint32_t SCGC5;
+	uint32_t SCGC6;
+	uint32_t SCGC7;
+} SIM_Type;
+
+typedef struct
+{
+	uint32_t PCR[32];
+	uint32_t ISFR;				//Written by the handlers as on the chip (write 1 to clear)
+} PORT_Type;
+
+typedef struct
+{
+	uint32_t PDOR;
+	uint32_t PSOR;				//Set and clear take effect at the next timebase_now
+	uint32_t PCOR;
+	uint32_t PTOR;
+	uint32_t PDIR;				//Pin levels as of the last timebase_now
+	uint32_t PDDR;
+} GPIO_Type;
+
+typedef struct
+{
+	struct
+	{
+		uint32_t SAR;
+		uint32_t DAR;
+		uint32_t DSR_BCR;
+		uint32_t DCR;
+	} DMA[4];
+} DMA_Type;
+
+typedef struct
+{
+	uint8_t CHCFG[4];
+} DMAMUX_Type;
+
+typedef struct
+{
+	uint32_t CTRL;
+	uint32_t LOAD;
+	uint32_t VAL;
+	uint32_t CALIB;
+} SysTick_Type;
+
+//Peripherals, defined in board_model.c
+extern I2C_Type host_i2c0, host_i2c1;
+extern SIM_Type host_sim;
+extern PORT_Type host_porta, host_porte;
+extern GPIO_Type host_pta, host_pte;
+extern DMA_Type host_dma0;
+extern DMAMUX_Type host_dmamux0;
+extern SysTick_Type host_systick;
+
+#define I2C0 (&host_i2c0)
+#define I2C1 (&host_i2c1)
+#define SIM (&host_sim)
+#define PORTA (&host_porta)
+#define PORTE (&host_porte)
+#define PTA (&host_pta)
+#define PTE (&host_pte)
+#define DMA0 (&host_dma0)
+#define DMAMUX0 (&host_dmamux0)
+#define SysTick (&host_systick)
+
+//Register fields, values of the device header
+#define I2C_F_MULT(x) ((uint8_t)((x) << I2C_F_MULT_SHIFT) & I2C_F_MULT_MASK)
+#define I2C_F_ICR(x) ((uint8_t)(x) & I2C_F_ICR_MASK)
+#define I2C_C2_HDRS_MASK (0x20)
+#define SIM_SCGC4_I2C0_MASK (0x40u)
+#define SIM_SCGC4_I2C1_MASK (0x80u)
+#define SIM_SCGC5_PORTA_MASK (0x200u)
+#define SIM_SCGC5_PORTE_MASK (0x2000u)
+#define SIM_SCGC6_DMAMUX_MASK (0x2u)
+#define SIM_SCGC7_DMA_MASK (0x100u)
+#define PORT_PCR_MUX_MASK (0x700u)
+#define PORT_PCR_MUX_SHIFT (8)
+#define PORT_PCR_MUX(x) (((uint32_t)(x) << PORT_PCR_MUX_SHIFT) & PORT_PCR_MUX_MASK)
+#define PORT_PCR_IRQC_MASK (0xF0000u)
+#define PORT_PCR_IRQC_SHIFT (16)
+#define PORT_PCR_IRQC(x) (((uint32_t)(x) << PORT_PCR_IRQC_SHIFT) & PORT_PCR_IRQC_MASK)
+#define PORT_PCR_ISF_MASK (0x1000000u)
+#define DMA_DSR_BCR_BCR(x) ((uint32_t)(x) & 0xFFFFFFu)
+#define DMA_DSR_BCR_DONE_MASK (0x1000000u)
+#define DMA_DCR_D_REQ_MASK (0x800000u)
+#define DMA_DCR_DSIZE(x) (((uint32_t)(x) << 17) & 0x60000u)
+#define DMA_DCR_DINC_MASK (0x80000u)
+#define DMA_DCR_SSIZE(x) (((uint32_t)(x) << 20) & 0x300000u)
+#define DMA_DCR_CS_MASK (0x20000000u)
+#define DMA_DCR_ERQ_MASK (0x40000000u)
+#define DMA_DCR_EINT_MASK (0x80000000u)
+#define DMAMUX_CHCFG_SOURCE(x) ((uint8_t)(x) & 0x3Fu)
+#define DMAMUX_CHCFG_ENBL_MASK (0x80u)
+#define SysTick_CTRL_ENABLE_Msk (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk (1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk (1UL << 2)
+
+//Core functions of CMSIS, see board_model.c
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+
+#endif /* MKL25Z4_H_ */
@@ -0,0 +1,36 @@
+/*
+ * arm_math.h
+ *
+ * Created on: 17-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef ARM_MATH_H_
+#define ARM_MATH_H_
+
+/*
+ * Host stand-in for the CMSIS-DSP header: the fixed point types and the saturation the filters
+ * of the source folder use, with the semantics of the library.
+ */
+
+//INCLUDES
+#include <stdint.h>
+
+/* public types*/
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int64_t q63_t;
+
+/*
+ * @Name		clip_q31_to_q15
+ * @Description	Saturates a q31 value to the q15 range
+ *
+ * @parameters	q31_t - value
+ * @Returns		q15_t - value clipped to INT16_MIN..INT16_MAX
+ */
+static inline q15_t clip_q31_to_q15(q31_t x)
+{
+	return ((q31_t)(x >> 15) != ((q31_t)x >> 31)) ? (q15_t)(0x7FFF ^ ((q15_t)(x >> 31))) : (q15_t)x;
+}
+
+#endif /* ARM_MATH_H_ */
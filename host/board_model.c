@@ -0,0 +1,366 @@
+/**
+ * @file    board_model.c
+ * @brief   Host board for the unmodified I2C and MMA8451 drivers: peripherals, timebase, NVIC
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Reference Cortex-M0+ generic user guide (NVIC, PRIMASK, SysTick), KL25Z reference manual
+ * @Date	05/17/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "board_model.h"
+#include "timebase.h"
+
+//MACROS
+#define SCL_PIN (24)					//PTE24 and PTE25 carry I2C0
+#define SDA_PIN (25)
+#define INT1_PIN (14)					//PTA14 is INT1 of the accelerometer
+#define MASK(x) (1UL << (x))
+#define GPIO_MUX (1)
+#define IRQC_FALLING (0xA)
+#define NVIC_IRQS (32)
+#define THREAD_PRIORITY (4)				//Below the lowest of the 2-bit priorities
+#define TICKS_PER_US (TIMEBASE_HZ / 1000000U)
+
+//Interrupt handlers of the drivers
+void I2C0_IRQHandler(void);
+void I2C1_IRQHandler(void);
+void PORTA_IRQHandler(void);
+void SysTick_Handler(void);
+
+//Exceptions served by the board, in order of the vector table
+typedef enum
+{
+	SRC_SYSTICK,
+	SRC_I2C0,
+	SRC_I2C1,
+	SRC_PORTA,
+	SRC_COUNT
+} source_t;
+
+//Core state and the pieces of the peripherals the registers do not hold
+typedef struct
+{
+	bool primask;
+	bool enabled[NVIC_IRQS];
+	uint8_t priority[NVIC_IRQS];
+	uint8_t systick_priority;
+	uint8_t running;					//Priority of the handler running, THREAD_PRIORITY if none
+	bool systick_running;
+	bool systick_pending;
+	uint64_t systick_next;				//Bus cycle of the next SysTick wrap
+	uint32_t porta_flags;				//Interrupt flags of port A, ISFR while a handler runs
+	bool int1;							//INT1 asserted at the last look
+	bool scl_high;						//SCL level at the last look
+} board_t;
+
+I2C_Type host_i2c0, host_i2c1;
+SIM_Type host_sim;
+PORT_Type host_porta, host_porte;
+GPIO_Type host_pta, host_pte;
+DMA_Type host_dma0;
+DMAMUX_Type host_dmamux0;
+SysTick_Type host_systick;
+mma_model_t host_mma;
+
+static board_t board;
+
+static const IRQn_Type source_irq[SRC_COUNT] = {SysTick_IRQn, I2C0_IRQn, I2C1_IRQn, PORTA_IRQn};
+static void (*const source_handler[SRC_COUNT])(void) = {
+		SysTick_Handler, I2C0_IRQHandler, I2C1_IRQHandler, PORTA_IRQHandler
+};
+
+/*
+ * @Name		pin_gpio
+ * @Description	Tells whether a pin of a port is muxed to GPIO
+ *
+ * @parameters	const PORT_Type*, uint32_t - the port, pin number
+ * @Returns		bool - true for the GPIO alternative
+ */
+static bool pin_gpio(const PORT_Type *port, uint32_t pin)
+{
+	return ((port->PCR[pin] & PORT_PCR_MUX_MASK) >> PORT_PCR_MUX_SHIFT) == GPIO_MUX;
+}
+
+/*
+ * @Name		gpio_update
+ * @Description	Applies the set, clear and toggle writes of a port to its output register
+ *
+ * @parameters	GPIO_Type* - the port
+ * @Returns		none
+ */
+static void gpio_update(GPIO_Type *gpio)
+{
+	gpio->PDOR = ((gpio->PDOR | gpio->PSOR) & ~gpio->PCOR) ^ gpio->PTOR;
+	gpio->PSOR = gpio->PCOR = gpio->PTOR = 0;
+}
+
+/*
+ * @Name		line_high
+ * @Description	Level driven by the KL25Z on an open drain line of port E: high unless the pin
+ * 				is a GPIO output driving a 0
+ *
+ * @parameters	uint32_t - pin number
+ * @Returns		bool - true for a high line
+ */
+static bool line_high(uint32_t pin)
+{
+	return !(pin_gpio(&host_porte, pin) && (host_pte.PDDR & MASK(pin)) && !(host_pte.PDOR & MASK(pin)));
+}
+
+/*
+ * @Name		board_sync
+ * @Description	Brings the peripherals up to the clock of I2C0: I2C1 and the accelerometer run
+ * 				to the same time, the pins and the interrupt flags of port A follow, SysTick counts
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void board_sync(void)
+{
+	uint64_t now = host_i2c0.now;
+	uint64_t period;
+	uint32_t irqc;
+	bool int1, scl_high, sda_high;
+
+	if(host_i2c1.now < now)
+		i2c_model_idle(&host_i2c1, (uint32_t)(now - host_i2c1.now));
+	mma_model_run(&host_mma, now / TICKS_PER_US);
+
+	gpio_update(&host_pte);
+	gpio_update(&host_pta);
+	scl_high = line_high(SCL_PIN);
+	sda_high = line_high(SDA_PIN) && !i2c_model_sda_held(&host_i2c0);
+	host_pte.PDIR = (scl_high ? MASK(SCL_PIN) : 0) | (sda_high ? MASK(SDA_PIN) : 0);
+
+	//A slave holding SDA counts the pulses of the bus recovery
+	if(scl_high && !board.scl_high && pin_gpio(&host_porte, SCL_PIN))
+		i2c_model_scl_clock(&host_i2c0);
+	board.scl_high = scl_high;
+
+	//ISF is write 1 to clear in the PCR as well, the driver writes it when it configures the pin
+	if(host_porta.PCR[INT1_PIN] & PORT_PCR_ISF_MASK)
+	{
+		host_porta.PCR[INT1_PIN] &= ~PORT_PCR_ISF_MASK;
+		board.porta_flags &= ~MASK(INT1_PIN);
+	}
+	int1 = mma_model_int1(&host_mma);
+	irqc = (host_porta.PCR[INT1_PIN] & PORT_PCR_IRQC_MASK) >> PORT_PCR_IRQC_SHIFT;
+	if(int1 && !board.int1 && irqc == IRQC_FALLING && pin_gpio(&host_porta, INT1_PIN))
+		board.porta_flags |= MASK(INT1_PIN);
+	board.int1 = int1;
+	host_pta.PDIR = int1 ? 0 : MASK(INT1_PIN);
+
+	//SysTick counts the core clock, twice the bus clock
+	if(!(host_systick.CTRL & SysTick_CTRL_ENABLE_Msk))
+	{
+		board.systick_running = false;
+		return;
+	}
+	period = (host_systick.LOAD + 1) / TIMEBASE_CYCLES_PER_TICK;
+	if(!board.systick_running)
+	{
+		board.systick_running = true;
+		board.systick_next = now + period;
+	}
+	while(now >= board.systick_next)
+	{
+		board.systick_pending = true;
+		board.systick_next += period;
+	}
+}
+
+/*
+ * @Name		source_priority
+ * @Description	Priority of an exception, the NVIC priority of the interrupts or SysTick's own
+ *
+ * @parameters	source_t - the exception
+ * @Returns		uint8_t - priority, 0 the highest
+ */
+static uint8_t source_priority(source_t src)
+{
+	return (src == SRC_SYSTICK) ? board.systick_priority : board.priority[source_irq[src]];
+}
+
+/*
+ * @Name		source_pending
+ * @Description	Tells whether an exception is requested and enabled
+ *
+ * @parameters	source_t - the exception
+ * @Returns		bool - true if it would be taken with PRIMASK clear
+ */
+static bool source_pending(source_t src)
+{
+	switch(src)
+	{
+	case SRC_SYSTICK:
+		return board.systick_pending && (host_systick.CTRL & SysTick_CTRL_TICKINT_Msk);
+	case SRC_I2C0:
+		return board.enabled[I2C0_IRQn] && i2c_model_irq_pending(&host_i2c0);
+	case SRC_I2C1:
+		return board.enabled[I2C1_IRQn] && i2c_model_irq_pending(&host_i2c1);
+	case SRC_PORTA:
+		return board.enabled[PORTA_IRQn] && board.porta_flags;
+	default:
+		return false;
+	}
+}
+
+/*
+ * @Name		dispatch
+ * @Description	Runs the handlers of the pending exceptions that preempt the code running, the
+ * 				highest priority first (the lowest vector on a tie). A handler may be preempted
+ * 				in turn at its own timebase_now calls
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void dispatch(void)
+{
+	uint8_t saved;
+	int best;
+
+	while(!board.primask)
+	{
+		best = -1;
+		for(int src = 0; src < SRC_COUNT; src++)
+		{
+			if(source_pending(src) && source_priority(src) < board.running &&
+					(best < 0 || source_priority(src) < source_priority(best)))
+				best = src;
+		}
+		if(best < 0)
+			return;
+
+		saved = board.running;
+		board.running = source_priority(best);
+		if(best == SRC_SYSTICK)
+			board.systick_pending = false;
+		if(best == SRC_PORTA)
+			host_porta.ISFR = board.porta_flags;
+		source_handler[best]();
+		if(best == SRC_PORTA)
+		{
+			board.porta_flags &= ~host_porta.ISFR;
+			host_porta.ISFR = board.porta_flags;
+		}
+		board.running = saved;
+	}
+}
+
+/*
+ * See documentation in .h file
+ */
+void board_model_init(void)
+{
+	i2c_model_slave_t slave;
+
+	mma_model_init(&host_mma);
+	slave = mma_model_slave(&host_mma);
+	i2c_model_init(&host_i2c0, TIMEBASE_HZ, &slave);
+	i2c_model_init(&host_i2c1, TIMEBASE_HZ, NULL);
+	memset(&host_sim, 0, sizeof(host_sim));
+	memset(&host_porta, 0, sizeof(host_porta));
+	memset(&host_porte, 0, sizeof(host_porte));
+	memset(&host_pta, 0, sizeof(host_pta));
+	memset(&host_pte, 0, sizeof(host_pte));
+	memset(&host_dma0, 0, sizeof(host_dma0));
+	memset(&host_dmamux0, 0, sizeof(host_dmamux0));
+	memset(&host_systick, 0, sizeof(host_systick));
+	memset(&board, 0, sizeof(board));
+	board.running = THREAD_PRIORITY;
+	board.scl_high = true;
+	board_sync();
+}
+
+/*
+ * See documentation in .h file
+ */
+void board_model_idle(uint32_t us)
+{
+	uint64_t end = host_i2c0.now + (uint64_t)us * TICKS_PER_US;
+
+	while(host_i2c0.now < end)
+	{
+		i2c_model_idle(&host_i2c0, TICKS_PER_US);
+		board_sync();
+		dispatch();
+	}
+}
+
+/*
+ * See documentation in .h file
+ */
+uint64_t board_model_us(void)
+{
+	return host_i2c0.now / TICKS_PER_US;
+}
+
+/*
+ * The PIT timebase, see timebase.h. Reading the counter is where the polling loops of the
+ * drivers spend their time, so the board runs here
+ */
+void init_timebase()
+{
+}
+
+uint32_t timebase_now()
+{
+	i2c_model_idle(&host_i2c0, BOARD_POLL_CYCLES);
+	board_sync();
+	dispatch();
+	return (uint32_t)host_i2c0.now;
+}
+
+/*
+ * Core functions of CMSIS, see MKL25Z4.h
+ */
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+	board.enabled[irq] = true;
+	dispatch();
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+	board.enabled[irq] = false;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+	//The modelled sources are levels, a pending request is only the flag of the peripheral
+	(void)irq;
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority)
+{
+	if(irq == SysTick_IRQn)
+		board.systick_priority = priority;
+	else
+		board.priority[irq] = priority;
+}
+
+void __disable_irq(void)
+{
+	board.primask = true;
+}
+
+void __enable_irq(void)
+{
+	board.primask = false;
+	dispatch();
+}
+
+uint32_t __get_PRIMASK(void)
+{
+	return board.primask;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+	board.primask = primask & 1;
+	dispatch();
+}
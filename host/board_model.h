@@ -0,0 +1,66 @@
+/*
+ * board_model.h
+ *
+ * Created on: 17-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef BOARD_MODEL_H_
+#define BOARD_MODEL_H_
+
+/*
+ * The FRDM-KL25Z as the host build sees it: I2C0 with the MMA8451Q model on PTE24/PTE25, I2C1
+ * with an empty bus, INT1 of the accelerometer on PTA14, the PIT timebase, SysTick and the NVIC.
+ * Time is the clock of the I2C0 model, in bus cycles (the timebase ticks): a timebase_now costs
+ * BOARD_POLL_CYCLES, so the waiting loops of the drivers let the bus and the accelerometer run.
+ * At every timebase_now and whenever PRIMASK is cleared or an interrupt enabled, the handlers of
+ * the drivers whose source is pending and enabled run, by priority and nesting as on the core.
+ * SCL and SDA taken over as GPIO follow PDDR and PDOR (open drain with pull-ups), SDA also reads
+ * low while a slave of i2c_model_hold_sda holds it and SCL pulses reach it. DMA transfers
+ * are not emulated, the DMA0 interrupt never comes.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "MKL25Z4.h"
+#include "i2c_model.h"
+#include "mma8451_model.h"
+
+//MACROS
+#define BOARD_POLL_CYCLES (8)			//Bus cycles of a timebase_now in a polling loop
+
+//Accelerometer on I2C0
+extern mma_model_t host_mma;
+
+/*
+ * @Name		board_model_init
+ * @Description	Powers the board up: peripherals at their reset values, the accelerometer in its
+ * 				power on state on I2C0, the interrupts disabled with PRIMASK clear and the clock
+ * 				at 0
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void board_model_init(void);
+
+/*
+ * @Name		board_model_idle
+ * @Description	The core waits for a while outside the drivers, the interrupts being served as
+ * 				their sources come
+ *
+ * @parameters	uint32_t - time to wait in us
+ * @Returns		none
+ */
+void board_model_idle(uint32_t us);
+
+/*
+ * @Name		board_model_us
+ * @Description	Time since board_model_init
+ *
+ * @parameters	none
+ * @Returns		uint64_t - time in us
+ */
+uint64_t board_model_us(void);
+
+#endif /* BOARD_MODEL_H_ */
@@ -0,0 +1,438 @@
+/**
+ * @file    i2c_model.c
+ * @brief   Host model of the I2C0 register semantics in master mode
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Reference KL25Z reference manual, chapter 38 Inter-Integrated Circuit (I2C)
+ * @Date	05/17/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "i2c_model.h"
+#include "i2c_divider.h"
+
+//MACROS
+#define MULT_MAX (2)			//MULT 3 is reserved, taken as a multiplier of 4
+#define US_PER_S (1000000U)
+#define BUS_RELEASED (0xFF)		//Data clocked in with no slave driving SDA
+#define READ_BIT (0x1)
+
+/*
+ * @Name		byte_cycles
+ * @Description	Bus cycles of a byte and its acknowledge at the SCL rate programmed in F
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		uint32_t - duration of a byte in bus cycles
+ */
+static uint32_t byte_cycles(i2c_model_t *model)
+{
+	uint8_t f = model->reg[I2C_MODEL_F];
+	uint8_t mult = (f & I2C_F_MULT_MASK) >> I2C_F_MULT_SHIFT;
+
+	if(mult > MULT_MAX)
+		mult = MULT_MAX;
+	return I2C_MODEL_BYTE_BITS * (1U << mult) * i2c_scl_divider[f & I2C_F_ICR_MASK];
+}
+
+/*
+ * @Name		bus_stop
+ * @Description	STOP condition: the bus is released and the slave returns to idle
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		none
+ */
+static void bus_stop(i2c_model_t *model)
+{
+	model->reg[I2C_MODEL_S] &= ~I2C_S_BUSY_MASK;
+	model->stop_pending = false;
+	model->address_next = false;
+	model->slave_reads = false;
+	model->slave_writes = false;
+	model->counts.stops++;
+	if(model->slave.stop)
+		model->slave.stop(model->slave.ctx);
+}
+
+/*
+ * @Name		byte_start
+ * @Description	Starts clocking a byte: TCF drops until the byte and its acknowledge are done
+ *
+ * @parameters	i2c_model_t* - the model
+ * 				bool, uint8_t - true to receive, byte to transmit otherwise
+ * @Returns		none
+ */
+static void byte_start(i2c_model_t *model, bool receive, uint8_t byte)
+{
+	model->in_flight = true;
+	model->receiving = receive;
+	model->tx_byte = byte;
+	model->done_at = model->now + byte_cycles(model);
+	model->reg[I2C_MODEL_S] &= ~I2C_S_TCF_MASK;
+	if(model->stall)
+	{
+		model->stall = false;
+		model->done_at = UINT64_MAX;
+		model->counts.faults++;
+	}
+}
+
+/*
+ * @Name		byte_complete
+ * @Description	Ends the byte on the bus: hands it to or takes it from the slave, latches the
+ * 				acknowledge in RXAK, sets TCF and IICIF and generates a STOP requested meanwhile
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		none
+ */
+static void byte_complete(i2c_model_t *model)
+{
+	uint8_t *status = &model->reg[I2C_MODEL_S];
+	bool ack;
+
+	model->in_flight = false;
+	model->counts.bytes++;
+
+	if(!model->receiving && model->lose_arbitration)
+	{
+		//Another master won the bus, the module leaves master mode without a STOP. The
+		//transfer of the winner is taken to end with this byte, so BUSY drops as well
+		model->lose_arbitration = false;
+		model->reg[I2C_MODEL_C1] &= ~I2C_C1_MST_MASK;
+		*status &= ~I2C_S_BUSY_MASK;
+		*status |= I2C_S_ARBL_MASK | I2C_S_IICIF_MASK | I2C_S_TCF_MASK;
+		model->address_next = false;
+		model->stop_pending = false;
+		model->slave_reads = false;
+		model->slave_writes = false;
+		return;
+	}
+
+	if(model->receiving)
+	{
+		model->reg[I2C_MODEL_D] = model->slave_reads ? model->slave.read(model->slave.ctx) : BUS_RELEASED;
+		//TXAK is sampled on the ninth clock, a NACK ends the transmission of the slave
+		ack = !(model->reg[I2C_MODEL_C1] & I2C_C1_TXAK_MASK);
+		if(!ack)
+			model->slave_reads = false;
+	}
+	else if(model->address_next)
+	{
+		model->address_next = false;
+		ack = model->slave.address && model->slave.address(model->slave.ctx, model->tx_byte);
+		model->slave_reads = ack && (model->tx_byte & READ_BIT);
+		model->slave_writes = ack && !(model->tx_byte & READ_BIT);
+	}
+	else
+	{
+		ack = model->slave_writes && model->slave.write(model->slave.ctx, model->tx_byte);
+	}
+
+	if(ack)
+		*status &= ~I2C_S_RXAK_MASK;
+	else
+		*status |= I2C_S_RXAK_MASK;
+	*status |= I2C_S_TCF_MASK;
+	if(model->drop_irq)
+	{
+		model->drop_irq = false;
+		model->counts.faults++;
+	}
+	else
+	{
+		*status |= I2C_S_IICIF_MASK;
+	}
+
+	if(model->stop_pending)
+		bus_stop(model);
+}
+
+/*
+ * @Name		advance
+ * @Description	Runs the clock and completes the byte on the bus once its time has come
+ *
+ * @parameters	i2c_model_t*, uint32_t - the model, bus cycles
+ * @Returns		none
+ */
+static void advance(i2c_model_t *model, uint32_t cycles)
+{
+	model->now += cycles;
+	if(model->in_flight && model->now >= model->done_at)
+		byte_complete(model);
+}
+
+/*
+ * @Name		module_disable
+ * @Description	Clearing IICEN resets the module logic: a byte on the bus is abandoned, the bus
+ * 				is let go and S returns to its reset value
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		none
+ */
+static void module_disable(i2c_model_t *model)
+{
+	bool owned = model->reg[I2C_MODEL_S] & I2C_S_BUSY_MASK;
+
+	model->in_flight = false;
+	model->lose_arbitration = false;
+	if(owned)
+		bus_stop(model);
+	model->reg[I2C_MODEL_S] = I2C_S_TCF_MASK;
+}
+
+/*
+ * @Name		control_write
+ * @Description	Applies a write of C1: enabling or disabling the module, START on MST 0 -> 1,
+ * 				STOP on MST 1 -> 0 (after the byte on the bus, if any) and repeated START on RSTA.
+ * 				RSTA is not generated while MULT is non zero, as on the chip (errata e6070)
+ *
+ * @parameters	i2c_model_t*, uint8_t - the model, value written
+ * @Returns		none
+ */
+static void control_write(i2c_model_t *model, uint8_t value)
+{
+	uint8_t old = model->reg[I2C_MODEL_C1];
+
+	//RSTA is write only and always reads 0
+	model->reg[I2C_MODEL_C1] = value & ~I2C_C1_RSTA_MASK;
+
+	if(!(value & I2C_C1_IICEN_MASK))
+	{
+		if(old & I2C_C1_IICEN_MASK)
+			module_disable(model);
+		return;
+	}
+
+	if((value & I2C_C1_MST_MASK) && !(old & I2C_C1_MST_MASK) && model->sda_hold)
+	{
+		//SDA does not follow the START, the module takes it for another master
+		model->reg[I2C_MODEL_C1] &= ~I2C_C1_MST_MASK;
+		model->reg[I2C_MODEL_S] |= I2C_S_ARBL_MASK | I2C_S_IICIF_MASK;
+		model->counts.faults++;
+	}
+	else if((value & I2C_C1_MST_MASK) && !(old & I2C_C1_MST_MASK))
+	{
+		model->reg[I2C_MODEL_S] |= I2C_S_BUSY_MASK;
+		model->address_next = true;
+		model->counts.starts++;
+	}
+	else if(!(value & I2C_C1_MST_MASK) && (old & I2C_C1_MST_MASK))
+	{
+		if(model->in_flight)
+			model->stop_pending = true;
+		else
+			bus_stop(model);
+	}
+
+	if(value & I2C_C1_RSTA_MASK)
+	{
+		if(!(old & I2C_C1_MST_MASK) || !(value & I2C_C1_MST_MASK) || model->in_flight)
+		{
+			model->counts.misuse++;
+		}
+		else if(model->reg[I2C_MODEL_F] & I2C_F_MULT_MASK)
+		{
+			model->counts.rsta_lost++;
+		}
+		else
+		{
+			//The slave sees a new address phase, its register pointer is kept
+			model->address_next = true;
+			model->slave_reads = false;
+			model->slave_writes = false;
+			model->counts.starts++;
+		}
+	}
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_init(i2c_model_t *model, uint32_t bus_hz, const i2c_model_slave_t *slave)
+{
+	memset(model, 0, sizeof(*model));
+	model->reg[I2C_MODEL_S] = I2C_S_TCF_MASK;
+	model->bus_hz = bus_hz;
+	if(slave)
+		model->slave = *slave;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint8_t i2c_model_read(i2c_model_t *model, i2c_model_reg_t reg)
+{
+	uint8_t c1, value;
+
+	advance(model, I2C_MODEL_ACCESS_CYCLES);
+	model->counts.reads[reg]++;
+	value = model->reg[reg];
+	if(reg == I2C_MODEL_S && model->sda_hold)
+		value |= I2C_S_BUSY_MASK;
+
+	//In master receive mode the read of D releases SCL and clocks in the next byte
+	c1 = model->reg[I2C_MODEL_C1];
+	if(reg == I2C_MODEL_D && (c1 & I2C_C1_IICEN_MASK) && (c1 & I2C_C1_MST_MASK) &&
+			!(c1 & I2C_C1_TX_MASK))
+	{
+		if(model->in_flight)
+			model->counts.misuse++;
+		else
+			byte_start(model, true, 0);
+	}
+	return value;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_write(i2c_model_t *model, i2c_model_reg_t reg, uint8_t value)
+{
+	uint8_t c1;
+
+	advance(model, I2C_MODEL_ACCESS_CYCLES);
+	model->counts.writes[reg]++;
+
+	switch(reg)
+	{
+	case I2C_MODEL_F:
+	case I2C_MODEL_C2:
+		model->reg[reg] = value;
+		break;
+
+	case I2C_MODEL_C1:
+		control_write(model, value);
+		break;
+
+	case I2C_MODEL_S:
+		model->reg[I2C_MODEL_S] &= ~(value & (I2C_S_IICIF_MASK | I2C_S_ARBL_MASK));
+		break;
+
+	case I2C_MODEL_D:
+		model->reg[I2C_MODEL_D] = value;
+		c1 = model->reg[I2C_MODEL_C1];
+		if(!(c1 & I2C_C1_IICEN_MASK) || !(c1 & I2C_C1_MST_MASK) || !(c1 & I2C_C1_TX_MASK) ||
+				model->in_flight)
+			model->counts.misuse++;
+		else
+			byte_start(model, false, value);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_model_wait(i2c_model_t *model)
+{
+	//A stalled byte never completes, the caller sees no interrupt
+	if(model->in_flight && model->done_at != UINT64_MAX)
+		advance(model, (uint32_t)(model->done_at - model->now));
+	return i2c_model_irq_pending(model);
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_idle(i2c_model_t *model, uint32_t cycles)
+{
+	advance(model, cycles);
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_model_irq_pending(i2c_model_t *model)
+{
+	return (model->reg[I2C_MODEL_C1] & I2C_C1_IICIE_MASK) && (model->reg[I2C_MODEL_S] & I2C_S_IICIF_MASK);
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_lose_arbitration(i2c_model_t *model)
+{
+	model->lose_arbitration = true;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_drop_irq(i2c_model_t *model)
+{
+	model->drop_irq = true;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_stall(i2c_model_t *model)
+{
+	model->stall = true;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_hold_sda(i2c_model_t *model, uint32_t clocks)
+{
+	model->sda_hold = clocks;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_scl_clock(i2c_model_t *model)
+{
+	if(model->sda_hold)
+		model->sda_hold--;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_model_sda_held(i2c_model_t *model)
+{
+	return model->sda_hold != 0;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t i2c_model_scl_hz(i2c_model_t *model)
+{
+	return model->bus_hz * I2C_MODEL_BYTE_BITS / byte_cycles(model);
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t i2c_model_elapsed_us(i2c_model_t *model, uint64_t since)
+{
+	return (uint32_t)((model->now - since) * US_PER_S / model->bus_hz);
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t i2c_model_accesses(const i2c_model_counts_t *counts)
+{
+	uint32_t total = 0;
+
+	for(int i = 0; i < I2C_MODEL_REGS; i++)
+		total += counts->reads[i] + counts->writes[i];
+	return total;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_model_counts_reset(i2c_model_t *model)
+{
+	memset(&model->counts, 0, sizeof(model->counts));
+}
@@ -0,0 +1,271 @@
+/*
+ * i2c_model.h
+ *
+ * Created on: 17-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef I2C_MODEL_H_
+#define I2C_MODEL_H_
+
+/*
+ * Register level model of the KL25Z I2C modules in master mode for a Linux host. It holds F,
+ * C1, S, D and C2 as plain bytes and applies the side effects of the chip on every access: a
+ * write of D in transmit mode starts a byte, a read of D in receive mode returns the received
+ * byte and starts the next one, MST 0 -> 1 and 1 -> 0 generate START and STOP, RSTA a repeated
+ * START, and a completed byte sets TCF and IICIF and latches RXAK. Time is counted in bus clock
+ * cycles: every access costs I2C_MODEL_ACCESS_CYCLES and a byte takes 9 SCL periods, with the
+ * SCL divider taken from F through the table of i2c_divider.h, so polling loops run for as long
+ * as on the board. The model counts the reads and writes of every register so the cost of a
+ * driver sequence can be compared between revisions. Faults can be injected for the error paths
+ * of the drivers: lost arbitration, a lost interrupt, a byte that never completes and a slave
+ * holding SDA low until it is clocked out. It never touches memory mapped hardware and builds
+ * on a host only; the board build does not compile this folder. The MKL25Z4.h of this folder
+ * makes it the I2C_Type of the drivers, see source/i2c_regs.h.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+
+//MACROS
+#define I2C_MODEL_ACCESS_CYCLES (2)		//Bus cycles of a peripheral access from the core
+#define I2C_MODEL_BYTE_BITS (9)			//8 data bits and the acknowledge
+
+//Register fields, same values as MKL25Z4.h so driver sequences read alike
+#define I2C_C1_DMAEN_MASK (0x01)
+#define I2C_C1_WUEN_MASK (0x02)
+#define I2C_C1_RSTA_MASK (0x04)
+#define I2C_C1_TXAK_MASK (0x08)
+#define I2C_C1_TX_MASK (0x10)
+#define I2C_C1_MST_MASK (0x20)
+#define I2C_C1_IICIE_MASK (0x40)
+#define I2C_C1_IICEN_MASK (0x80)
+#define I2C_S_RXAK_MASK (0x01)
+#define I2C_S_IICIF_MASK (0x02)
+#define I2C_S_SRW_MASK (0x04)
+#define I2C_S_RAM_MASK (0x08)
+#define I2C_S_ARBL_MASK (0x10)
+#define I2C_S_BUSY_MASK (0x20)
+#define I2C_S_IAAS_MASK (0x40)
+#define I2C_S_TCF_MASK (0x80)
+#define I2C_F_ICR_MASK (0x3F)
+#define I2C_F_MULT_MASK (0xC0)
+#define I2C_F_MULT_SHIFT (6)
+
+/* public types*/
+
+//Registers of the module held by the model
+typedef enum
+{
+	I2C_MODEL_F = 0,
+	I2C_MODEL_C1,
+	I2C_MODEL_S,
+	I2C_MODEL_D,
+	I2C_MODEL_C2,
+	I2C_MODEL_REGS
+} i2c_model_reg_t;
+
+//Slave device on the bus, called by the model when a byte completes
+typedef struct
+{
+	void *ctx;
+	bool (*address)(void *ctx, uint8_t addr);	//Address byte after a START or repeated START, true to ACK
+	bool (*write)(void *ctx, uint8_t byte);		//Data byte from the master, true to ACK
+	uint8_t (*read)(void *ctx);					//Data byte to the master
+	void (*stop)(void *ctx);					//STOP condition
+} i2c_model_slave_t;
+
+//Register accesses and bus events since the last i2c_model_counts_reset
+typedef struct
+{
+	uint32_t reads[I2C_MODEL_REGS];
+	uint32_t writes[I2C_MODEL_REGS];
+	uint32_t bytes;					//Bytes clocked over the bus, address bytes included
+	uint32_t starts;				//START and repeated START conditions
+	uint32_t stops;
+	uint32_t misuse;				//Accesses the chip would not honour, see i2c_model_write
+	uint32_t rsta_lost;				//Repeated STARTs dropped because MULT was set (errata e6070)
+	uint32_t faults;				//Injected faults that took effect
+} i2c_model_counts_t;
+
+//State of the modelled module
+typedef struct
+{
+	uint8_t reg[I2C_MODEL_REGS];	//F, C1, S and C2 as read back, D is the receive latch
+	uint64_t now;					//Bus cycles since i2c_model_init
+	uint64_t done_at;				//Completion of the byte on the bus
+	bool in_flight;					//A byte is being clocked
+	bool receiving;					//The byte on the bus is clocked in from the slave
+	bool address_next;				//The next transmitted byte follows a START
+	bool stop_pending;				//MST was cleared during a byte, STOP after it
+	bool slave_writes;				//The slave acknowledged its address for a write
+	bool slave_reads;				//The slave was addressed for a read and has not been NACKed
+	bool lose_arbitration;			//The next transmitted byte loses arbitration
+	bool drop_irq;					//The next completed byte does not set IICIF
+	bool stall;						//The next byte never completes
+	uint32_t sda_hold;				//SCL pulses a slave still needs to let go of SDA
+	uint8_t tx_byte;				//Byte on the bus when transmitting
+	uint32_t bus_hz;				//Bus clock, only used to report times
+	i2c_model_slave_t slave;
+	i2c_model_counts_t counts;
+} i2c_model_t;
+
+/*
+ * @Name		i2c_model_init
+ * @Description	Puts the module in its reset state (all registers 0 except TCF) with the slave
+ * 				connected and clears the clock and the counters
+ *
+ * @parameters	i2c_model_t* - the model
+ * 				uint32_t - bus clock feeding the module in Hz
+ * 				const i2c_model_slave_t* - device on the bus, NULL for an empty bus
+ * @Returns		none
+ */
+void i2c_model_init(i2c_model_t *model, uint32_t bus_hz, const i2c_model_slave_t *slave);
+
+/*
+ * @Name		i2c_model_read
+ * @Description	Reads a register as the core would, after the clock has advanced by one access.
+ * 				Reading D in receive mode while master starts the reception of the next byte
+ *
+ * @parameters	i2c_model_t*, i2c_model_reg_t - the model, register to read
+ * @Returns		uint8_t - register value
+ */
+uint8_t i2c_model_read(i2c_model_t *model, i2c_model_reg_t reg);
+
+/*
+ * @Name		i2c_model_write
+ * @Description	Writes a register as the core would, after the clock has advanced by one access.
+ * 				S is write 1 to clear for IICIF and ARBL. Writes the chip would not honour (D while
+ * 				a byte is on the bus or outside master transmit mode, RSTA outside master mode) are
+ * 				dropped and counted in misuse
+ *
+ * @parameters	i2c_model_t*, i2c_model_reg_t, uint8_t - the model, register and value
+ * @Returns		none
+ */
+void i2c_model_write(i2c_model_t *model, i2c_model_reg_t reg, uint8_t value);
+
+/*
+ * @Name		i2c_model_wait
+ * @Description	Lets the clock run, without register accesses, until the byte on the bus has
+ * 				completed. Stands in for the core sleeping until the module interrupt
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		bool - true if the module interrupt is pending (IICIE and IICIF set)
+ */
+bool i2c_model_wait(i2c_model_t *model);
+
+/*
+ * @Name		i2c_model_idle
+ * @Description	Lets the clock run for a number of bus cycles without register accesses, the
+ * 				core being busy elsewhere. A byte whose time has come completes
+ *
+ * @parameters	i2c_model_t*, uint32_t - the model, bus cycles
+ * @Returns		none
+ */
+void i2c_model_idle(i2c_model_t *model, uint32_t cycles);
+
+/*
+ * @Name		i2c_model_irq_pending
+ * @Description	Tells whether the module requests its interrupt, without advancing the clock
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		bool - true if IICIE and IICIF are set
+ */
+bool i2c_model_irq_pending(i2c_model_t *model);
+
+/*
+ * @Name		i2c_model_lose_arbitration
+ * @Description	Makes the next transmitted byte lose arbitration to another master: ARBL and IICIF
+ * 				are set and the module drops out of master mode
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		none
+ */
+void i2c_model_lose_arbitration(i2c_model_t *model);
+
+/*
+ * @Name		i2c_model_drop_irq
+ * @Description	Lost interrupt: the next byte completes and sets TCF, but IICIF stays clear
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		none
+ */
+void i2c_model_drop_irq(i2c_model_t *model);
+
+/*
+ * @Name		i2c_model_stall
+ * @Description	Timeout: the next byte never completes, a slave holding SCL low, until the
+ * 				module is disabled
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		none
+ */
+void i2c_model_stall(i2c_model_t *model);
+
+/*
+ * @Name		i2c_model_hold_sda
+ * @Description	Stuck bus: a slave holds SDA low, as after a reset of the master in the middle of
+ * 				a read, until it has been clocked the given number of SCL pulses through
+ * 				i2c_model_scl_clock. Meanwhile S reads BUSY and a START loses arbitration
+ *
+ * @parameters	i2c_model_t*, uint32_t - the model, SCL pulses needed, 0 to release SDA
+ * @Returns		none
+ */
+void i2c_model_hold_sda(i2c_model_t *model, uint32_t clocks);
+
+/*
+ * @Name		i2c_model_scl_clock
+ * @Description	One SCL pulse generated outside the module (the pins driven as GPIO)
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		none
+ */
+void i2c_model_scl_clock(i2c_model_t *model);
+
+/*
+ * @Name		i2c_model_sda_held
+ * @Description	Tells whether a slave holds SDA low
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		bool - true while SDA is held
+ */
+bool i2c_model_sda_held(i2c_model_t *model);
+
+/*
+ * @Name		i2c_model_scl_hz
+ * @Description	SCL rate programmed in F, from the divider table of i2c_divider.h
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		uint32_t - SCL rate in Hz
+ */
+uint32_t i2c_model_scl_hz(i2c_model_t *model);
+
+/*
+ * @Name		i2c_model_elapsed_us
+ * @Description	Time modelled since a clock value, in microseconds of the bus clock
+ *
+ * @parameters	i2c_model_t*, uint64_t - the model, earlier value of model->now
+ * @Returns		uint32_t - elapsed time in us
+ */
+uint32_t i2c_model_elapsed_us(i2c_model_t *model, uint64_t since);
+
+/*
+ * @Name		i2c_model_accesses
+ * @Description	Total register reads and writes in the counters
+ *
+ * @parameters	const i2c_model_counts_t* - counters
+ * @Returns		uint32_t - number of accesses
+ */
+uint32_t i2c_model_accesses(const i2c_model_counts_t *counts);
+
+/*
+ * @Name		i2c_model_counts_reset
+ * @Description	Clears the access and bus event counters, the registers and the clock are kept
+ *
+ * @parameters	i2c_model_t* - the model
+ * @Returns		none
+ */
+void i2c_model_counts_reset(i2c_model_t *model);
+
+#endif /* I2C_MODEL_H_ */
@@ -0,0 +1,519 @@
+/**
+ * @file    mma8451_model.c
+ * @brief   Host model of the MMA8451Q register map behind the I2C0 model
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Reference MMA8451Q data sheet, register descriptions and auto-increment address table
+ * @Date	05/17/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "mma8451_model.h"
+
+//MACROS
+#define ADDR_MASK (0xFE)
+#define READ_BIT (0x1)
+#define REG_STATUS (0x00)
+#define REG_OUT_X_MSB (0x01)
+#define REG_OUT_Y_MSB (0x03)
+#define REG_OUT_Z_MSB (0x05)
+#define REG_OUT_Z_LSB (0x06)
+#define REG_RESERVED_LAST (0x08)		//Two reserved registers follow the outputs
+#define REG_F_SETUP (0x09)
+#define REG_SYSMOD (0x0B)
+#define REG_INT_SOURCE (0x0C)
+#define REG_WHO_AM_I (0x0D)
+#define REG_XYZ_DATA_CFG (0x0E)
+#define REG_PL_STATUS (0x10)
+#define REG_PL_CFG (0x11)
+#define REG_PL_BF_ZCOMP (0x13)
+#define REG_P_L_THS (0x14)
+#define REG_FF_MT_SRC (0x16)
+#define REG_TRANSIENT_SRC (0x1E)
+#define REG_PULSE_SRC (0x22)
+#define REG_CTRL_REG1 (0x2A)
+#define REG_CTRL_REG2 (0x2B)
+#define REG_CTRL_REG4 (0x2D)
+#define REG_CTRL_REG5 (0x2E)
+#define PL_CFG_RESET (0x80)
+#define PL_BF_ZCOMP_RESET (0x44)
+#define P_L_THS_RESET (0x84)
+#define CTRL_REG1_ACTIVE (0x01)
+#define CTRL_REG1_F_READ (0x02)
+#define CTRL_REG1_DR_MASK (0x38)
+#define CTRL_REG1_DR_SHIFT (3)
+#define CTRL_REG2_RST (0x40)
+#define CTRL_REG2_ST (0x80)
+#define XYZ_DATA_CFG_FS_MASK (0x03)
+#define F_MODE_SHIFT (6)
+#define F_MODE_CIRCULAR (1)
+#define F_WMRK_MASK (0x3F)
+#define F_STATUS_OVF (0x80)
+#define F_STATUS_WMRK (0x40)
+#define DR_ZYXDR (0x08)
+#define DR_ZYXOW (0x80)
+#define DR_OW_SHIFT (4)				//XOW, YOW and ZOW sit 4 bits above XDR, YDR and ZDR
+#define DR_AXES (0x07)
+#define SYSMOD_WAKE (0x01)
+#define SRC_DRDY (0x01)
+#define SRC_FIFO (0x40)
+#define SAMPLE_SHIFT (2)			//14-bit counts are left justified in MSB and LSB
+#define BYTE_BITS (8)
+#define LSB_MASK (0xFC)
+#define COUNTS_PER_G (4096)			//14-bit counts per g in the +/-2 g range
+#define MG_PER_G (1000)
+#define COUNTS_MAX (8191)
+#define COUNTS_MIN (-8192)
+#define LFSR_SEED (0xACE1u)
+#define LFSR_TAPS (0x80200003u)		//Maximal length 32-bit Galois LFSR
+
+//Conversion period of every DR setting, 800 Hz down to 1.56 Hz
+static const uint32_t odr_period_us[] = {1250, 2500, 5000, 10000, 20000, 80000, 160000, 640000};
+
+//Output change of the self-test in the +/-4 g range, datasheet table 4
+static const int16_t st_delta_4g[MMA_MODEL_AXES] = {181, 255, 1680};
+
+/*
+ * @Name		fifo_mode
+ * @Description	FIFO mode set in F_SETUP
+ *
+ * @parameters	mma_model_t* - the device
+ * @Returns		uint8_t - 0 when the FIFO is off, 1 circular, 2 fill, 3 trigger
+ */
+static uint8_t fifo_mode(mma_model_t *dev)
+{
+	return dev->reg[REG_F_SETUP] >> F_MODE_SHIFT;
+}
+
+/*
+ * @Name		fifo_status
+ * @Description	F_STATUS, which replaces STATUS while the FIFO is on: overflow, watermark
+ * 				reached and sample count
+ *
+ * @parameters	mma_model_t* - the device
+ * @Returns		uint8_t - F_STATUS
+ */
+static uint8_t fifo_status(mma_model_t *dev)
+{
+	uint8_t watermark = dev->reg[REG_F_SETUP] & F_WMRK_MASK;
+	uint8_t status = dev->fifo_count;
+
+	if(dev->fifo_overflow)
+		status |= F_STATUS_OVF;
+	if(watermark && dev->fifo_count >= watermark)
+		status |= F_STATUS_WMRK;
+	return status;
+}
+
+/*
+ * @Name		output_byte
+ * @Description	Byte of an output register, from the FIFO head while the FIFO holds samples and
+ * 				from the latest sample otherwise
+ *
+ * @parameters	mma_model_t*, uint8_t - the device, register OUT_X_MSB to OUT_Z_LSB
+ * @Returns		uint8_t - register value
+ */
+static uint8_t output_byte(mma_model_t *dev, uint8_t reg)
+{
+	const int16_t *sample = (fifo_mode(dev) && dev->fifo_count) ? dev->fifo[dev->fifo_head] : dev->out;
+	uint16_t raw = (uint16_t)sample[(reg - REG_OUT_X_MSB) / 2] << SAMPLE_SHIFT;
+
+	return ((reg - REG_OUT_X_MSB) % 2) ? (raw & LSB_MASK) : (raw >> BYTE_BITS);
+}
+
+/*
+ * @Name		next_pointer
+ * @Description	Register address following a read of the given one. The LSB registers are
+ * 				skipped in fast-read mode, and the last data register wraps to OUT_X_MSB with
+ * 				the FIFO on (so one burst drains several samples) and to STATUS with it off
+ *
+ * @parameters	mma_model_t*, uint8_t - the device, register just read
+ * @Returns		uint8_t - next register address
+ */
+static uint8_t next_pointer(mma_model_t *dev, uint8_t reg)
+{
+	bool fast = dev->reg[REG_CTRL_REG1] & CTRL_REG1_F_READ;
+	uint8_t last = fast ? REG_OUT_Z_MSB : REG_OUT_Z_LSB;
+
+	if(reg == last)
+		return fifo_mode(dev) ? REG_OUT_X_MSB : REG_STATUS;
+	if(fast && (reg == REG_OUT_X_MSB || reg == REG_OUT_Y_MSB))
+		return reg + 2;
+	return (reg + 1) % MMA_MODEL_REG_COUNT;
+}
+
+/*
+ * @Name		noise_counts
+ * @Description	Next noise value from the LFSR, uniform within the peak set by mma_model_pose
+ *
+ * @parameters	mma_model_t* - the device
+ * @Returns		int32_t - noise in counts
+ */
+static int32_t noise_counts(mma_model_t *dev)
+{
+	uint32_t span = 2U * dev->input.noise + 1;
+
+	dev->input.lfsr = (dev->input.lfsr >> 1) ^ (-(dev->input.lfsr & 1U) & LFSR_TAPS);
+	return (int32_t)(dev->input.lfsr % span) - dev->input.noise;
+}
+
+/*
+ * @Name		convert
+ * @Description	One conversion of the applied acceleration in the range of XYZ_DATA_CFG, with
+ * 				the noise and the self-test change, clipped to 14 bits
+ *
+ * @parameters	mma_model_t* - the device
+ * @Returns		none
+ */
+static void convert(mma_model_t *dev)
+{
+	uint8_t fs = dev->reg[REG_XYZ_DATA_CFG] & XYZ_DATA_CFG_FS_MASK;
+	bool self_test = dev->reg[REG_CTRL_REG2] & CTRL_REG2_ST;
+	int16_t sample[MMA_MODEL_AXES];
+	int32_t counts;
+
+	for(int axis = 0; axis < MMA_MODEL_AXES; axis++)
+	{
+		if(dev->input.stuck & (1 << axis))
+		{
+			sample[axis] = dev->input.stuck_counts[axis];
+			continue;
+		}
+		counts = dev->input.mg[axis] * (COUNTS_PER_G >> fs) / MG_PER_G + noise_counts(dev);
+		if(self_test)
+			counts += st_delta_4g[axis] * 2 >> fs;
+		if(counts > COUNTS_MAX)
+			counts = COUNTS_MAX;
+		else if(counts < COUNTS_MIN)
+			counts = COUNTS_MIN;
+		sample[axis] = (int16_t)counts;
+	}
+	mma_model_sample(dev, sample[0], sample[1], sample[2]);
+}
+
+/*
+ * See documentation in .h file
+ */
+uint8_t mma_model_peek(mma_model_t *dev, uint8_t reg)
+{
+	uint8_t source = 0;
+
+	if(reg >= MMA_MODEL_REG_COUNT)
+		return 0;
+
+	switch(reg)
+	{
+	case REG_STATUS:
+		return fifo_mode(dev) ? fifo_status(dev) : dev->reg[REG_STATUS];
+
+	case REG_SYSMOD:
+		return (dev->reg[REG_CTRL_REG1] & CTRL_REG1_ACTIVE) ? SYSMOD_WAKE : 0;
+
+	case REG_INT_SOURCE:
+		if(!fifo_mode(dev) && (dev->reg[REG_STATUS] & DR_ZYXDR))
+			source |= SRC_DRDY;
+		if(fifo_mode(dev) && (fifo_status(dev) & (F_STATUS_OVF | F_STATUS_WMRK)))
+			source |= SRC_FIFO;
+		return source & dev->reg[REG_CTRL_REG4];
+
+	default:
+		if(reg >= REG_OUT_X_MSB && reg <= REG_OUT_Z_LSB)
+			return output_byte(dev, reg);
+		return dev->reg[reg];
+	}
+}
+
+/*
+ * @Name		register_read
+ * @Description	Read by the master with its side effects: reading an axis MSB clears the data
+ * 				ready and overwrite flags of that axis, reading F_STATUS clears the overflow flag,
+ * 				and reading the last data register of a sample pops it from the FIFO
+ *
+ * @parameters	mma_model_t*, uint8_t - the device, register address
+ * @Returns		uint8_t - register value
+ */
+static uint8_t register_read(mma_model_t *dev, uint8_t reg)
+{
+	uint8_t value = mma_model_peek(dev, reg);
+	bool fast = dev->reg[REG_CTRL_REG1] & CTRL_REG1_F_READ;
+	uint8_t axis;
+
+	dev->counts.reads++;
+	if(reg == REG_STATUS && fifo_mode(dev))
+		dev->fifo_overflow = false;
+
+	if(reg == REG_OUT_X_MSB || reg == REG_OUT_Y_MSB || reg == REG_OUT_Z_MSB)
+	{
+		axis = 1 << ((reg - REG_OUT_X_MSB) / 2);
+		dev->reg[REG_STATUS] &= ~(axis | (axis << DR_OW_SHIFT));
+		if(!(dev->reg[REG_STATUS] & DR_AXES))
+			dev->reg[REG_STATUS] &= ~(DR_ZYXDR | DR_ZYXOW);
+	}
+
+	if(reg == (fast ? REG_OUT_Z_MSB : REG_OUT_Z_LSB) && fifo_mode(dev) && dev->fifo_count)
+	{
+		memcpy(dev->out, dev->fifo[dev->fifo_head], sizeof(dev->out));
+		dev->fifo_head = (dev->fifo_head + 1) % MMA_MODEL_FIFO_SIZE;
+		dev->fifo_count--;
+	}
+	return value;
+}
+
+/*
+ * @Name		register_write
+ * @Description	Write by the master: read only registers keep their value, CTRL_REG1 only takes
+ * 				ACTIVE and XYZ_DATA_CFG nothing while the device is active, and RST in CTRL_REG2
+ * 				resets the device
+ *
+ * @parameters	mma_model_t*, uint8_t, uint8_t - the device, register address and value
+ * @Returns		none
+ */
+static void register_write(mma_model_t *dev, uint8_t reg, uint8_t value)
+{
+	bool active = dev->reg[REG_CTRL_REG1] & CTRL_REG1_ACTIVE;
+	mma_model_counts_t counts;
+	mma_model_input_t input;
+
+	dev->counts.writes++;
+	if(reg >= MMA_MODEL_REG_COUNT || reg <= REG_RESERVED_LAST || reg == REG_SYSMOD ||
+			reg == REG_INT_SOURCE || reg == REG_WHO_AM_I || reg == REG_PL_STATUS ||
+			reg == REG_FF_MT_SRC || reg == REG_TRANSIENT_SRC || reg == REG_PULSE_SRC)
+	{
+		dev->counts.ignored++;
+		return;
+	}
+
+	if(active && reg == REG_CTRL_REG1 && ((value ^ dev->reg[reg]) & ~CTRL_REG1_ACTIVE))
+	{
+		dev->counts.ignored++;
+		value = (dev->reg[reg] & ~CTRL_REG1_ACTIVE) | (value & CTRL_REG1_ACTIVE);
+	}
+	else if(active && reg == REG_XYZ_DATA_CFG)
+	{
+		dev->counts.ignored++;
+		return;
+	}
+
+	if(reg == REG_CTRL_REG2 && (value & CTRL_REG2_RST))
+	{
+		counts = dev->counts;
+		input = dev->input;
+		mma_model_init(dev);
+		dev->counts = counts;
+		dev->input = input;
+		return;
+	}
+
+	//Leaving the FIFO mode restarts the FIFO
+	if(reg == REG_F_SETUP && !(value >> F_MODE_SHIFT))
+	{
+		dev->fifo_count = 0;
+		dev->fifo_overflow = false;
+	}
+	dev->reg[reg] = value;
+}
+
+/*
+ * @Name		slave_address
+ * @Description	Address phase: acknowledges the device address, a write sets the register
+ * 				pointer with its first data byte, a read starts at the current pointer
+ *
+ * @parameters	void*, uint8_t - the device, address byte with the R/W bit
+ * @Returns		bool - true if the device is addressed
+ */
+static bool slave_address(void *ctx, uint8_t addr)
+{
+	mma_model_t *dev = ctx;
+
+	if((addr & ADDR_MASK) != MMA_MODEL_DEV_ADDR)
+		return false;
+	dev->pointer_next = !(addr & READ_BIT);
+	dev->counts.transactions++;
+	return true;
+}
+
+/*
+ * @Name		slave_write
+ * @Description	Data byte from the master: the register pointer, then register values with the
+ * 				pointer incremented after each
+ *
+ * @parameters	void*, uint8_t - the device, byte
+ * @Returns		bool - true, the device acknowledges every byte
+ */
+static bool slave_write(void *ctx, uint8_t byte)
+{
+	mma_model_t *dev = ctx;
+
+	if(dev->pointer_next)
+	{
+		dev->pointer = byte;
+		dev->pointer_next = false;
+		return true;
+	}
+	register_write(dev, dev->pointer, byte);
+	dev->pointer = (dev->pointer + 1) % MMA_MODEL_REG_COUNT;
+	return true;
+}
+
+/*
+ * @Name		slave_read
+ * @Description	Data byte to the master from the register pointer, which then auto-increments
+ *
+ * @parameters	void* - the device
+ * @Returns		uint8_t - register value
+ */
+static uint8_t slave_read(void *ctx)
+{
+	mma_model_t *dev = ctx;
+	uint8_t reg = dev->pointer;
+
+	dev->pointer = next_pointer(dev, reg);
+	return register_read(dev, reg);
+}
+
+/*
+ * @Name		slave_stop
+ * @Description	STOP condition, a following write starts with a new register pointer
+ *
+ * @parameters	void* - the device
+ * @Returns		none
+ */
+static void slave_stop(void *ctx)
+{
+	mma_model_t *dev = ctx;
+
+	dev->pointer_next = false;
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_model_init(mma_model_t *dev)
+{
+	memset(dev, 0, sizeof(*dev));
+	dev->reg[REG_WHO_AM_I] = MMA_MODEL_WHO_AM_I;
+	dev->reg[REG_PL_CFG] = PL_CFG_RESET;
+	dev->reg[REG_PL_BF_ZCOMP] = PL_BF_ZCOMP_RESET;
+	dev->reg[REG_P_L_THS] = P_L_THS_RESET;
+	dev->input.lfsr = LFSR_SEED;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_model_slave_t mma_model_slave(mma_model_t *dev)
+{
+	i2c_model_slave_t slave = {
+		.ctx = dev,
+		.address = slave_address,
+		.write = slave_write,
+		.read = slave_read,
+		.stop = slave_stop
+	};
+	return slave;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_model_sample(mma_model_t *dev, int16_t x, int16_t y, int16_t z)
+{
+	int16_t *slot;
+	uint8_t tail;
+
+	if(!(dev->reg[REG_CTRL_REG1] & CTRL_REG1_ACTIVE))
+		return false;
+	dev->counts.samples++;
+
+	if(!fifo_mode(dev))
+	{
+		//An unread sample is overwritten: its data ready flags turn into overwrite flags
+		if(dev->reg[REG_STATUS] & DR_ZYXDR)
+		{
+			dev->reg[REG_STATUS] |= DR_ZYXOW | ((dev->reg[REG_STATUS] & DR_AXES) << DR_OW_SHIFT);
+			dev->counts.dropped++;
+		}
+		dev->reg[REG_STATUS] |= DR_ZYXDR | DR_AXES;
+		slot = dev->out;
+	}
+	else
+	{
+		if(dev->fifo_count == MMA_MODEL_FIFO_SIZE)
+		{
+			dev->fifo_overflow = true;
+			dev->counts.dropped++;
+			if(fifo_mode(dev) != F_MODE_CIRCULAR)
+				return true;
+			dev->fifo_head = (dev->fifo_head + 1) % MMA_MODEL_FIFO_SIZE;
+			dev->fifo_count--;
+		}
+		tail = (dev->fifo_head + dev->fifo_count) % MMA_MODEL_FIFO_SIZE;
+		slot = dev->fifo[tail];
+		dev->fifo_count++;
+	}
+	slot[0] = x;
+	slot[1] = y;
+	slot[2] = z;
+	return true;
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_model_pose(mma_model_t *dev, int32_t x_mg, int32_t y_mg, int32_t z_mg, uint16_t noise)
+{
+	dev->input.applied = true;
+	dev->input.mg[0] = x_mg;
+	dev->input.mg[1] = y_mg;
+	dev->input.mg[2] = z_mg;
+	dev->input.noise = noise;
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_model_stick(mma_model_t *dev, uint8_t axes)
+{
+	const int16_t *out = (fifo_mode(dev) && dev->fifo_count) ? dev->fifo[dev->fifo_head] : dev->out;
+
+	dev->input.stuck = axes;
+	for(int axis = 0; axis < MMA_MODEL_AXES; axis++)
+		dev->input.stuck_counts[axis] = out[axis];
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_model_run(mma_model_t *dev, uint64_t now_us)
+{
+	uint32_t period;
+
+	if(!dev->input.applied || !(dev->reg[REG_CTRL_REG1] & CTRL_REG1_ACTIVE))
+	{
+		dev->converting = false;
+		return;
+	}
+
+	period = odr_period_us[(dev->reg[REG_CTRL_REG1] & CTRL_REG1_DR_MASK) >> CTRL_REG1_DR_SHIFT];
+	if(!dev->converting)
+	{
+		dev->converting = true;
+		dev->next_us = now_us + period;
+	}
+	while(now_us >= dev->next_us)
+	{
+		convert(dev);
+		dev->next_us += period;
+	}
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_model_int1(mma_model_t *dev)
+{
+	return mma_model_peek(dev, REG_INT_SOURCE) & dev->reg[REG_CTRL_REG5];
+}
@@ -0,0 +1,163 @@
+/*
+ * mma8451_model.h
+ *
+ * Created on: 17-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef MMA8451_MODEL_H_
+#define MMA8451_MODEL_H_
+
+/*
+ * Behavioural model of the MMA8451Q as an I2C slave of i2c_model. It keeps the register map of
+ * the device from STATUS (0x00) to OFF_Z (0x31) with its reset values, answers WHO_AM_I with 0x1A
+ * and auto-increments the register pointer the way the device does: the LSB registers are skipped
+ * in fast-read mode (F_READ), the data registers wrap back to OUT_X_MSB while the FIFO is on and
+ * to STATUS otherwise. Samples are fed by the test with mma_model_sample, standing in for one
+ * conversion of the device; they set ZYXDR (ZYXOW when the previous one was not read) or go into
+ * the 32 sample FIFO in circular or fill mode, with the overflow and watermark flags in F_STATUS.
+ * CTRL_REG1 fields other than ACTIVE and XYZ_DATA_CFG only change in standby, as on the device.
+ * Once an acceleration is applied with mma_model_pose the device also converts by itself at the
+ * rate of CTRL_REG1 DR as mma_model_run lets time pass: the acceleration is scaled to the range
+ * of XYZ_DATA_CFG with some noise, moved by the self-test (CTRL_REG2 ST) and clipped to 14 bits.
+ * INT1 follows the data-ready and FIFO sources routed to it by CTRL_REG4 and CTRL_REG5.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c_model.h"
+
+//MACROS
+#define MMA_MODEL_DEV_ADDR (0x3A)		//Slave address with SA0 high, R/W bit clear
+#define MMA_MODEL_WHO_AM_I (0x1A)
+#define MMA_MODEL_REG_COUNT (0x32)		//STATUS up to OFF_Z
+#define MMA_MODEL_FIFO_SIZE (32)
+#define MMA_MODEL_AXES (3)
+
+/* public types*/
+
+//Register accesses seen by the slave since mma_model_init
+typedef struct
+{
+	uint32_t reads;					//Register bytes read by the master
+	uint32_t writes;				//Register bytes written by the master
+	uint32_t ignored;				//Writes to read only registers or to fields locked while active
+	uint32_t transactions;			//Address phases acknowledged
+	uint32_t samples;				//Samples produced while active
+	uint32_t dropped;				//Samples lost: overwritten unread or not taken by a full FIFO
+} mma_model_counts_t;
+
+//Acceleration applied to the device and the faults of its sensing element, kept across a reset
+//of the device
+typedef struct
+{
+	bool applied;					//mma_model_pose was called, conversions run in mma_model_run
+	int32_t mg[MMA_MODEL_AXES];		//Acceleration in mg
+	uint16_t noise;					//Peak noise of a conversion, in counts of the range in use
+	uint32_t lfsr;					//Noise generator
+	uint8_t stuck;					//Axes (bit 0 for X) repeating stuck_counts whatever the input
+	int16_t stuck_counts[MMA_MODEL_AXES];
+} mma_model_input_t;
+
+//State of the device
+typedef struct
+{
+	uint8_t reg[MMA_MODEL_REG_COUNT];	//Register map as written, the status and output registers are derived
+	uint8_t pointer;					//Register address of the next access
+	bool pointer_next;					//The next byte written sets the register pointer
+	int16_t out[MMA_MODEL_AXES];		//Latest sample in 14-bit counts when the FIFO is off
+	int16_t fifo[MMA_MODEL_FIFO_SIZE][MMA_MODEL_AXES];
+	uint8_t fifo_head;
+	uint8_t fifo_count;
+	bool fifo_overflow;
+	bool converting;				//Conversions scheduled by mma_model_run
+	uint64_t next_us;				//Time of the next conversion
+	mma_model_input_t input;
+	mma_model_counts_t counts;
+} mma_model_t;
+
+/*
+ * @Name		mma_model_init
+ * @Description	Puts the device in its power on state: standby, registers at their reset values
+ * 				and no sample taken
+ *
+ * @parameters	mma_model_t* - the device
+ * @Returns		none
+ */
+void mma_model_init(mma_model_t *dev);
+
+/*
+ * @Name		mma_model_slave
+ * @Description	Slave interface of the device, to be connected to an i2c_model bus
+ *
+ * @parameters	mma_model_t* - the device
+ * @Returns		i2c_model_slave_t - callbacks bound to the device
+ */
+i2c_model_slave_t mma_model_slave(mma_model_t *dev);
+
+/*
+ * @Name		mma_model_sample
+ * @Description	One conversion of the device. Ignored in standby. With the FIFO off the sample
+ * 				replaces the output registers and sets ZYXDR, or ZYXOW if the previous sample was
+ * 				not read; with the FIFO on it is queued, a full FIFO drops the oldest sample in
+ * 				circular mode and the new one in fill mode and flags the overflow
+ *
+ * @parameters	mma_model_t* - the device
+ * 				int16_t, int16_t, int16_t - X, Y and Z in 14-bit counts
+ * @Returns		bool - true if the device was active and took the sample
+ */
+bool mma_model_sample(mma_model_t *dev, int16_t x, int16_t y, int16_t z);
+
+/*
+ * @Name		mma_model_pose
+ * @Description	Applies an acceleration to the device and lets it convert at its output data
+ * 				rate from then on, see mma_model_run
+ *
+ * @parameters	mma_model_t* - the device
+ * 				int32_t, int32_t, int32_t - X, Y and Z in mg
+ * 				uint16_t - peak noise of every conversion in counts, 0 for none
+ * @Returns		none
+ */
+void mma_model_pose(mma_model_t *dev, int32_t x_mg, int32_t y_mg, int32_t z_mg, uint16_t noise);
+
+/*
+ * @Name		mma_model_stick
+ * @Description	Sensing element fault: the given axes keep converting to their current output
+ * 				value whatever the acceleration, the noise or the self-test
+ *
+ * @parameters	mma_model_t*, uint8_t - the device, axes with bit 0 for X, 0 to clear the fault
+ * @Returns		none
+ */
+void mma_model_stick(mma_model_t *dev, uint8_t axes);
+
+/*
+ * @Name		mma_model_run
+ * @Description	Lets the device run up to a point in time: while active and posed it converts
+ * 				every period of the output data rate of CTRL_REG1, the first conversion coming one
+ * 				period after it was made active
+ *
+ * @parameters	mma_model_t*, uint64_t - the device, time in us
+ * @Returns		none
+ */
+void mma_model_run(mma_model_t *dev, uint64_t now_us);
+
+/*
+ * @Name		mma_model_int1
+ * @Description	State of the INT1 pin: the enabled interrupt sources routed to INT1
+ *
+ * @parameters	mma_model_t* - the device
+ * @Returns		bool - true while INT1 is asserted (driven low with the default polarity)
+ */
+bool mma_model_int1(mma_model_t *dev);
+
+/*
+ * @Name		mma_model_peek
+ * @Description	Register as the master would read it, without the side effects of a read
+ *
+ * @parameters	mma_model_t*, uint8_t - the device, register address
+ * @Returns		uint8_t - register value
+ */
+uint8_t mma_model_peek(mma_model_t *dev, uint8_t reg);
+
+#endif /* MMA8451_MODEL_H_ */
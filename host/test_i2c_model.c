@@ -0,0 +1,706 @@
+/*
+ * test_i2c_model.c
+ *
+ *  Created on: 17-May-2021
+ *      Author: Venkat Sai Krishna Tata
+ *
+ * Host tests of the I2C0 and MMA8451Q models and of the unmodified drivers running on them:
+ * source/i2c.c and source/mma8451.c are compiled against the MKL25Z4.h of this folder, which
+ * makes I2C0 the register model (see source/i2c_regs.h), and board_model.c provides the timebase,
+ * the NVIC and the interrupt dispatch. The polled transfers, the interrupt engine and the data
+ * ready and FIFO paths of the accelerometer driver run as on the board. Lost interrupts, stalled
+ * bytes and a slave holding SDA are injected into the model to drive the timeouts, the bus
+ * recovery and the bounded retries of the driver. The self-test runs on the model as well, healthy,
+ * with a stuck axis and saturated, and the low-pass stage is checked against a floating point
+ * reference. The register access counts of the common transfers are printed for comparison
+ * between revisions.
+ *
+ * Build and run from the repository root:
+ * 		gcc -std=gnu99 -Wall -Wextra -Ihost -Isource host/board_model.c host/i2c_model.c \
+ * 			host/mma8451_model.c host/test_i2c_model.c source/i2c.c source/mma8451.c \
+ * 			source/sample_timing.c source/selftest.c source/lowpass.c source/decimate.c \
+ * 			source/angle.c -o test_i2c_model && ./test_i2c_model
+ * The program returns non zero when a check fails.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MKL25Z4.h"
+#include "board_model.h"
+#include "i2c_model.h"
+#include "mma8451_model.h"
+#include "i2c.h"
+#include "mma8451.h"
+#include "selftest.h"
+#include "lowpass.h"
+#include "timebase.h"
+
+#define US_PER_S 1000000U
+#define DUMMY_ADDR 0x20
+#define READ_BIT 0x1
+#define CTRL_REG1_DR_100HZ 0x18
+#define F_SETUP_CIRCULAR 0x40
+#define F_SETUP_FILL 0x80
+#define F_STATUS_OVF 0x80
+#define F_STATUS_WMRK 0x40
+#define F_CNT_MASK 0x3F
+#define TEST_WATERMARK 4
+#define SAMPLE_BYTES 6
+#define STATUS_XYZ_BYTES 7
+#define FIFO_SAMPLES 6
+#define BLOCK_BYTES (MMA_MODEL_FIFO_SIZE * SAMPLE_BYTES)
+#define RSTA_MULT 0x40				//MULT field for a multiplier of 2
+#define X_COUNTS 100
+#define Y_COUNTS -200
+#define Z_COUNTS 4096
+#define TIME_SLACK_US 20			//Register accesses and polls between the bytes
+#define ROLL_Y_MG 500				//Board rolled by 30 degrees
+#define ROLL_Z_MG 866
+#define ROLL_CDEG 3000
+#define ROLL_TOLERANCE_CDEG 5
+#define INIT_SUCCESS 1
+#define CHAIN_LEN 3					//Transactions submitted one from the callback of the other
+#define SDA_HOLD_CLOCKS 3			//Pulses a slave needs to finish its byte, fewer than RECOVERY_CLOCKS
+#define SDA_STUCK_CLOCKS 100		//More than the recovery of every attempt gives
+#define WATCHDOG_WAIT_US 10000
+#define MG_PER_G 1000
+#define CTRL_REG2_ST 0x80
+#define ST_NOISE 4					//Peak noise of the self-test samples in counts
+#define ST_SATURATED_Z_MG 3600		//Close enough to 4 g for the actuation to clip Z
+#define PI 3.14159265358979
+#define Q15_ONE 32768.0
+#define LPF_RATE_MHZ 800000U
+#define LPF_CUTOFF_MHZ 10000U
+#define LPF_SAMPLES 400				//Step response, well past 2 time constants of the cascade
+#define LPF_NOISE 64				//Peak of the pattern added to the step, counts
+#define LPF_NOISE_STRIDE 37			//Steps through the pattern in a scrambled order
+#define LPF_TOL 1					//Counts, rounding of the fixed-point stage
+#define ONE_G_COUNTS 4096
+
+static int g_total_test,g_total_test_pass;
+
+#define test_check(value) {                                             \
+  g_total_test++;                                                       \
+  if (value) {                                                          \
+    g_total_test_pass++;                                                \
+  } else {                                                              \
+    printf("ERROR at %d\n", __LINE__);                                  \
+  }                                                                     \
+}
+
+//Raw accesses to the I2C0 model, for the sequences the driver never issues
+#define RD(reg) i2c_model_read(I2C0, I2C_MODEL_##reg)
+#define WR(reg, value) i2c_model_write(I2C0, I2C_MODEL_##reg, (value))
+
+//Descriptors of the callback chain test
+static i2c_xfer_t chain[CHAIN_LEN];
+static uint8_t chain_buf[CHAIN_LEN];
+static int chain_done;
+
+/*
+ * @Name		board_reset
+ * @Description	Powers the board up with a fresh accelerometer and initializes I2C0 with
+ * 				init_I2C, which sets MST and so generates a START
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void board_reset()
+{
+	board_model_init();
+	init_timebase();
+	init_I2C();
+	i2c_stats_reset(I2C_BUS0);
+	i2c_trace_clear();
+	i2c_model_counts_reset(I2C0);
+}
+
+/*
+ * @Name		write_reg
+ * @Description	Writes one device register with i2c_write_burst
+ *
+ * @parameters	uint8_t, uint8_t - register and value
+ * @Returns		i2c_status_t - result of the transfer
+ */
+static i2c_status_t write_reg(uint8_t reg, uint8_t value)
+{
+	return i2c_write_burst(MMA_DEV_ADDR, reg, &value, 1);
+}
+
+/*
+ * @Name		raw_tx
+ * @Description	Sends a byte with bare register accesses and waits for it, no error handling
+ *
+ * @parameters	uint8_t - byte to send
+ * @Returns		None
+ */
+static void raw_tx(uint8_t byte)
+{
+	WR(D, byte);
+	i2c_model_wait(I2C0);
+	WR(S, I2C_S_IICIF_MASK);
+}
+
+/*
+ * @Name		sample_counts
+ * @Description	14-bit count of an axis from its left justified MSB and LSB
+ *
+ * @parameters	const uint8_t* - MSB followed by LSB
+ * @Returns		int16_t - counts
+ */
+static int16_t sample_counts(const uint8_t *raw)
+{
+	return (int16_t)((raw[0] << 8) | raw[1]) >> 2;
+}
+
+/*
+ * @Name		chain_next
+ * @Description	Completion callback submitting the next transaction of the chain from the ISR
+ *
+ * @parameters	i2c_xfer_t* - the transaction done
+ * @Returns		None
+ */
+static void chain_next(i2c_xfer_t *xfer)
+{
+	int next = (int)(xfer - chain) + 1;
+
+	chain_done++;
+	if(xfer->status == I2C_OK && next < CHAIN_LEN)
+		i2c_submit(&chain[next]);
+}
+
+/*
+ * @Name		test_transfers
+ * @Description	WHO_AM_I, the absent slave, the bus conditions of a read, lost arbitration
+ * 				retried after a bus recovery and the misuse counter
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_transfers()
+{
+	i2c_stats_t stats;
+	uint8_t value = 0;
+
+	board_reset();
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_WHO_AM_I, &value, 1) == I2C_OK &&
+			value == MMA_MODEL_WHO_AM_I);
+	test_check(I2C0->counts.starts == 1 && I2C0->counts.stops == 1 && I2C0->counts.bytes == 4);
+	test_check(!(RD(S) & I2C_S_BUSY_MASK) && I2C0->counts.misuse == 0);
+
+	//The absent slave NACKs its address, which is not retried, and the bus is let go
+	test_check(i2c_read_burst(DUMMY_ADDR, MMA_REG_WHO_AM_I, &value, 1) == I2C_ERR_NACK);
+	test_check(!(RD(S) & I2C_S_BUSY_MASK));
+
+	//A write auto-increments on the device, read back in one burst
+	uint8_t offsets[3] = { 1, 2, 3 }, back[3] = { 0 };
+	test_check(i2c_write_burst(MMA_DEV_ADDR, MMA_REG_OFF_X, offsets, 3) == I2C_OK);
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_OFF_X, back, 3) == I2C_OK && !memcmp(offsets, back, 3));
+
+	//Lost arbitration clears ARBL, recovers the bus and succeeds on the retry
+	i2c_model_lose_arbitration(I2C0);
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_WHO_AM_I, &value, 1) == I2C_OK &&
+			value == MMA_MODEL_WHO_AM_I);
+	test_check(!(RD(S) & I2C_S_ARBL_MASK) && !(RD(C1) & I2C_C1_MST_MASK));
+	i2c_stats_get(I2C_BUS0, &stats);
+	test_check(stats.retries == 1 && stats.nacks == 1 && stats.transactions == 5);
+	test_check(I2C0->counts.misuse == 0);
+}
+
+/*
+ * @Name		test_rsta_errata
+ * @Description	With MULT set the driver read works at the same SCL rate, i2c_rsta clearing MULT
+ * 				around the repeated START; a bare RSTA is dropped and the read address goes out
+ * 				as data
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_rsta_errata()
+{
+	uint8_t value = 0;
+
+	board_reset();
+	WR(F, RSTA_MULT | RD(F));
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_WHO_AM_I, &value, 1) == I2C_OK &&
+			value == MMA_MODEL_WHO_AM_I);
+	test_check(I2C0->counts.rsta_lost == 0 && (RD(F) & I2C_F_MULT_MASK) == RSTA_MULT);
+
+	WR(C1, RD(C1) & ~I2C_C1_MST_MASK);
+	WR(C1, RD(C1) | I2C_C1_TX_MASK | I2C_C1_MST_MASK);
+	raw_tx(MMA_DEV_ADDR);
+	raw_tx(MMA_REG_WHO_AM_I);
+	WR(C1, RD(C1) | I2C_C1_RSTA_MASK);
+	raw_tx(MMA_DEV_ADDR | READ_BIT);
+	WR(C1, RD(C1) & ~I2C_C1_MST_MASK);
+	test_check(I2C0->counts.rsta_lost == 1 && host_mma.counts.ignored == 1);
+}
+
+/*
+ * @Name		test_data_ready
+ * @Description	STATUS and the three axes in one burst, data ready and overwrite flags, pointer
+ * 				wrap to STATUS, the registers locked while active and the fast-read decoding of
+ * 				mma_read_sample
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_data_ready()
+{
+	uint8_t raw[STATUS_XYZ_BYTES + 1], value;
+	mma_sample_t sample;
+
+	board_reset();
+	test_check(!mma_model_sample(&host_mma, X_COUNTS, Y_COUNTS, Z_COUNTS));
+	write_reg(MMA_REG_CTRL_REG1, CTRL_REG1_DR_100HZ | MMA_CTRL_REG1_ACTIVE);
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_SYSMOD, &value, 1);
+	test_check(value == 1);
+
+	test_check(mma_model_sample(&host_mma, X_COUNTS, Y_COUNTS, Z_COUNTS));
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, raw, STATUS_XYZ_BYTES + 1) == I2C_OK);
+	test_check((raw[0] & MMA_STATUS_ZYXDR) && !(raw[0] & MMA_STATUS_ZYXOW));
+	test_check(sample_counts(&raw[1]) == X_COUNTS && sample_counts(&raw[3]) == Y_COUNTS &&
+			sample_counts(&raw[5]) == Z_COUNTS);
+	test_check(raw[STATUS_XYZ_BYTES] == 0);
+
+	mma_model_sample(&host_mma, 1, 2, 3);
+	mma_model_sample(&host_mma, 4, 5, 6);
+	test_check(mma_read_sample(&sample) == I2C_OK);
+	test_check((sample.status & MMA_STATUS_ZYXOW) && sample.x == 4 && sample.z == 6 &&
+			host_mma.counts.dropped == 1);
+
+	//Fast read: STATUS and the three MSBs
+	write_reg(MMA_REG_CTRL_REG1, CTRL_REG1_DR_100HZ | MMA_CTRL_REG1_F_READ | MMA_CTRL_REG1_ACTIVE);
+	test_check(host_mma.counts.ignored == 1 &&
+			mma_model_peek(&host_mma, MMA_REG_CTRL_REG1) == (CTRL_REG1_DR_100HZ | MMA_CTRL_REG1_ACTIVE));
+	write_reg(MMA_REG_XYZ_DATA_CFG, 1);
+	test_check(host_mma.counts.ignored == 2 && mma_model_peek(&host_mma, MMA_REG_XYZ_DATA_CFG) == 0);
+	write_reg(MMA_REG_CTRL_REG1, CTRL_REG1_DR_100HZ);
+	write_reg(MMA_REG_CTRL_REG1, CTRL_REG1_DR_100HZ | MMA_CTRL_REG1_F_READ | MMA_CTRL_REG1_ACTIVE);
+	mma_model_sample(&host_mma, X_COUNTS, Y_COUNTS, Z_COUNTS);
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, raw, 4);
+	test_check(raw[0] & MMA_STATUS_ZYXDR);
+	test_check((int8_t)raw[1] == (X_COUNTS >> 6) && (int8_t)raw[2] == (Y_COUNTS >> 6) &&
+			(int8_t)raw[3] == (Z_COUNTS >> 6));
+	test_check(I2C0->counts.misuse == 0);
+}
+
+/*
+ * @Name		test_fifo
+ * @Description	Watermark and count in F_STATUS, one burst draining several samples in order,
+ * 				and the overflow of the circular and fill modes
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_fifo()
+{
+	static uint8_t raw[BLOCK_BYTES];
+	uint8_t status = 0;
+	bool order = true;
+
+	board_reset();
+	write_reg(MMA_REG_F_SETUP, F_SETUP_CIRCULAR | TEST_WATERMARK);
+	write_reg(MMA_REG_CTRL_REG1, CTRL_REG1_DR_100HZ | MMA_CTRL_REG1_ACTIVE);
+	for(int i = 0; i < FIFO_SAMPLES; i++)
+		mma_model_sample(&host_mma, i, -i, i * 2);
+
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, &status, 1);
+	test_check((status & F_CNT_MASK) == FIFO_SAMPLES && (status & F_STATUS_WMRK) && !(status & F_STATUS_OVF));
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_OUT_X_MSB, raw, FIFO_SAMPLES * SAMPLE_BYTES) == I2C_OK);
+	for(int i = 0; i < FIFO_SAMPLES; i++)
+		order &= sample_counts(&raw[i * SAMPLE_BYTES]) == i && sample_counts(&raw[i * SAMPLE_BYTES + 4]) == i * 2;
+	test_check(order && host_mma.fifo_count == 0);
+
+	//Circular mode keeps the newest 32 samples
+	for(int i = 0; i < MMA_MODEL_FIFO_SIZE + 2; i++)
+		mma_model_sample(&host_mma, i, 0, 0);
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, &status, 1);
+	test_check((status & F_STATUS_OVF) && (status & F_CNT_MASK) == MMA_MODEL_FIFO_SIZE);
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_OUT_X_MSB, raw, BLOCK_BYTES);
+	test_check(sample_counts(raw) == 2 && sample_counts(&raw[BLOCK_BYTES - SAMPLE_BYTES]) == MMA_MODEL_FIFO_SIZE + 1);
+
+	//Fill mode keeps the oldest 32 samples
+	write_reg(MMA_REG_CTRL_REG1, CTRL_REG1_DR_100HZ);
+	write_reg(MMA_REG_F_SETUP, F_SETUP_FILL | TEST_WATERMARK);
+	write_reg(MMA_REG_CTRL_REG1, CTRL_REG1_DR_100HZ | MMA_CTRL_REG1_ACTIVE);
+	for(int i = 0; i < MMA_MODEL_FIFO_SIZE + 2; i++)
+		mma_model_sample(&host_mma, i, 0, 0);
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_OUT_X_MSB, raw, BLOCK_BYTES);
+	test_check(sample_counts(raw) == 0 && sample_counts(&raw[BLOCK_BYTES - SAMPLE_BYTES]) == MMA_MODEL_FIFO_SIZE - 1);
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, &status, 1);
+	test_check(status == F_STATUS_OVF);
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, &status, 1);
+	test_check(status == 0 && I2C0->counts.misuse == 0);
+}
+
+/*
+ * @Name		test_engine
+ * @Description	The interrupt engine reads and writes the same data as the polled functions,
+ * 				and a transaction submitted from a completion callback runs once the engine
+ * 				has moved on from the one completing
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_engine()
+{
+	uint8_t polled[STATUS_XYZ_BYTES], irq[STATUS_XYZ_BYTES], value = CTRL_REG1_DR_100HZ | MMA_CTRL_REG1_ACTIVE;
+	i2c_xfer_t write = { .dev_addr = MMA_DEV_ADDR, .reg = MMA_REG_CTRL_REG1, .dir = I2C_WRITE, .buf = &value, .len = 1 };
+	i2c_xfer_t read = { .dev_addr = MMA_DEV_ADDR, .reg = MMA_REG_STATUS, .dir = I2C_READ, .buf = irq, .len = STATUS_XYZ_BYTES };
+
+	board_reset();
+	i2c_engine_init();
+	test_check(i2c_submit(&write) && i2c_wait(&write) == I2C_OK &&
+			mma_model_peek(&host_mma, MMA_REG_CTRL_REG1) == value);
+	mma_model_sample(&host_mma, X_COUNTS, Y_COUNTS, Z_COUNTS);
+	test_check(i2c_submit(&read) && i2c_wait(&read) == I2C_OK);
+	mma_model_sample(&host_mma, X_COUNTS, Y_COUNTS, Z_COUNTS);
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, polled, STATUS_XYZ_BYTES) == I2C_OK);
+	test_check(!memcmp(polled, irq, STATUS_XYZ_BYTES) && I2C0->counts.misuse == 0);
+
+	//Each callback queues the next read while the engine finishes the previous one
+	for(int i = 0; i < CHAIN_LEN; i++)
+	{
+		chain[i] = (i2c_xfer_t){ .dev_addr = MMA_DEV_ADDR, .reg = MMA_REG_WHO_AM_I, .dir = I2C_READ,
+				.buf = &chain_buf[i], .len = 1, .callback = chain_next };
+	}
+	chain_done = 0;
+	test_check(i2c_submit(&chain[0]) && i2c_wait(&chain[CHAIN_LEN - 1]) == I2C_OK);
+	test_check(chain_done == CHAIN_LEN && chain_buf[0] == MMA_MODEL_WHO_AM_I &&
+			chain_buf[CHAIN_LEN - 1] == MMA_MODEL_WHO_AM_I);
+	test_check(!i2c_engine_busy() && !(RD(C1) & I2C_C1_IICIE_MASK) && I2C0->counts.misuse == 0);
+}
+
+/*
+ * @Name		test_recovery
+ * @Description	Faults on the polled path: a lost interrupt times the byte out, and a slave
+ * 				holding SDA keeps the bus busy; both are retried after i2c_bus_recover clocked
+ * 				the bus, and a bus that stays stuck ends with I2C_ERR_BUSY after
+ * 				I2C_MAX_RETRIES recoveries
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_recovery()
+{
+	i2c_stats_t stats;
+	uint8_t value = 0;
+	uint64_t start;
+
+	board_reset();
+	i2c_model_drop_irq(I2C0);
+	start = I2C0->now;
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_WHO_AM_I, &value, 1) == I2C_OK &&
+			value == MMA_MODEL_WHO_AM_I);
+	test_check(I2C0->counts.faults == 1 && i2c_model_elapsed_us(I2C0, start) >= I2C_BYTE_TIMEOUT_US);
+	i2c_stats_get(I2C_BUS0, &stats);
+	test_check(stats.retries == 1 && stats.timeouts == 0 && stats.transactions == 1);
+
+	//The bus recovery clocks the slave out of its byte, the retry then gets the bus
+	i2c_stats_reset(I2C_BUS0);
+	i2c_model_hold_sda(I2C0, SDA_HOLD_CLOCKS);
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_WHO_AM_I, &value, 1) == I2C_OK &&
+			value == MMA_MODEL_WHO_AM_I);
+	i2c_stats_get(I2C_BUS0, &stats);
+	test_check(stats.retries == 1 && !i2c_model_sda_held(I2C0));
+
+	//A line that stays low is given up on after the bounded number of recoveries
+	i2c_stats_reset(I2C_BUS0);
+	i2c_model_hold_sda(I2C0, SDA_STUCK_CLOCKS);
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_WHO_AM_I, &value, 1) == I2C_ERR_BUSY);
+	i2c_stats_get(I2C_BUS0, &stats);
+	test_check(stats.retries == I2C_MAX_RETRIES && stats.other_errors == 1);
+	test_check(i2c_bus_recover() == I2C_ERR_BUSY);
+	i2c_model_hold_sda(I2C0, 0);
+	test_check(i2c_bus_recover() == I2C_OK);
+	test_check(i2c_read_burst(MMA_DEV_ADDR, MMA_REG_WHO_AM_I, &value, 1) == I2C_OK &&
+			value == MMA_MODEL_WHO_AM_I);
+	test_check(I2C0->counts.misuse == 0);
+}
+
+/*
+ * @Name		test_engine_timeout
+ * @Description	A transaction of the engine whose byte never completes is aborted at its
+ * 				deadline, by i2c_wait or by the SysTick watchdog when nobody waits for it, the
+ * 				bus is recovered and the engine goes on with the next transaction. The watchdog
+ * 				stops once the engine is idle
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_engine_timeout()
+{
+	i2c_stats_t stats;
+	uint8_t value = 0, next_value = 0;
+	i2c_xfer_t read = { .dev_addr = MMA_DEV_ADDR, .reg = MMA_REG_WHO_AM_I, .dir = I2C_READ, .buf = &value, .len = 1 };
+	i2c_xfer_t next = { .dev_addr = MMA_DEV_ADDR, .reg = MMA_REG_WHO_AM_I, .dir = I2C_READ, .buf = &next_value, .len = 1 };
+
+	board_reset();
+	i2c_engine_init();
+	i2c_model_stall(I2C0);
+	test_check(i2c_submit(&read) && i2c_submit(&next));
+	test_check(i2c_wait(&read) == I2C_ERR_TIMEOUT);
+	test_check(i2c_wait(&next) == I2C_OK && next_value == MMA_MODEL_WHO_AM_I);
+	i2c_stats_get(I2C_BUS0, &stats);
+	test_check(stats.timeouts == 1 && stats.transactions == 2);
+
+	//Submitted and never waited on, as by the data-ready interrupt or the scheduler
+	i2c_model_stall(I2C0);
+	test_check(i2c_submit(&read));
+	board_model_idle(WATCHDOG_WAIT_US);
+	test_check(read.done && read.status == I2C_ERR_TIMEOUT && !i2c_engine_busy());
+	test_check(!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk));
+	test_check(i2c_submit(&read) && i2c_wait(&read) == I2C_OK && value == MMA_MODEL_WHO_AM_I);
+	test_check(I2C0->counts.faults == 2 && I2C0->counts.misuse == 0);
+}
+
+/*
+ * @Name		test_driver
+ * @Description	The accelerometer driver on a posed device converting at its own rate: init_MMA,
+ * 				samples delivered by the data-ready interrupt, the roll angle, the fast-read mode
+ * 				and the FIFO drained at the watermark
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_driver()
+{
+	uint32_t received, lost, errors;
+	mma_sample_t sample = { 0 };
+	int32_t angle = 0;
+	uint8_t drained = 0;
+
+	board_reset();
+	mma_model_pose(&host_mma, 0, ROLL_Y_MG, ROLL_Z_MG, 0);
+	i2c_engine_init();
+	test_check(init_MMA() == INIT_SUCCESS);
+
+	//The read init_MMA queues in case INT1 was left asserted finds no sample yet
+	test_check(mma_acquire(&sample) == I2C_OK && !(sample.status & MMA_STATUS_ZYXDR));
+	test_check(mma_acquire(&sample) == I2C_OK && (sample.status & MMA_STATUS_ZYXDR));
+	test_check(sample.x == 0 && sample.y == ROLL_Y_MG * MMA_COUNTS_PER_G / 1000 &&
+			sample.z == ROLL_Z_MG * MMA_COUNTS_PER_G / 1000);
+	test_check(compute_angle_cdeg(&angle) == I2C_OK &&
+			angle >= ROLL_CDEG - ROLL_TOLERANCE_CDEG && angle <= ROLL_CDEG + ROLL_TOLERANCE_CDEG);
+	mma_int_stats(&received, &lost, &errors);
+	test_check(received >= 2 && lost == 0 && errors == 0);
+
+	test_check(mma_set_fast_read(true) == I2C_OK && mma_acquire(&sample) == I2C_OK);
+	test_check(sample.z == ROLL_Z_MG * MMA_COUNTS_PER_G / 1000 / MMA_FAST_READ_SCALE * MMA_FAST_READ_SCALE);
+	test_check(mma_set_fast_read(false) == I2C_OK);
+
+	test_check(mma_fifo_config(MMA_FIFO_CIRCULAR, TEST_WATERMARK) == I2C_OK);
+	board_model_idle(US_PER_S / 100);
+	test_check(mma_fifo_poll(&drained) == I2C_OK && drained >= TEST_WATERMARK);
+	test_check(mma_acquire(&sample) == I2C_OK && sample.y == ROLL_Y_MG * MMA_COUNTS_PER_G / 1000);
+	test_check(mma_fifo_overflows() == 0 && I2C0->counts.misuse == 0);
+}
+
+/*
+ * @Name		test_self_test
+ * @Description	mma_self_test on the accelerometer model lying flat: a healthy device passes with
+ * 				the typical output change, an axis stuck by a sensing element fault and a Z
+ * 				output pushed to the end of the range by the actuation fail with their verdicts.
+ * 				The settings are restored after each run
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_self_test()
+{
+	mma_selftest_t result;
+	uint8_t ctrl_reg1;
+
+	board_reset();
+	mma_model_pose(&host_mma, 0, 0, MG_PER_G, ST_NOISE);
+	i2c_engine_init();
+	test_check(init_MMA() == INIT_SUCCESS);
+	ctrl_reg1 = mma_model_peek(&host_mma, MMA_REG_CTRL_REG1);
+
+	test_check(mma_self_test(&result) == I2C_OK && result.pass);
+	test_check(result.delta[0] >= SELFTEST_DELTA_X - ST_NOISE && result.delta[0] <= SELFTEST_DELTA_X + ST_NOISE &&
+			result.delta[1] >= SELFTEST_DELTA_Y - ST_NOISE && result.delta[1] <= SELFTEST_DELTA_Y + ST_NOISE &&
+			result.delta[2] >= SELFTEST_DELTA_Z - ST_NOISE && result.delta[2] <= SELFTEST_DELTA_Z + ST_NOISE);
+	test_check(mma_model_peek(&host_mma, MMA_REG_CTRL_REG1) == ctrl_reg1 &&
+			!(mma_model_peek(&host_mma, MMA_REG_CTRL_REG2) & CTRL_REG2_ST));
+
+	mma_model_stick(&host_mma, MMA_AXIS_Y);
+	test_check(mma_self_test(&result) == I2C_OK && !result.pass);
+	test_check(result.stuck[1] && !result.delta_ok[1] && !result.stuck[0] && !result.stuck[2] &&
+			result.delta_ok[0] && result.delta_ok[2]);
+	mma_model_stick(&host_mma, 0);
+
+	mma_model_pose(&host_mma, 0, 0, ST_SATURATED_Z_MG, ST_NOISE);
+	test_check(mma_self_test(&result) == I2C_OK && !result.pass);
+	test_check(result.saturated[2] && !result.saturated[0] && !result.saturated[1] && !result.stuck[2]);
+
+	//Leave the engine idle for the polled transfers of the tests that follow
+	test_check(mma_int_enable(false) == I2C_OK);
+	while(i2c_engine_busy())
+		timebase_now();
+	test_check(I2C0->counts.misuse == 0);
+}
+
+/*
+ * @Name		round_counts
+ * @Description	Rounds a value of the floating point reference to the nearest count
+ *
+ * @parameters	double - value
+ * @Returns		long - rounded value, halves away from zero
+ */
+static long round_counts(double value)
+{
+	return (long)(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+/*
+ * @Name		test_lowpass
+ * @Description	The fixed-point low-pass stage against a floating point reference of the same
+ * 				sections: the coefficient against w / (1 + w), then a noisy step through one and
+ * 				through two sections, every output within the rounding of the reference. Invalid
+ * 				settings are rejected
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_lowpass()
+{
+	lowpass_t filter;
+	mma_sample_t sample;
+	double w = 2 * PI * LPF_CUTOFF_MHZ / LPF_RATE_MHZ, alpha, input;
+	double reference[LOWPASS_MAX_ORDER][MMA_AXES];
+	int16_t step[MMA_AXES] = {-ONE_G_COUNTS, ONE_G_COUNTS / 2, ONE_G_COUNTS};
+	int16_t *out[MMA_AXES] = {&sample.x, &sample.y, &sample.z};
+	int32_t noise;
+	bool match;
+
+	test_check(labs(round_counts(w / (1 + w) * Q15_ONE) - lowpass_alpha(LPF_CUTOFF_MHZ, LPF_RATE_MHZ)) <= 1);
+
+	for(int order = 1; order <= LOWPASS_MAX_ORDER; order++)
+	{
+		//Primed at zero, then the step with a pattern of noise on every axis
+		test_check(lowpass_config(&filter, order, LPF_CUTOFF_MHZ, LPF_RATE_MHZ));
+		alpha = filter.alpha / Q15_ONE;
+		memset(reference, 0, sizeof(reference));
+		sample = (mma_sample_t){0};
+		lowpass_apply(&filter, &sample);
+		match = true;
+		for(int i = 0; i < LPF_SAMPLES; i++)
+		{
+			noise = (i * LPF_NOISE_STRIDE) % (2 * LPF_NOISE + 1) - LPF_NOISE;
+			sample = (mma_sample_t){.x = step[0] + noise, .y = step[1] - noise, .z = step[2] + noise};
+			lowpass_apply(&filter, &sample);
+			for(int axis = 0; axis < MMA_AXES; axis++)
+			{
+				input = step[axis] + (axis == 1 ? -noise : noise);
+				for(int section = 0; section < order; section++)
+				{
+					reference[section][axis] += alpha * (input - reference[section][axis]);
+					input = reference[section][axis];
+				}
+				if(labs(*out[axis] - round_counts(input)) > LPF_TOL)
+					match = false;
+			}
+		}
+		test_check(match);
+	}
+
+	test_check(!lowpass_config(&filter, 1, LPF_RATE_MHZ / 2, LPF_RATE_MHZ) &&
+			!lowpass_config(&filter, LOWPASS_MAX_ORDER + 1, LPF_CUTOFF_MHZ, LPF_RATE_MHZ));
+}
+
+/*
+ * @Name		test_timing
+ * @Description	The SCL rate follows F through the divider table and a read takes 9 SCL periods
+ * 				per byte plus the register accesses between the bytes
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_timing()
+{
+	uint8_t raw[STATUS_XYZ_BYTES];
+	uint64_t start;
+	uint32_t us, expect_us = (3 + STATUS_XYZ_BYTES) * I2C_MODEL_BYTE_BITS * US_PER_S / I2C_SCL_HZ;
+
+	board_reset();
+	test_check(i2c_model_scl_hz(I2C0) == I2C_SCL_HZ);
+	start = I2C0->now;
+	i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, raw, STATUS_XYZ_BYTES);
+	us = i2c_model_elapsed_us(I2C0, start);
+	test_check(us >= expect_us && us <= expect_us + TIME_SLACK_US);
+}
+
+/*
+ * @Name		report_costs
+ * @Description	Prints the register accesses, polls of S, bus time and bytes of the polled and
+ * 				interrupt paths for the common transfers, the numbers to compare when a driver
+ * 				change touches these paths
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void report_costs()
+{
+	static uint8_t buf[BLOCK_BYTES];
+	static const struct
+	{
+		const char *name;
+		uint8_t reg;
+		uint16_t len;
+	} ops[] = {
+		{ "WHO_AM_I", MMA_REG_WHO_AM_I, 1 },
+		{ "STATUS+XYZ", MMA_REG_STATUS, STATUS_XYZ_BYTES },
+		{ "FIFO block", MMA_REG_OUT_X_MSB, BLOCK_BYTES },
+	};
+	i2c_xfer_t xfer;
+	uint64_t start;
+	uint32_t us;
+
+	printf("%-12s %-7s %8s %8s %8s %6s %6s\n", "operation", "path", "accesses", "S reads", "D", "bytes", "us");
+	for(unsigned int i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+	{
+		board_reset();
+		start = I2C0->now;
+		i2c_read_burst(MMA_DEV_ADDR, ops[i].reg, buf, ops[i].len);
+		us = i2c_model_elapsed_us(I2C0, start);
+		printf("%-12s %-7s %8u %8u %8u %6u %6u\n", ops[i].name, "polled", i2c_model_accesses(&I2C0->counts),
+				I2C0->counts.reads[I2C_MODEL_S], I2C0->counts.reads[I2C_MODEL_D] + I2C0->counts.writes[I2C_MODEL_D],
+				I2C0->counts.bytes, us);
+
+		board_reset();
+		i2c_engine_init();
+		i2c_model_counts_reset(I2C0);
+		xfer = (i2c_xfer_t){ .dev_addr = MMA_DEV_ADDR, .reg = ops[i].reg, .dir = I2C_READ, .buf = buf, .len = ops[i].len };
+		start = I2C0->now;
+		i2c_submit(&xfer);
+		i2c_wait(&xfer);
+		us = i2c_model_elapsed_us(I2C0, start);
+		printf("%-12s %-7s %8u %8u %8u %6u %6u\n", ops[i].name, "irq", i2c_model_accesses(&I2C0->counts),
+				I2C0->counts.reads[I2C_MODEL_S], I2C0->counts.reads[I2C_MODEL_D] + I2C0->counts.writes[I2C_MODEL_D],
+				I2C0->counts.bytes, us);
+	}
+}
+
+int main()
+{
+	test_transfers();
+	test_rsta_errata();
+	test_data_ready();
+	test_fifo();
+	test_engine();
+	test_recovery();
+	test_engine_timeout();
+	test_driver();
+	test_self_test();
+	test_lowpass();
+	test_timing();
+	report_costs();
+
+	printf("I2C0 and MMA8451Q models : passed %d/%d test cases\n", g_total_test_pass, g_total_test);
+	return g_total_test_pass == g_total_test ? 0 : 1;
+}
@@ -24,8 +24,16 @@
 #include "LEDs.h"
 #include "mma8451.h"
 #include <MKL25Z4.h>
+#ifdef DEBUG
 #include <math.h>
+#endif
 #include "extra_switch.h"
+#include "i2c.h"
+#include "i2c_sched.h"
+#include "angle.h"
+#include "timebase.h"
+#include "lowpass.h"
+#include "decimate.h"
 
 //MACROS
 #define LEN_MAX (640)
@@ -35,6 +43,26 @@
 #define CMD_ARG (0)
 #define FOUND (0)
 #define NO_COMMAND (0)
+#define BENCH_DEFAULT_LEN (192)		//A full MMA8451 FIFO, 32 samples of 6 bytes
+#define BENCH_MAX_LEN (256)
+#define SCHED_STATUS_LEN (2)			//INT_SOURCE and WHO_AM_I
+#define US_PER_MHZ_PERIOD (1000000000U)	//Period in us times the rate in mHz
+#define CDEG_TEXT_LEN (12)				//"-180.00" and the terminator, with margin
+#define CDEG_PER_TENTH (10)
+#define ANGLE_MAX_TENTHS (1800)
+#define CDEG_HALF_TURN (18000)
+#define ATAN_BENCH_POINTS (360)		//One point per degree over the full circle
+#define ATAN_BENCH_RADIUS (4096)		//1 g in the +/-2 g range
+#define MDEG_PER_DEG (1000)
+#define MHZ_PER_TENTH_HZ (100)
+#define UG_PER_G (1000000U)
+#define MILLI_TEXT_LEN (12)			//"4294967.295" and the terminator
+#define MDEG_PER_RAD (57296U)
+#define NOISE_SCALE_MAX (8)				//Radicand scaled by up to 4^8, 8 more bits in the root
+#define ROOT_SCALE (1000U)				//sqrt(n) taken in thousandths
+#define EVENT_MOTION_THS (8)			//0.5 g in steps of 0.063 g
+#define EVENT_TRANSIENT_THS (4)			//0.25 g past the high-pass filter
+#define EVENT_PL_DEBOUNCE (5)			//Samples a new orientation must hold
 
 //Prototype for command handler functions
 typedef void (*command_handler_t)(int, char *argv[]);
@@ -42,9 +70,148 @@ typedef struct
 {
 	   const char *name;
 	   command_handler_t handler;
+	   int min_args;			//Arguments accepted after the command name
+	   int max_args;
 	   const char *help_string;
 } command_table_t;
 
+static void help(int argc,char *argv[]);
+
+//Default settings of the accelerometer detectors, used by the events and sleep commands
+static const mma_detect_cfg_t motion_cfg={MMA_AXIS_X|MMA_AXIS_Y,EVENT_MOTION_THS,2};
+static const mma_detect_cfg_t transient_cfg={MMA_AXIS_X|MMA_AXIS_Y|MMA_AXIS_Z,EVENT_TRANSIENT_THS,1};
+
+//Software zero of the gauge: roll of the pose touched last in centi-degrees, shared by every mode
+static int32_t zero_cdeg=0;
+
+/*
+ * @Name		format_cdeg
+ * @Description	Formats a centi-degree angle as degrees with two decimals, in integer arithmetic
+ *
+ * @parameters	char*, int32_t - buffer of CDEG_TEXT_LEN bytes, angle in centi-degrees
+ *
+ * @Returns		char* - the buffer
+ */
+static char *format_cdeg(char *text,int32_t cdeg)
+{
+	uint32_t magnitude=(cdeg<0) ? -cdeg : cdeg;
+
+	snprintf(text,CDEG_TEXT_LEN,"%s%lu.%02lu",(cdeg<0) ? "-" : "",magnitude/ANGLE_CDEG,
+			magnitude%ANGLE_CDEG);
+	return text;
+}
+
+/*
+ * @Name		format_milli
+ * @Description	Formats a value in thousandths of a unit with three decimals, in integer arithmetic
+ *
+ * @parameters	char*, uint32_t - buffer of MILLI_TEXT_LEN bytes, value in thousandths
+ *
+ * @Returns		char* - the buffer
+ */
+static char *format_milli(char *text,uint32_t milli)
+{
+	snprintf(text,MILLI_TEXT_LEN,"%lu.%03lu",milli/1000,milli%1000);
+	return text;
+}
+
+/*
+ * @Name		noise_ug
+ * @Description	Standard deviation of a decimation noise figure in micro-g. The variance is scaled
+ *				up as far as 32 bits allow before the integer root, so small figures keep their
+ *				resolution
+ *
+ * @parameters	uint32_t - variance in counts^2 with DECIMATE_VAR_Q fraction bits
+ *				uint32_t - counts per g of the range
+ *
+ * @Returns		uint32_t - noise in micro-g
+ */
+static uint32_t noise_ug(uint32_t variance,uint32_t counts_per_g)
+{
+	int shift=0;
+
+	while(variance && variance<(1UL<<30) && shift<NOISE_SCALE_MAX)
+	{
+		variance<<=2;
+		shift++;
+	}
+	return (uint64_t)angle_isqrt(variance)*UG_PER_G/(counts_per_g<<(DECIMATE_VAR_Q/2+shift));
+}
+
+/*
+ * @Name		to_tenths
+ * @Description	Rounds a centi-degree angle to the 0.1 degree resolution the gauge modes compare at
+ *
+ * @parameters	int32_t - angle in centi-degrees
+ *
+ * @Returns		int32_t - angle in tenths of a degree
+ */
+static int32_t to_tenths(int32_t cdeg)
+{
+	return (cdeg>=0) ? (cdeg+CDEG_PER_TENTH/2)/CDEG_PER_TENTH : (cdeg-CDEG_PER_TENTH/2)/CDEG_PER_TENTH;
+}
+
+/*
+ * @Name		parse_tenths
+ * @Description	Parses an angle in degrees with at most one decimal ("45", "45.5") without floating
+ *				point
+ *
+ * @parameters	const char*, int32_t* - the text, receives the angle in tenths of a degree
+ *
+ * @Returns		bool - false if the text is not such an angle
+ */
+static bool parse_tenths(const char *text,int32_t *tenths)
+{
+	char *ptr;
+	int32_t value=strtol(text,&ptr,10)*10;
+
+	if(ptr==text || *text=='-')
+		return false;
+	if(*ptr=='.')
+	{
+		ptr++;
+		if(!isdigit((unsigned char)*ptr))
+			return false;
+		value+=*ptr++-'0';
+	}
+	*tenths=value;
+	return *ptr=='\0';
+}
+
+/*
+ * @Name		gauge_angle
+ * @Description	Gets the roll of the board relative to the software zero. Touching the TSI
+ *				slider makes the current pose, whatever it is, the new zero. The sensor offsets
+ *				are only calibrated by the 'cal' command, with the board level. A failed read
+ *				gives no angle and leaves a touch pending for the next good one
+ *
+ * @parameters	int32_t* - receives the signed angle in centi-degrees, -18000 to 18000
+ *
+ * @Returns		bool - false if the accelerometer could not be read
+ */
+static bool gauge_angle(int32_t *angle)
+{
+	int32_t roll;
+	i2c_status_t status=compute_angle_cdeg(&roll);
+
+	TSI0->DATA |= TSI_DATA_SWTS_MASK;
+	if(status!=I2C_OK)
+		return false;
+	if(touch_val>100)
+	{
+		touch_val=0;
+		zero_cdeg=roll;
+	}
+
+	//The difference of two rolls wraps around at +/-180 degrees
+	*angle=roll-zero_cdeg;
+	if(*angle>CDEG_HALF_TURN)
+		*angle-=2*CDEG_HALF_TURN;
+	else if(*angle<-CDEG_HALF_TURN)
+		*angle+=2*CDEG_HALF_TURN;
+	return true;
+}
+
 
 
 /*
@@ -66,24 +233,16 @@ static void measure(int argc,char *argv[])
 {
 	//Initially the switch to terminate the measure functionality is false
 	switch_pressed=false;
-	//Initializing the angle and calibrated position as 0
-	int degree=0,set_value=0;
+	char text[CDEG_TEXT_LEN];
+	int32_t angle;
 
 	//Until switch is pressed, tilt sensor (accelerometer) measures the orientation and prints it
 	while(!switch_pressed)
 	{
-
-		int roll=compute_angle();
-//		convert_xyz_to_roll_pitch();
-		TSI0->DATA |= TSI_DATA_SWTS_MASK;
-		if(touch_val>100)
-		{
-			touch_val=0;
-			set_value=fabs(roll);
-		}
-
-		degree=fabs(roll)-set_value;
-		printf("Measured angle: %3d\r",degree);
+		if(gauge_angle(&angle))
+			printf("Measured angle: %7s\r",format_cdeg(text,angle));
+		else
+			printf("Measured angle:   error\r");
 	}
 	printf("\n\r");
 }
@@ -100,52 +259,44 @@ static void measure(int argc,char *argv[])
 static void user(int argc,char *argv[])
 {
 	switch_pressed=false;
-	int degree=0,set_value=0;
-	uint16_t user_angle=0;
-	char* ptr;
-	user_angle = strtol(argv[1],&ptr,10);
-	if(user_angle>180)
+	int32_t user_angle=0,angle;
+	if(!parse_tenths(argv[1],&user_angle) || user_angle>ANGLE_MAX_TENTHS)
 	{
 		printf("Invalid angle input\n\r");
 		return;
 	}
-	printf("Blue LED glows when the device is oriented at %d degrees\n\r",user_angle);
+	printf("Blue LED glows when the device is oriented at %ld.%ld degrees\n\r",user_angle/10,
+			user_angle%10);
 	while(!switch_pressed)
 	{
-		int roll=compute_angle();
-		TSI0->DATA |= TSI_DATA_SWTS_MASK;
-		if(touch_val>100)
-		{
-			touch_val=0;
-			set_value=fabs(roll);
-		}
-		degree=fabs(roll)-set_value;
-		Control_RGB_LEDs(0,0,0);
-		if(degree==user_angle)
+		//Red, as at start-up, while the accelerometer does not answer
+		if(!gauge_angle(&angle))
+			Control_RGB_LEDs(1,0,0);
+		else if(labs(to_tenths(angle))==user_angle)
 			Control_RGB_LEDs(0,0,1);
+		else
+			Control_RGB_LEDs(0,0,0);
 	}
 	Control_RGB_LEDs(0,0,0);
 }
 static void fixed(int argc,char *argv[])
 {
 	switch_pressed=false;
-	int degree=0,set_value=0;
+	int32_t tenths=0,angle;
 	printf("If device oriented at 45,60 or 90 degrees, LED lights with purple,cyan or brown respectively\n\r");
 	while(!switch_pressed)
 	{
-		int roll=compute_angle();
-		TSI0->DATA |= TSI_DATA_SWTS_MASK;
-		if(touch_val>100)
+		if(!gauge_angle(&angle))
 		{
-			touch_val=0;
-			set_value=fabs(roll);
+			Control_RGB_LEDs(1,0,0);
+			continue;
 		}
-		degree=fabs(roll)-set_value;
-		if(degree==45)
+		tenths=labs(to_tenths(angle));
+		if(tenths==450)
 			Control_RGB_LEDs(0,1,1);
-		else if(degree==60)
+		else if(tenths==600)
 			Control_RGB_LEDs(1,0,1);
-		else if(degree==90)
+		else if(tenths==900)
 			Control_RGB_LEDs(1,1,0);
 		else
 			Control_RGB_LEDs(0,0,0);
@@ -156,18 +307,16 @@ static void level(int argc,char *argv[])
 {
 	printf("Green LED indicates that the surface is level or plumb\n\r");
 	switch_pressed=false;
-	int degree=0,set_value=0;
+	int32_t tenths=0,angle;
 	while(!switch_pressed)
 	{
-		int roll=compute_angle();
-		TSI0->DATA |= TSI_DATA_SWTS_MASK;
-		if(touch_val>100)
+		if(!gauge_angle(&angle))
 		{
-			touch_val=0;
-			set_value=fabs(roll);
+			Control_RGB_LEDs(1,0,0);
+			continue;
 		}
-		degree=fabs(roll)-set_value;
-		if(degree==0 || degree==90)
+		tenths=labs(to_tenths(angle));
+		if(tenths==0 || tenths==900)
 			Control_RGB_LEDs(0,1,0);
 		else
 			Control_RGB_LEDs(0,0,0);
@@ -175,19 +324,103 @@ static void level(int argc,char *argv[])
 	Control_RGB_LEDs(0,0,0);
 }
 /*
- * @Name		help
- * @Description	Command Handler function for command help which prints out the
- *				description regarding each functionality to the user
+ * @Name		bench
+ * @Description	Handler function for the command 'bench' which reads a burst from the accelerometer
+ *				through the polled I2C path and through the DMA path and reports the CPU cycles
+ *				spent per byte on each. The optional argument is the burst length in bytes
  * @parameters	int, char*
  *
  * @Returns		None
  */
-static void help(int argc,char *argv[])
+static void bench(int argc,char *argv[])
+{
+	static uint8_t bench_buf[BENCH_MAX_LEN];
+	i2c_bench_t result;
+	long len=BENCH_DEFAULT_LEN;
+	char* ptr;
+
+	if(argc>1)
+		len=strtol(argv[1],&ptr,10);
+	if(len<I2C_DMA_MIN_LEN || len>BENCH_MAX_LEN)
+	{
+		printf("Burst length must be %d to %d bytes\n\r",I2C_DMA_MIN_LEN,BENCH_MAX_LEN);
+		return;
+	}
+	i2c_bench_rx(MMA_DEV_ADDR,MMA_REG_OUT_X_MSB,bench_buf,len,&result);
+	if(result.dma_status!=I2C_OK)
+	{
+		printf("DMA read failed with status %d\n\r",result.dma_status);
+		return;
+	}
+	printf("%d byte burst\n\r",result.len);
+	printf("  PIO : %lu CPU cycles, %lu per byte\n\r",result.pio_cpu_cycles,
+			result.pio_cpu_cycles/result.len);
+	printf("  DMA : %lu CPU cycles, %lu per byte (bus busy for %lu cycles)\n\r",
+			result.dma_cpu_cycles,result.dma_cpu_cycles/result.len,result.dma_bus_cycles);
+}
+
+/*
+ * @Name		regs
+ * @Description	Handler function for the command 'regs' which prints the accelerometer register
+ *				shadow: every cached control register with its value, dirty registers (changed
+ *				but not yet written to the device) are marked with '*'
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void regs(int argc,char *argv[])
 {
-	//Loop over all help commands and print the command name and equivalent help string
-	for(int i=0;i<argc;i++)
+	for(uint8_t reg=MMA_SHADOW_FIRST;reg<=MMA_SHADOW_LAST;reg++)
+	{
+		if(mma_reg_cached(reg))
+			printf("  0x%02X %-16s 0x%02X %s\n\r",reg,mma_reg_name(reg),mma_reg_read(reg),
+					mma_reg_dirty(reg) ? "*" : "");
+	}
+}
+
+/*
+ * @Name		trace
+ * @Description	Handler function for the command 'trace'. Without argument the I2C transaction
+ *				trace is dumped, oldest first, one transaction per line: timestamp in timebase ticks,
+ *				slave address with R/W bit, register, length, result and the stored data bytes.
+ *				'clear', 'on' and 'off' manage the recording and 'replay' serves the following
+ *				sensor reads from the trace instead of the bus
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void trace(int argc,char *argv[])
+{
+	i2c_trace_rec_t rec;
+	uint16_t count;
+
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"clear")==FOUND)
+			i2c_trace_clear();
+		else if(strcasecmp(argv[1],"on")==FOUND)
+			i2c_trace_enable(true);
+		else if(strcasecmp(argv[1],"off")==FOUND)
+			i2c_trace_enable(false);
+		else if(strcasecmp(argv[1],"replay")==FOUND)
+		{
+			i2c_trace_replay(true);
+			printf("Replaying %d transactions\n\r",i2c_trace_count());
+		}
+		else
+			printf("Unknown trace option '%s'\n\r",argv[1]);
+		return;
+	}
+
+	count=i2c_trace_count();
+	printf("%d transactions\n\r",count);
+	for(uint16_t i=0;i<count;i++)
 	{
-		printf("Command %s  :  %s\n\r",argv[i],argv[i+argc]);
+		i2c_trace_get(i,&rec);
+		printf("%10lu %02X %02X %3d %d :",rec.timestamp,rec.addr,rec.reg,rec.len,rec.result);
+		for(int j=0;j<rec.len && j<I2C_TRACE_DATA_MAX;j++)
+			printf(" %02X",rec.data[j]);
+		printf("\n\r");
 	}
 }
 
@@ -211,23 +444,714 @@ static void handle_unknown(char *argv[])
 	printf("\n\r");
 }
 
+//Scheduler load at the sample rate that leaves the device state alone: reading STATUS or the
+//output registers would clear ZYXDR and take the samples from the data-ready and FIFO paths,
+//reading SYSMOD would clear SRC_ASLP before the auto-sleep handler sees it
+static uint8_t sched_status[SCHED_STATUS_LEN];
+static i2c_job_t status_job={.xfer={.dev_addr=MMA_DEV_ADDR, .reg=MMA_REG_INT_SOURCE, .dir=I2C_READ,
+		.buf=sched_status, .len=SCHED_STATUS_LEN}, .bus=I2C_BUS0, .name="mma status", .priority=0};
+
+/*
+ * @Name		status_rate_changed
+ * @Description	Rate listener of the scheduler status job, keeps one read per sample period
+ *
+ * @parameters	uint32_t - accelerometer sample rate in mHz
+ *
+ * @Returns		None
+ */
+static void status_rate_changed(uint32_t rate_mhz)
+{
+	status_job.period_us=US_PER_MHZ_PERIOD/rate_mhz;
+}
+
+/*
+ * @Name		sched
+ * @Description	Handler function for the command 'sched' which prints the statistics of the jobs
+ * 				registered on the I2C scheduler. 'sched on' registers a job reading the
+ * 				accelerometer interrupt source and identity registers every sample period to
+ * 				exercise the scheduler, 'sched off' removes it
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void sched(int argc,char *argv[])
+{
+	static bool subscribed=false;
+	const i2c_job_t *job;
+
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"on")==FOUND)
+		{
+			if(!subscribed)
+				subscribed=mma_rate_subscribe(status_rate_changed);
+			if(!i2c_sched_add(&status_job))
+				printf("Status job not added\n\r");
+		}
+		else if(strcasecmp(argv[1],"off")==FOUND)
+			i2c_sched_remove(&status_job);
+		else
+			printf("Unknown sched option '%s'\n\r",argv[1]);
+		return;
+	}
+
+	printf("%d jobs\n\r",i2c_sched_count());
+	printf("%-12s bus prio period_us   runs errors misses worst_us\n\r","name");
+	for(uint8_t i=0;(job=i2c_sched_get(i))!=NULL;i++)
+	{
+		printf("%-12s %3d %4d %9lu %6lu %6lu %6lu %8lu\n\r",job->name ? job->name : "-",job->bus,
+				job->priority,job->period_us,job->runs,job->errors,job->misses,job->worst_us);
+	}
+}
+
+/*
+ * @Name		i2cstat
+ * @Description	Handler function for the command 'i2cstat' which prints the performance counters
+ * 				and the latency histogram of both I2C buses, 'i2cstat reset' clears them
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void i2cstat(int argc,char *argv[])
+{
+	i2c_stats_t stats;
+
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"reset")==FOUND)
+		{
+			for(int bus=0;bus<I2C_BUS_COUNT;bus++)
+				i2c_stats_reset((i2c_bus_t)bus);
+		}
+		else
+			printf("Unknown i2cstat option '%s'\n\r",argv[1]);
+		return;
+	}
+
+	for(int bus=0;bus<I2C_BUS_COUNT;bus++)
+	{
+		i2c_stats_get((i2c_bus_t)bus,&stats);
+		printf("I2C%d: %lu transactions, %lu bytes, %lu NACK, %lu timeout, %lu other, %lu retries,"\
+				" worst %lu us\n\r",bus,stats.transactions,stats.bytes,stats.nacks,stats.timeouts,
+				stats.other_errors,stats.retries,stats.worst_us);
+		for(int k=0;k<I2C_LAT_BUCKETS;k++)
+		{
+			if(stats.hist[k])
+				printf("  %6lu us+ : %lu\n\r",k ? (1UL<<k) : 0UL,stats.hist[k]);
+		}
+	}
+}
+
+/*
+ * @Name		fifo
+ * @Description	Handler function for the command 'fifo' which sets the accelerometer FIFO mode
+ * 				(off, circ or fill) and watermark, or prints the current setting and overflows
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void fifo(int argc,char *argv[])
+{
+	static const char *const mode_names[]={"off","circ","fill"};
+	uint8_t f_setup;
+	int watermark=MMA_FIFO_SIZE;
+	int mode;
+
+	if(argc>1)
+	{
+		for(mode=0;mode<3 && strcasecmp(argv[1],mode_names[mode])!=FOUND;mode++);
+		if(mode==3)
+		{
+			printf("Unknown fifo mode '%s'\n\r",argv[1]);
+			return;
+		}
+		if(argc>2)
+			watermark=atoi(argv[2]);
+		if(mma_fifo_config((mma_fifo_mode_t)mode,mode ? watermark : 0)!=I2C_OK)
+			printf("FIFO not configured (watermark 1..%d)\n\r",MMA_FIFO_SIZE);
+		return;
+	}
+
+	f_setup=mma_reg_read(MMA_REG_F_SETUP);
+	mode=f_setup>>MMA_F_SETUP_MODE_SHIFT;
+	printf("FIFO %s, watermark %d, %lu overflows\n\r",(mode<3) ? mode_names[mode] : "trigger",
+			f_setup&MMA_F_SETUP_WMRK_MASK,mma_fifo_overflows());
+}
+
+/*
+ * @Name		drdy
+ * @Description	Handler function for the command 'drdy' which turns the accelerometer data-ready
+ * 				interrupt on or off, or prints the samples read and lost through it
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void drdy(int argc,char *argv[])
+{
+	uint32_t received,lost,errors;
+
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"on")==FOUND)
+			mma_int_enable(true);
+		else if(strcasecmp(argv[1],"off")==FOUND)
+			mma_int_enable(false);
+		else
+			printf("Unknown drdy option '%s'\n\r",argv[1]);
+		return;
+	}
+
+	mma_int_stats(&received,&lost,&errors);
+	printf("%lu samples, %lu overwritten before read, %lu failed reads\n\r",received,lost,errors);
+}
+
+/*
+ * @Name		rate
+ * @Description	Handler function for the command 'rate' which selects the accelerometer output
+ * 				data rate in Hz (800 down to 1.56) and optionally the oversampling mode, or prints
+ * 				the current setting
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void rate(int argc,char *argv[])
+{
+	static const char *const odr_names[MMA_ODR_COUNT]={"800","400","200","100","50","12.5","6.25",
+			"1.56"};
+	static const char *const mods_names[MMA_MODS_COUNT]={"normal","lnlp","hires","lp"};
+	mma_odr_t odr;
+	mma_mods_t mods;
+	uint32_t rate_mhz;
+
+	rate_mhz=mma_get_rate(&odr,&mods);
+	if(argc>1)
+	{
+		for(odr=0;odr<MMA_ODR_COUNT && strcmp(argv[1],odr_names[odr])!=FOUND;odr++);
+		if(argc>2)
+			for(mods=0;mods<MMA_MODS_COUNT && strcasecmp(argv[2],mods_names[mods])!=FOUND;mods++);
+		if(odr==MMA_ODR_COUNT || mods==MMA_MODS_COUNT)
+		{
+			printf("Unknown rate or mode\n\r");
+			return;
+		}
+		if(mma_set_rate(odr,mods)!=I2C_OK)
+			printf("Rate not changed\n\r");
+		return;
+	}
+
+	printf("ODR %s Hz (%lu mHz), %s oversampling\n\r",odr_names[odr],rate_mhz,mods_names[mods]);
+}
+
+/*
+ * @Name		tilt
+ * @Description	Handler function for the command 'tilt' which takes one accelerometer sample and
+ * 				prints its axes with the roll, pitch and 3D inclination of the board
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void tilt(int argc,char *argv[])
+{
+	mma_sample_t sample;
+	char roll[CDEG_TEXT_LEN],pitch[CDEG_TEXT_LEN],inclination[CDEG_TEXT_LEN];
+
+	if(mma_acquire_decimated(&sample)!=I2C_OK)
+	{
+		printf("Accelerometer read failed\n\r");
+		return;
+	}
+	printf("x %d y %d z %d status %02X at %lu\n\r",sample.x,sample.y,sample.z,sample.status,
+			sample.timestamp);
+	printf("roll %s pitch %s inclination %s degrees\n\r",format_cdeg(roll,angle_roll_cdeg(&sample)),
+			format_cdeg(pitch,angle_pitch_cdeg(&sample)),
+			format_cdeg(inclination,angle_inclination_cdeg(&sample)));
+}
+
+/*
+ * @Name		fastread
+ * @Description	Handler function for the command 'fread' which switches the accelerometer between
+ * 				the 8-bit fast-read mode and full resolution, or prints the current mode
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void fastread(int argc,char *argv[])
+{
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"on")==FOUND)
+			mma_set_fast_read(true);
+		else if(strcasecmp(argv[1],"off")==FOUND)
+			mma_set_fast_read(false);
+		else
+			printf("Unknown fread option '%s'\n\r",argv[1]);
+		return;
+	}
+	printf("%s, %d bytes per sample\n\r",mma_fast_read() ? "8-bit fast-read" : "14-bit full resolution",
+			mma_fast_read() ? MMA_FAST_SAMPLE_BYTES : MMA_SAMPLE_BYTES);
+}
+
+/*
+ * @Name		cal
+ * @Description	Handler function for the command 'cal' which calibrates the accelerometer offsets
+ * 				with the board level and prints them with the residual error, 'cal clear' removes
+ * 				the calibration. Both restart the gauge from the level pose (software zero 0)
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void cal(int argc,char *argv[])
+{
+	mma_cal_result_t result;
+	char zero[CDEG_TEXT_LEN];
+	int32_t angle;
+
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"clear")==FOUND)
+		{
+			mma_calibrate_clear();
+			zero_cdeg=0;
+		}
+		else
+			printf("Unknown cal option '%s'\n\r",argv[1]);
+		return;
+	}
+
+	mma_calibrate_zero(&result);
+	zero_cdeg=0;
+	if(result.status!=I2C_OK)
+	{
+		printf("Calibration failed, I2C error %d\n\r",result.status);
+		return;
+	}
+	if(!result.in_range)
+		printf("Pose out of the offset register range, offsets unchanged\n\r");
+	printf("Offsets X %d Y %d Z %d (2 mg), residual X %d Y %d Z %d mg\n\r",
+			result.offset[0],result.offset[1],result.offset[2],result.residual_mg[0],
+			result.residual_mg[1],result.residual_mg[2]);
+	if(compute_angle_cdeg(&angle)==I2C_OK)
+		printf("Level reads %s degrees\n\r",format_cdeg(zero,angle));
+	else
+		printf("Level not read, I2C error\n\r");
+}
+
+/*
+ * @Name		events
+ * @Description	Handler function for the command 'events' which turns the accelerometer motion,
+ * 				transient and orientation detectors on or off. Without an option the board sleeps
+ * 				until a detector interrupt and prints each decoded event, until the switch is pressed
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void events(int argc,char *argv[])
+{
+	static const char *const orientations[]={"portrait up","portrait down","landscape right",
+			"landscape left"};
+	mma_event_t event;
+	bool enable;
+
+	if(argc>1)
+	{
+		enable=(strcasecmp(argv[1],"on")==FOUND);
+		if(!enable && strcasecmp(argv[1],"off")!=FOUND)
+		{
+			printf("Unknown events option '%s'\n\r",argv[1]);
+			return;
+		}
+		if(mma_motion_config(false,enable ? &motion_cfg : NULL)!=I2C_OK ||
+				mma_transient_config(enable ? &transient_cfg : NULL)!=I2C_OK ||
+				mma_orientation_config(enable,EVENT_PL_DEBOUNCE)!=I2C_OK)
+			printf("Detectors not configured\n\r");
+		return;
+	}
+
+	switch_pressed=false;
+	while(!switch_pressed)
+	{
+		//Sleep until INT2 or the switch interrupts
+		while(!mma_event_pending() && !switch_pressed)
+			__WFI();
+		if(!mma_event_get(&event))
+			continue;
+		printf("%lu:",event.timestamp);
+		if(event.sources & MMA_INT_EN_FF_MT)
+			printf(" motion%s%s%s",(event.ff_mt & MMA_FF_MT_SRC_XHE) ? " X" : "",
+					(event.ff_mt & MMA_FF_MT_SRC_YHE) ? " Y" : "",
+					(event.ff_mt & MMA_FF_MT_SRC_ZHE) ? " Z" : "");
+		if(event.sources & MMA_INT_EN_TRANS)
+			printf(" transient%s%s%s",(event.transient & MMA_TRANSIENT_SRC_XE) ? " X" : "",
+					(event.transient & MMA_TRANSIENT_SRC_YE) ? " Y" : "",
+					(event.transient & MMA_TRANSIENT_SRC_ZE) ? " Z" : "");
+		if(event.sources & MMA_INT_EN_LNDPRT)
+			printf(" %s, %s",orientations[event.orientation],event.back ? "back" : "front");
+		if(event.sources & MMA_INT_EN_ASLP)
+			printf(" %s",event.asleep ? "sleep" : "wake");
+		printf("\n\r");
+	}
+}
+
+/*
+ * @Name		autosleep
+ * @Description	Handler function for the command 'sleep' which enables accelerometer auto-sleep
+ * 				after the given idle time in ms, at the given sleep rate, woken by the transient
+ * 				detector; 'sleep off' disables it. Without an option the rate in effect is printed
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void autosleep(int argc,char *argv[])
+{
+	static const char *const aslp_names[MMA_ASLP_COUNT]={"50","12.5","6.25","1.56"};
+	mma_autosleep_cfg_t cfg={0,MMA_ASLP_1_56HZ,MMA_MODS_LOW_POWER,MMA_INT_EN_TRANS};
+	i2c_status_t status;
+
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"off")==FOUND)
+		{
+			mma_autosleep_config(NULL);
+			return;
+		}
+		cfg.idle_ms=atoi(argv[1]);
+		if(argc>2)
+			for(cfg.sleep_odr=0;cfg.sleep_odr<MMA_ASLP_COUNT &&
+					strcmp(argv[2],aslp_names[cfg.sleep_odr])!=FOUND;cfg.sleep_odr++);
+		status=mma_transient_config(&transient_cfg);
+		if(status==I2C_OK)
+			status=mma_autosleep_config(&cfg);
+		if(status!=I2C_OK)
+			printf("Auto-sleep not enabled, idle time is 320 ms steps up to 81600 ms\n\r");
+		return;
+	}
+
+	printf("%s, sampling at %lu mHz\n\r",mma_asleep() ? "Asleep" : "Awake",mma_effective_rate());
+}
+
+/*
+ * @Name		timing
+ * @Description	Handler function for the command 'timing' which prints the inter-sample jitter,
+ * 				the gaps and the drift against the nominal ODR of the accelerometer samples taken
+ * 				by interrupt or from the FIFO; 'timing reset' restarts the statistics
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void timing(int argc,char *argv[])
+{
+	sample_timing_t stats;
+
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"reset")==FOUND)
+			mma_timing_reset();
+		else
+			printf("Unknown timing option '%s'\n\r",argv[1]);
+		return;
+	}
+
+	mma_timing_get(&stats);
+	printf("%lu intervals, nominal period %lu us\n\r",stats.intervals,stats.period/TIMEBASE_US(1));
+	printf("Jitter min %ld max %ld mean %lu us\n\r",stats.jitter_min/(int32_t)TIMEBASE_US(1),
+			stats.jitter_max/(int32_t)TIMEBASE_US(1),sample_timing_jitter_mean(&stats)/TIMEBASE_US(1));
+	printf("%lu gaps, %lu samples missing, drift %ld ppm\n\r",stats.gaps,stats.missing,
+			sample_timing_drift_ppm(&stats));
+}
+
+/*
+ * @Name		selftest
+ * @Description	Handler function for the command 'selftest' which runs the accelerometer self-test
+ * 				and prints the per-axis output change and verdicts
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void selftest(int argc,char *argv[])
+{
+	static const char axis_names[]="XYZ";
+	mma_selftest_t result;
+
+	if(mma_self_test(&result)!=I2C_OK)
+	{
+		printf("Self-test failed, I2C error %d\n\r",result.status);
+		return;
+	}
+	for(int i=0;i<3;i++)
+		printf("%c change %d counts%s%s%s\n\r",axis_names[i],result.delta[i],
+				result.delta_ok[i] ? "" : ", out of limits",result.stuck[i] ? ", stuck" : "",
+				result.saturated[i] ? ", saturated" : "");
+	printf("Self-test %s in %lu us\n\r",result.pass ? "passed" : "FAILED",result.duration_us);
+}
+
+/*
+ * @Name		range
+ * @Description	Handler function for the command 'range' which selects the accelerometer full-scale
+ * 				range (2, 4 or 8 g) with 'hpf' for high-pass filtered outputs, or prints the range
+ * 				and the saturated samples of every axis
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void range(int argc,char *argv[])
+{
+	static const char *const range_names[MMA_RANGE_COUNT]={"2","4","8"};
+	uint32_t saturated[MMA_AXES];
+	mma_range_t fs;
+	bool hpf=false;
+
+	if(argc>1)
+	{
+		for(fs=0;fs<MMA_RANGE_COUNT && strcmp(argv[1],range_names[fs])!=FOUND;fs++);
+		if(argc>2)
+			hpf=(strcasecmp(argv[2],"hpf")==FOUND);
+		if(fs==MMA_RANGE_COUNT || (argc>2 && !hpf))
+		{
+			printf("Unknown range or option\n\r");
+			return;
+		}
+		if(mma_set_range(fs,hpf)!=I2C_OK)
+			printf("Range not changed\n\r");
+		return;
+	}
+
+	fs=mma_get_range(&hpf);
+	mma_saturation(saturated);
+	printf("+/-%s g, %d counts per g%s\n\r",range_names[fs],MMA_RANGE_COUNTS_PER_G(fs),
+			hpf ? ", high-pass filtered" : "");
+	printf("Saturated samples X %lu Y %lu Z %lu\n\r",saturated[0],saturated[1],saturated[2]);
+}
+
+#ifdef DEBUG
+/*
+ * @Name		atanbench
+ * @Description	Handler function for the command 'atanbench' which sweeps a 1 g vector over the full
+ * 				circle in 1 degree steps and compares the CPU cycles and the accuracy of the
+ * 				integer CORDIC atan2 with the libm double precision atan2. DEBUG builds only, so
+ * 				the release image does not link libm and the soft-float library
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void atanbench(int argc,char *argv[])
+{
+	static int16_t ys[ATAN_BENCH_POINTS],xs[ATAN_BENCH_POINTS];
+	static int32_t cordic[ATAN_BENCH_POINTS];
+	static double libm[ATAN_BENCH_POINTS];
+	uint32_t start,cordic_ticks,libm_ticks;
+	double error,worst=0;
+
+	for(int i=0;i<ATAN_BENCH_POINTS;i++)
+	{
+		double rad=(i-ATAN_BENCH_POINTS/2)*M_PI/180;
+		ys[i]=lround(ATAN_BENCH_RADIUS*sin(rad));
+		xs[i]=lround(ATAN_BENCH_RADIUS*cos(rad));
+	}
+
+	start=timebase_now();
+	for(int i=0;i<ATAN_BENCH_POINTS;i++)
+		cordic[i]=angle_atan2_q(ys[i],xs[i]);
+	cordic_ticks=timebase_now()-start;
+
+	start=timebase_now();
+	for(int i=0;i<ATAN_BENCH_POINTS;i++)
+		libm[i]=atan2(ys[i],xs[i])*180/M_PI;
+	libm_ticks=timebase_now()-start;
+
+	//Errors across the +/-180 seam wrap around
+	for(int i=0;i<ATAN_BENCH_POINTS;i++)
+	{
+		error=fabs((double)cordic[i]/ANGLE_Q_ONE-libm[i]);
+		if(error>180)
+			error=360-error;
+		if(error>worst)
+			worst=error;
+	}
+
+	printf("%d points over 360 degrees\n\r",ATAN_BENCH_POINTS);
+	printf("  CORDIC : %lu CPU cycles per atan2, worst error %d millidegrees\n\r",
+			cordic_ticks*TIMEBASE_CYCLES_PER_TICK/ATAN_BENCH_POINTS,(int)(worst*MDEG_PER_DEG+0.5));
+	printf("  libm   : %lu CPU cycles per atan2\n\r",libm_ticks*TIMEBASE_CYCLES_PER_TICK/ATAN_BENCH_POINTS);
+}
+#endif
+
+/*
+ * @Name		lpf
+ * @Description	Handler function for the command 'lpf' which sets the cutoff (0.1 Hz resolution) and
+ * 				the number of sections of the low-pass stage ahead of the angle conversion, turns
+ * 				it off, or prints the setting
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void lpf(int argc,char *argv[])
+{
+	int32_t tenths;
+	uint32_t cutoff_mhz;
+	uint8_t order=1;
+
+	if(argc>1)
+	{
+		if(strcasecmp(argv[1],"off")==FOUND)
+		{
+			mma_lowpass_config(0,0);
+			return;
+		}
+		if(argc>2)
+			order=atoi(argv[2]);
+		if(!parse_tenths(argv[1],&tenths) || order<1 || order>LOWPASS_MAX_ORDER ||
+				!mma_lowpass_config(order,tenths*MHZ_PER_TENTH_HZ))
+			printf("Cutoff must be below half the sample rate, 1 or %d sections\n\r",LOWPASS_MAX_ORDER);
+		return;
+	}
+
+	order=mma_lowpass_get(&cutoff_mhz);
+	if(order)
+		printf("Low-pass %lu.%lu Hz, %d section%s\n\r",cutoff_mhz/1000,cutoff_mhz%1000/MHZ_PER_TENTH_HZ,
+				order,order>1 ? "s" : "");
+	else
+		printf("Low-pass off\n\r");
+}
+
+/*
+ * @Name		decim
+ * @Description	Handler function for the command 'decim' which sets how many samples are averaged
+ * 				per angle, or prints the output rate and the noise of the raw samples and of the
+ * 				averaged ones in mg, with the roll noise it gives lying flat. Integer arithmetic
+ * 				only, the printf of the project has no floating point support
+ *
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void decim(int argc,char *argv[])
+{
+	static const char axis_names[MMA_AXES]={'X','Y','Z'};
+	char raw_text[MILLI_TEXT_LEN],out_text[MILLI_TEXT_LEN];
+	mma_decim_stats_t stats;
+	uint32_t counts_per_g,raw,out,roll_out=0;
+
+	if(argc>1)
+	{
+		if(!mma_decimation_config(atoi(argv[1])))
+			printf("Samples per angle must be 1 to %d\n\r",DECIMATE_MAX_N);
+		return;
+	}
+
+	mma_decimation_stats(&stats);
+	printf("%d sample%s per angle, %lu.%03lu Hz out\n\r",stats.n,stats.n>1 ? "s" : "",
+			stats.out_rate_mhz/1000,stats.out_rate_mhz%1000);
+	if(stats.blocks==0)
+	{
+		printf("No noise estimate, it needs 2 samples per angle or more\n\r");
+		return;
+	}
+
+	//The output noise is the raw one over sqrt(n), taken from the raw figure for resolution
+	counts_per_g=MMA_RANGE_COUNTS_PER_G(mma_get_range(NULL));
+	for(int axis=0;axis<MMA_AXES;axis++)
+	{
+		raw=noise_ug(stats.raw_var[axis],counts_per_g);
+		out=(uint64_t)raw*ROOT_SCALE/angle_isqrt((uint32_t)stats.n*ROOT_SCALE*ROOT_SCALE);
+		printf("  %c : %s mg raw, %s mg out\n\r",axis_names[axis],format_milli(raw_text,raw),
+				format_milli(out_text,out));
+		if(axis==1)
+			roll_out=out;
+	}
+	//Lying flat the roll is atan2(Y, Z): the Y noise over 1 g in radians
+	printf("Roll noise floor %s degrees over %lu blocks\n\r",
+			format_milli(out_text,(uint64_t)roll_out*MDEG_PER_RAD/UG_PER_G),stats.blocks);
+}
+
 //Alter the command table to include new commands
 //Steps to alter, include the command name as first argument of new structure element
 //Include the name of the handler function for the command as second argument
 //Include a string which describes the functionality of the command and display it
 //When user calls for help
 static const command_table_t commands[] = {
-		{"measure", measure,"Measures and displays instantaneous angle measurements on the"\
+		{"measure", measure,0,0,"Measures and displays instantaneous angle measurements on the"\
 				" terminal window"},
-		{"user", user,"Syntax: user <Arg1> ; \n\r\t\tBlue LED glows when the device "\
-				"is oriented at the angle (Arg1) input by the user"},
-		{"fixed",fixed,"LED glows with colors purple, brown or cyan to indicate that the device"\
+		{"user", user,1,1,"Syntax: user <Arg1> ; \n\r\t\tBlue LED glows when the device "\
+				"is oriented at the angle (Arg1, 0.1 degree resolution) input by the user"},
+		{"fixed",fixed,0,0,"LED glows with colors purple, brown or cyan to indicate that the device"\
 				" orientation is exactly at 45,60, or 90 degrees respectively"},
-		{"level",level,"green LED indicates the surface is perfectly level or plumb (horizontally flat)."\
+		{"level",level,0,0,"green LED indicates the surface is perfectly level or plumb (horizontally flat)."\
 						"\n\r\t\t(must be calibrated to 0 degree first)"},
-		{"help",help,"Provides information about all supported commands"},
+		{"bench",bench,0,1,"Syntax: bench [bytes] ; \n\r\t\tCompares CPU cycles per byte of the polled and"\
+				" DMA I2C receive paths"},
+		{"regs",regs,0,0,"Prints the accelerometer control register shadow, '*' marks registers"\
+				" not yet written to the device"},
+		{"trace",trace,0,1,"Syntax: trace [clear|on|off|replay] ; \n\r\t\tDumps the I2C transaction"\
+				" trace, or manages recording and replay of it"},
+		{"sched",sched,0,1,"Syntax: sched [on|off] ; \n\r\t\tPrints run time and deadline misses of the"\
+				" I2C scheduler jobs, or starts/stops a periodic accelerometer status job"},
+		{"i2cstat",i2cstat,0,1,"Syntax: i2cstat [reset] ; \n\r\t\tPrints the I2C transaction, byte and"\
+				" error counters and the latency histogram of both buses, or clears them"},
+		{"fifo",fifo,0,2,"Syntax: fifo [off|circ|fill] [watermark] ; \n\r\t\tSets the accelerometer"\
+				" FIFO mode, angles are then taken from blocks drained at the watermark"},
+		{"drdy",drdy,0,1,"Syntax: drdy [on|off] ; \n\r\t\tReads one sample per accelerometer data-ready"\
+				" interrupt, or prints the sample loss counters"},
+		{"rate",rate,0,2,"Syntax: rate [800|400|200|100|50|12.5|6.25|1.56] [normal|lnlp|hires|lp] ;"\
+				" \n\r\t\tSets the accelerometer output data rate and oversampling mode"},
+		{"tilt",tilt,0,0,"Prints one three-axis sample with its roll, pitch and inclination"},
+		{"fread",fastread,0,1,"Syntax: fread [on|off] ; \n\r\t\tSwitches the accelerometer to 8-bit fast-read"\
+				" samples (half the bus bytes) or back to full resolution"},
+		{"cal",cal,0,1,"Syntax: cal [clear] ; \n\r\t\tCalibrates the accelerometer zero in its offset"\
+				" registers with the board level and reports the residual error"},
+		{"events",events,0,1,"Syntax: events [on|off] ; \n\r\t\tEnables the accelerometer motion, transient"\
+				" and orientation detectors, or sleeps and prints their events until the switch"},
+		{"sleep",autosleep,0,2,"Syntax: sleep [off|<idle ms> [50|12.5|6.25|1.56]] ; \n\r\t\tLets the"\
+				" accelerometer drop to a low rate when idle and wake on motion"},
+		{"timing",timing,0,1,"Syntax: timing [reset] ; \n\r\t\tPrints the jitter, gaps and drift of the"\
+				" accelerometer sample timestamps against the nominal ODR"},
+		{"selftest",selftest,0,0,"Runs the accelerometer self-test and prints the output change of"\
+				" every axis against the datasheet limits"},
+		{"range",range,0,2,"Syntax: range [2|4|8] [hpf] ; \n\r\t\tSets the accelerometer full-scale range"\
+				" and high-pass output, or prints it with the saturation counts"},
+#ifdef DEBUG
+		{"atanbench",atanbench,0,0,"Compares the cycles and accuracy of the integer CORDIC atan2 with"\
+				" libm over the full circle"},
+#endif
+		{"lpf",lpf,0,2,"Syntax: lpf [off|<cutoff Hz> [1|2]] ; \n\r\t\tFilters the accelerometer samples"\
+				" with a fixed-point low-pass ahead of the angle conversion"},
+		{"decim",decim,0,1,"Syntax: decim [samples] ; \n\r\t\tAverages samples per angle, or prints the"\
+				" output rate and noise floor of the decimation"},
+		{"help",help,0,0,"Provides information about all supported commands"},
 };
 
+/*
+ * @Name		help
+ * @Description	Command Handler function for command help which prints out the
+ *				description regarding each functionality to the user
+ * @parameters	int, char*
+ *
+ * @Returns		None
+ */
+static void help(int argc,char *argv[])
+{
+	static const int num_commands =  sizeof(commands) / sizeof(command_table_t);
+	//Loop over all commands and print the command name and equivalent help string
+	for(int i=0;i<num_commands;i++)
+	{
+		printf("Command %s  :  %s\n\r",commands[i].name,commands[i].help_string);
+	}
+}
+
 
 /*
  * @Name		user_input
@@ -345,32 +1269,13 @@ void process_command(char *input)
 	   if (strcasecmp(argv[CMD_ARG], commands[i].name) == FOUND)
 	   {
 		   command_found=true;
-		   //For command user, if arguments more than 2,
-		   if((strcasecmp(argv[CMD_ARG], "user") == 0)&&(argc!=2))
-		   {
-			   printf("\n\rInvalid number of arguments to command '%s', refer help for correct"\
-					   " syntax\n\r",argv[CMD_ARG]);
-			   continue;
-		   }
-		   else if(!(strcasecmp(argv[CMD_ARG], "user") == 0)&&(argc>1))
+		   //Reject the command if the number of arguments after its name is out of range
+		   if((argc-1 < commands[i].min_args) || (argc-1 > commands[i].max_args))
 		   {
 			   printf("\n\rInvalid number of arguments to command '%s', refer help for correct"\
 					   " syntax\n\r",argv[CMD_ARG]);
 			   break;
 		   }
-		   //If command found is help command, pass the command names and handler strings
-		   //as arguments
-		   if (strcasecmp(argv[CMD_ARG], "help") == FOUND)
-		   {
-			   //First argument to function specifies the number of commands in the table
-			   argc=num_commands;
-			   //Include the commands and helper strings as arguments to help handler function
-			   for(int j=0;j<num_commands;j++)
-			   {
-				   argv[j]=(char*)commands[j].name;
-				   argv[j+num_commands]=(char*)commands[j].help_string;
-			   }
-		   }
 		   printf("\n\r");
 		   //Call the appropriate handler function
 		   if(command_found==true)
@@ -0,0 +1,204 @@
+/**
+ * @file    angle.c
+ * @brief   Pure integer conversion of accelerometer samples into roll, pitch and inclination
+ * 			angles
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Date	05/18/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include "angle.h"
+
+//MACROS
+#define CORDIC_ITERATIONS (16)
+#define CORDIC_SHIFT (14)				//Input scaling, the vector then grows by 1.65 at most
+#define HALF_TURN_Q (180 * ANGLE_Q_ONE)
+#define CORDIC_INPUT_MAX (INT16_MAX)	//Component range the scaling keeps within 32 bits, the
+#define CORDIC_INPUT_MIN (INT16_MIN)	//fold below turns INT16_MIN into 2^15 which still fits
+#define SQRT_SCALE_LIMIT (1UL << 28)	//Squared lengths are scaled up to here before the root
+#define SQRT_SCALE_MAX (14)				//Doublings the other component can take in 32 bits
+
+//atan(2^-i) in Q16 degrees, the rotation of every CORDIC iteration
+static const int32_t cordic_atan_q[CORDIC_ITERATIONS] = {
+		2949120, 1740967, 919879, 466945, 234379, 117304, 58666, 29335,
+		14668, 7334, 3667, 1833, 917, 458, 229, 115
+};
+
+/*
+ * @Name		cordic_atan2
+ * @Description	CORDIC vectoring kernel of angle_atan2_q, on 32-bit components. Components past
+ * 				the int16 range (vector lengths) are halved together first, the ratio is kept
+ *
+ * @parameters	int32_t, int32_t - y and x components
+ * @Returns		int32_t - atan2(y, x) in Q16 degrees
+ */
+static int32_t cordic_atan2(int32_t vy, int32_t vx)
+{
+	int32_t angle = 0, next_x;
+
+	if(vx == 0 && vy == 0)
+		return 0;
+	while(vx > CORDIC_INPUT_MAX || vx < CORDIC_INPUT_MIN || vy > CORDIC_INPUT_MAX ||
+			vy < CORDIC_INPUT_MIN)
+	{
+		vx /= 2;
+		vy /= 2;
+	}
+
+	//atan2(y, x) = atan2(-y, -x) +/- 180, so the vectoring only covers -90 to 90 degrees
+	if(vx < 0)
+	{
+		angle = (vy >= 0) ? HALF_TURN_Q : -HALF_TURN_Q;
+		vx = -vx;
+		vy = -vy;
+	}
+	vx <<= CORDIC_SHIFT;
+	vy <<= CORDIC_SHIFT;
+
+	//Rotate the vector onto the X axis, accumulating the rotations
+	for(int i = 0; i < CORDIC_ITERATIONS; i++)
+	{
+		if(vy > 0)
+		{
+			next_x = vx + (vy >> i);
+			vy -= vx >> i;
+			angle += cordic_atan_q[i];
+		}
+		else
+		{
+			next_x = vx - (vy >> i);
+			vy += vx >> i;
+			angle -= cordic_atan_q[i];
+		}
+		vx = next_x;
+	}
+	return angle;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t angle_isqrt(uint32_t value)
+{
+	uint32_t root = 0, bit = 1UL << 30;
+
+	while(bit > value)
+		bit >>= 2;
+	while(bit)
+	{
+		if(value >= root + bit)
+		{
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+			root >>= 1;
+		bit >>= 2;
+	}
+	return root;
+}
+
+/*
+ * @Name		q_to_cdeg
+ * @Description	Rounds a Q16 angle to the nearest centi-degree
+ *
+ * @parameters	int32_t - angle in Q16 degrees
+ * @Returns		int32_t - angle in centi-degrees
+ */
+static int32_t q_to_cdeg(int32_t angle)
+{
+	int32_t scaled = angle * ANGLE_CDEG;
+
+	return (scaled >= 0) ? (scaled + ANGLE_Q_ONE / 2) / ANGLE_Q_ONE :
+			(scaled - ANGLE_Q_ONE / 2) / ANGLE_Q_ONE;
+}
+
+/*
+ * @Name		magnitude
+ * @Description	Length of the vector of two axes, for an atan2 against a third component. A short
+ * 				vector is scaled up, along with the third component, before the square root so that
+ * 				its truncation does not cost angle resolution
+ *
+ * @parameters	int16_t, int16_t - the two components, in counts
+ * 				int32_t* - the third component, in counts, scaled in place
+ * @Returns		int32_t - the length, in the same scale as the third component
+ */
+static int32_t magnitude(int16_t a, int16_t b, int32_t *other)
+{
+	uint32_t squared = (uint32_t)((int32_t)a * a) + (uint32_t)((int32_t)b * b);
+	int shift = 0;
+
+	while(squared && squared < SQRT_SCALE_LIMIT && shift < SQRT_SCALE_MAX)
+	{
+		squared <<= 2;
+		shift++;
+	}
+	*other *= 1L << shift;
+	return angle_isqrt(squared);
+}
+
+/*
+ * See documentation in .h file
+ */
+int32_t angle_atan2_q(int16_t y, int16_t x)
+{
+	return cordic_atan2(y, x);
+}
+
+/*
+ * See documentation in .h file
+ */
+int32_t angle_roll_cdeg(const mma_sample_t *sample)
+{
+	//The ratio of the axes gives the angle whatever the sensitivity of the range, the counts
+	//go straight to the integer kernel
+	return q_to_cdeg(cordic_atan2(sample->y, sample->z));
+}
+
+/*
+ * See documentation in .h file
+ */
+int32_t angle_pitch_cdeg(const mma_sample_t *sample)
+{
+	int32_t x = -(int32_t)sample->x;
+	int32_t length = magnitude(sample->y, sample->z, &x);
+
+	return q_to_cdeg(cordic_atan2(x, length));
+}
+
+/*
+ * See documentation in .h file
+ */
+int32_t angle_inclination_cdeg(const mma_sample_t *sample)
+{
+	int32_t z = sample->z;
+	int32_t length = magnitude(sample->x, sample->y, &z);
+
+	return q_to_cdeg(cordic_atan2(length, z));
+}
+
+/*
+ * See documentation in .h file
+ */
+int angle_roll(const mma_sample_t *sample)
+{
+	return angle_roll_cdeg(sample) / ANGLE_CDEG;
+}
+
+/*
+ * See documentation in .h file
+ */
+int angle_pitch(const mma_sample_t *sample)
+{
+	return angle_pitch_cdeg(sample) / ANGLE_CDEG;
+}
+
+/*
+ * See documentation in .h file
+ */
+int angle_inclination(const mma_sample_t *sample)
+{
+	return angle_inclination_cdeg(sample) / ANGLE_CDEG;
+}
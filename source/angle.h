@@ -0,0 +1,114 @@
+/*
+ * angle.h
+ *
+ * Created on: 18-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef ANGLE_H_
+#define ANGLE_H_
+
+/*
+ * Conversion of accelerometer samples into orientation angles. The functions only compute from
+ * the sample they are given and touch no hardware, so the same code serves every acquisition
+ * path (polled, data-ready interrupt, FIFO blocks) and builds on a Linux host as well. The
+ * conversion is integer only (CORDIC and integer square root), the angles come in centi-degrees,
+ * within 0.01 degree of the floating point formulas, and as whole degrees truncated from them.
+ *
+ * Axes as on the FRDM-KL25Z: X along the long edge of the board, Y across it, Z out of the
+ * component side. Angles follow the roll-pitch (xyz) sequence, in which the roll does not
+ * depend on the pitch of the board.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include "mma8451.h"
+
+//MACROS
+#define ANGLE_CDEG (100)				//Centi-degrees per degree
+#define ANGLE_Q (16)					//Fraction bits of the fixed-point angles
+#define ANGLE_Q_ONE (1L << ANGLE_Q)		//One degree in Q16
+#define ANGLE_ATAN2_MAX_ERR_Q (ANGLE_ATAN2_MAX_ERR_MDEG * ANGLE_Q_ONE / 1000)
+#define ANGLE_ATAN2_MAX_ERR_MDEG (2)	//Largest error of angle_atan2_q against libm, millidegrees
+
+/*
+ * @Name		angle_atan2_q
+ * @Description	Integer CORDIC atan2 for the FPU-less Cortex-M0+: 16 vectoring iterations on the
+ * 				counts scaled up by 2^14, after folding the left half-plane onto the right one.
+ * 				Uses shifts, adds and a 16 entry table only. The error against libm atan2 stays
+ * 				below ANGLE_ATAN2_MAX_ERR_MDEG (1.9 millidegrees measured) over the full circle
+ * 				for vectors of 8 counts or more, 4.4 millidegrees for the shortest ones
+ *
+ * @parameters	int16_t, int16_t - y and x components, in counts
+ * @Returns		int32_t - atan2(y, x) in Q16 degrees, -180 to 180; 0 for the null vector
+ */
+int32_t angle_atan2_q(int16_t y, int16_t x);
+
+/*
+ * @Name		angle_isqrt
+ * @Description	Integer square root, bit by bit, for the vector lengths here and the other integer
+ * 				only conversions (noise figures)
+ *
+ * @parameters	uint32_t - the radicand
+ * @Returns		uint32_t - floor of the square root
+ */
+uint32_t angle_isqrt(uint32_t value);
+
+/*
+ * @Name		angle_roll_cdeg
+ * @Description	Rotation of the board about its long (X) axis, atan2(Y, Z). Covers the full circle,
+ * 				0 lying flat with the components up
+ *
+ * @parameters	const mma_sample_t* - the sample
+ * @Returns		int32_t - roll in centi-degrees, -18000 to 18000
+ */
+int32_t angle_roll_cdeg(const mma_sample_t *sample);
+
+/*
+ * @Name		angle_pitch_cdeg
+ * @Description	Rotation of the board about its short (Y) axis, atan2(-X, sqrt(Y^2 + Z^2)). Positive
+ * 				when the end of the board towards +X rises
+ *
+ * @parameters	const mma_sample_t* - the sample
+ * @Returns		int32_t - pitch in centi-degrees, -9000 to 9000
+ */
+int32_t angle_pitch_cdeg(const mma_sample_t *sample);
+
+/*
+ * @Name		angle_inclination_cdeg
+ * @Description	3D inclination: angle between the Z axis and the vertical, whatever the direction of
+ * 				the tilt, atan2(sqrt(X^2 + Y^2), Z)
+ *
+ * @parameters	const mma_sample_t* - the sample
+ * @Returns		int32_t - inclination in centi-degrees, 0 (flat) to 18000 (upside down)
+ */
+int32_t angle_inclination_cdeg(const mma_sample_t *sample);
+
+/*
+ * @Name		angle_roll
+ * @Description	angle_roll_cdeg truncated to whole degrees
+ *
+ * @parameters	const mma_sample_t* - the sample
+ * @Returns		int - roll in degrees, -180 to 180
+ */
+int angle_roll(const mma_sample_t *sample);
+
+/*
+ * @Name		angle_pitch
+ * @Description	angle_pitch_cdeg truncated to whole degrees
+ *
+ * @parameters	const mma_sample_t* - the sample
+ * @Returns		int - pitch in degrees, -90 to 90
+ */
+int angle_pitch(const mma_sample_t *sample);
+
+/*
+ * @Name		angle_inclination
+ * @Description	angle_inclination_cdeg truncated to whole degrees
+ *
+ * @parameters	const mma_sample_t* - the sample
+ * @Returns		int - inclination in degrees, 0 (flat) to 180 (upside down)
+ */
+int angle_inclination(const mma_sample_t *sample);
+
+#endif /* ANGLE_H_ */
@@ -0,0 +1,96 @@
+/**
+ * @file    decimate.c
+ * @brief   Block averaging decimator with a noise floor estimate on the accelerometer axis counts
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Date	05/25/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "decimate.h"
+
+/*
+ * @Name		div_round
+ * @Description	Divides a sum by the block size rounding half away from zero
+ *
+ * @parameters	int32_t, uint16_t - the sum, the block size
+ * @Returns		int32_t - the rounded mean
+ */
+static int32_t div_round(int32_t sum, uint16_t n)
+{
+	return (sum >= 0) ? (sum + n / 2) / n : (sum - n / 2) / n;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool decimator_config(decimator_t *dec, uint16_t n)
+{
+	if(n == 0 || n > DECIMATE_MAX_N)
+		return false;
+
+	dec->n = n;
+	dec->count = 0;
+	dec->blocks = 0;
+	for(int axis = 0; axis < MMA_AXES; axis++)
+	{
+		dec->sum[axis] = 0;
+		dec->sum_sq[axis] = 0;
+		dec->var_sum[axis] = 0;
+	}
+	return true;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool decimator_push(decimator_t *dec, const mma_sample_t *sample)
+{
+	const int16_t in[MMA_AXES] = {sample->x, sample->y, sample->z};
+	int16_t mean[MMA_AXES];
+	int64_t spread;
+
+	for(int axis = 0; axis < MMA_AXES; axis++)
+	{
+		dec->sum[axis] += in[axis];
+		dec->sum_sq[axis] += (uint32_t)(in[axis] * in[axis]);
+	}
+	if(++dec->count < dec->n)
+		return false;
+
+	for(int axis = 0; axis < MMA_AXES; axis++)
+	{
+		//Block variance (n sum(x^2) - sum(x)^2) / (n (n - 1)), only needs the per-block sums
+		if(dec->n > 1)
+		{
+			spread = (int64_t)dec->n * dec->sum_sq[axis] - (int64_t)dec->sum[axis] * dec->sum[axis];
+			dec->var_sum[axis] += ((uint64_t)spread << DECIMATE_VAR_Q) / ((uint32_t)dec->n * (dec->n - 1));
+		}
+		mean[axis] = div_round(dec->sum[axis], dec->n);
+		dec->sum[axis] = 0;
+		dec->sum_sq[axis] = 0;
+	}
+	if(dec->n > 1)
+		dec->blocks++;
+	dec->out = *sample;
+	dec->out.x = mean[0];
+	dec->out.y = mean[1];
+	dec->out.z = mean[2];
+	dec->count = 0;
+	return true;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t decimator_variance(const decimator_t *dec, int axis)
+{
+	uint64_t variance;
+
+	if(dec->blocks == 0)
+		return 0;
+	variance = dec->var_sum[axis] / dec->blocks;
+	return (variance > UINT32_MAX) ? UINT32_MAX : variance;
+}
@@ -0,0 +1,75 @@
+/*
+ * decimate.h
+ *
+ * Created on: 25-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef DECIMATE_H_
+#define DECIMATE_H_
+
+/*
+ * Decimation of the accelerometer stream ahead of the angle conversion: N consecutive samples
+ * are summed per axis and their rounded mean is delivered as one sample, so the trigonometry
+ * runs N times less often and uncorrelated noise drops by sqrt(N). The spread of the samples
+ * inside every block is accumulated as well, it measures the noise floor of the raw stream.
+ * The functions only compute, so the stage builds and can be checked on a Linux host as well.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "mma8451.h"
+
+//MACROS
+#define DECIMATE_MAX_N (256)			//Largest block, keeps the sums within 32 bits
+#define DECIMATE_VAR_Q (8)				//Fraction bits of the reported variances
+
+/* public types*/
+
+//State of the stage for the three axes
+typedef struct
+{
+	uint16_t n;						//Samples per output, 1 passes every sample through
+	uint16_t count;					//Samples in the current block
+	int32_t sum[MMA_AXES];
+	uint64_t sum_sq[MMA_AXES];
+	uint32_t blocks;				//Blocks of 2 samples or more in the noise estimate
+	uint64_t var_sum[MMA_AXES];		//Sum of the block variances, Q8 counts^2
+	mma_sample_t out;				//Newest output
+} decimator_t;
+
+/*
+ * @Name		decimator_config
+ * @Description	Sets the decimation factor, the partial block and the noise estimate restart
+ *
+ * @parameters	decimator_t* - the stage
+ * 				uint16_t - samples per output, 1 to DECIMATE_MAX_N
+ * @Returns		bool - false for an invalid factor, the stage is then unchanged
+ */
+bool decimator_config(decimator_t *dec, uint16_t n);
+
+/*
+ * @Name		decimator_push
+ * @Description	Adds a sample to the current block. When the block is complete its mean, rounded
+ * 				half away from zero, is stored in the out member with the other fields (status,
+ * 				timestamp) of the last sample of the block
+ *
+ * @parameters	decimator_t*, const mma_sample_t* - the stage, the sample
+ * @Returns		bool - true if a new output is available
+ */
+bool decimator_push(decimator_t *dec, const mma_sample_t *sample);
+
+/*
+ * @Name		decimator_variance
+ * @Description	Noise of the raw samples: variance of an axis inside a block, pooled over all the
+ * 				blocks since the configuration. The noise of the outputs is N times smaller for
+ * 				uncorrelated noise (a low-pass ahead of the stage correlates the samples)
+ *
+ * @parameters	const decimator_t*, int - the stage, the axis (0 X, 1 Y, 2 Z)
+ * @Returns		uint32_t - variance in counts^2 with DECIMATE_VAR_Q fraction bits, 0 without a
+ * 				block of 2 samples or more yet
+ */
+uint32_t decimator_variance(const decimator_t *dec, int axis);
+
+#endif /* DECIMATE_H_ */
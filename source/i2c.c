@@ -10,16 +10,140 @@
  */
 
 //INCLUDES
-#include <MKL25Z4.H>
+#include <MKL25Z4.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 #include "i2c.h"
+#include "i2c_regs.h"
+#include "timebase.h"
 
 //MACROS
 #define RESET (0)
-#define PRESCALE_64 (0x10)
 #define I2C_SCL_PIN (24)
 #define I2C_SDA_PIN (25)
 #define I2C_PORT (5)
+#define I2C1_SCL_PIN (1)
+#define I2C1_SDA_PIN (0)
+#define I2C1_PORT (6)
+#define GPIO_MUX (1)
+#define MASK(x) (1UL << (x))
+#define RECOVERY_CLOCKS (9)
+#define RECOVERY_HALF_PERIOD_US (5)		//100 kHz clock while recovering the bus
+#define ENGINE_OVERHEAD_BYTES (3)		//Device address, register and read address of a transaction
+#define READ_BIT (0x1)
+#define I2C_IRQ_PRIORITY (1)
+#define DMA_CH (0)
+#define DMAMUX_SRC_I2C0 (22)
+#define DMA_SIZE_8BIT (1)
+#define DMA_IRQ_PRIORITY (1)
+#define WATCHDOG_PERIOD_US (I2C_BYTE_TIMEOUT_US)	//SysTick period while an engine has work
+#define WATCHDOG_IRQ_PRIORITY (3)		//Lowest, the line recovery runs in this interrupt
+
+//States walked by the interrupt engine for the transaction at the head of the queue
+typedef enum
+{
+	XFER_IDLE,
+	XFER_ADDR_WRITE,		//Device address (write) sent, register address follows
+	XFER_REG,				//Register address sent, data or repeated start follows
+	XFER_ADDR_READ,			//Device address (read) sent after the repeated start
+	XFER_RX_DATA,			//Receiving data bytes
+	XFER_TX_DATA			//Transmitting data bytes
+} xfer_state_t;
+
+//Interrupt engine context: a ring of pending descriptors and the progress of the head one
+typedef struct
+{
+	I2C_Type *regs;
+	IRQn_Type irq;					//Interrupt of the module
+	bool enabled;					//Module initialised, transactions may be queued
+	i2c_xfer_t *queue[I2C_QUEUE_LEN];
+	volatile unsigned int head;
+	volatile unsigned int count;
+	volatile xfer_state_t state;
+	volatile bool recovering;		//A timed out transaction is being aborted
+	uint16_t index;
+	uint32_t deadline;				//Timebase tick by which the head transaction must be done
+	uint32_t started;				//Timebase tick of the START of the head transaction
+	i2c_stats_t stats;				//Counters of this bus, polled transfers count on I2C0
+#if I2C_BENCHMARK
+	volatile uint32_t cpu_ticks;	//Timebase ticks spent in the engine interrupts
+#endif
+} i2c_engine_t;
+
+static i2c_engine_t engine0 = { .regs = I2C0, .irq = I2C0_IRQn };
+static i2c_engine_t engine1 = { .regs = I2C1, .irq = I2C1_IRQn };
+static i2c_engine_t *const engines[I2C_BUS_COUNT] = { &engine0, &engine1 };
+
+//Set while the polled functions own I2C0, the engine does not start queued transactions then
+static volatile bool polled_owner;
+
+//Deadline of the byte currently awaited by the polled functions
+static uint32_t byte_deadline;
+
+//Transaction trace ring and replay cursor
+typedef struct
+{
+	i2c_trace_rec_t rec[I2C_TRACE_LEN];
+	volatile uint32_t write;			//Records written since the last clear
+	bool enabled;
+	bool replaying;
+	uint32_t replay_pos;				//Next record considered by the replay
+} i2c_trace_t;
+
+static i2c_trace_t trace = { .enabled = (I2C_TRACE != 0) };
+
+static void engine_start(i2c_engine_t *eng);
+static void engine_check_timeout(i2c_engine_t *eng);
+
+/*
+ * @Name		deadline_passed
+ * @Description	Compares a deadline with the timebase, valid across the counter wrap
+ *
+ * @parameters	uint32_t - deadline in timebase ticks
+ * @Returns		bool - true once the deadline has been reached
+ */
+static bool deadline_passed(uint32_t deadline)
+{
+	return (int32_t)(timebase_now() - deadline) >= 0;
+}
+
+/*
+ * @Name		stats_record
+ * @Description	Accounts a finished transaction in the counters of its bus and files the latency
+ * 				in the log2 histogram. May be called from the engine interrupt
+ *
+ * @parameters	i2c_engine_t*, i2c_status_t - bus and result of the transaction
+ * 				uint16_t, uint32_t - data bytes and timebase tick of the first START
+ * @Returns		none
+ */
+static void stats_record(i2c_engine_t *eng, i2c_status_t status, uint16_t len, uint32_t started)
+{
+	uint32_t masking_state;
+	uint32_t latency_us = (timebase_now() - started) / TIMEBASE_US(1);
+	uint32_t bucket = 0;
+	i2c_stats_t *stats = &eng->stats;
+
+	//Index of the highest set bit, the Cortex-M0+ has no count leading zeros instruction
+	for(uint32_t v = latency_us >> 1; v && bucket < I2C_LAT_BUCKETS - 1; v >>= 1)
+		bucket++;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	stats->transactions++;
+	if(status == I2C_OK)
+		stats->bytes += len;
+	else if(status == I2C_ERR_NACK)
+		stats->nacks++;
+	else if(status == I2C_ERR_TIMEOUT)
+		stats->timeouts++;
+	else
+		stats->other_errors++;
+	if(latency_us > stats->worst_us)
+		stats->worst_us = latency_us;
+	stats->hist[bucket]++;
+	__set_PRIMASK(masking_state);
+}
 
 /*
  * @Name		i2c_start_bit
@@ -32,7 +156,7 @@
 static void i2c_start_bit()
 {
 	//Setting the Master bit to generate START condition
-	I2C0->C1 |= I2C_C1_MST_MASK;
+	I2C_REG_SET(I2C0, C1, I2C_C1_MST_MASK);
 }
 
 /*
@@ -46,7 +170,27 @@ static void i2c_start_bit()
 static void i2c_stop_bit()
 {
 	//Clearing the Master bit to generate STOP condition
-	I2C0->C1 &= ~(I2C_C1_MST_MASK);
+	I2C_REG_CLEAR(I2C0, C1, I2C_C1_MST_MASK);
+}
+
+/*
+ * @Name		i2c_rsta
+ * @Description	Generates a repeated START on the given module. The KL25Z fails to generate
+ * 				a repeated START while MULT is non zero (errata e6070), so the multiplier is
+ * 				cleared for the duration of the request and restored afterwards
+ *
+ * @parameters	I2C_Type* - the I2C module
+ * @Returns		none
+ */
+static void i2c_rsta(I2C_Type *i2c)
+{
+	uint8_t freq = I2C_REG_RD(i2c, F);
+
+	//Setting the repeated start (RSTA) bit to generate repeated START condition
+	//If set at a wrong time, causes the loss of bus arbitration
+	I2C_REG_WR(i2c, F, freq & ~I2C_F_MULT_MASK);
+	I2C_REG_SET(i2c, C1, I2C_C1_RSTA_MASK);
+	I2C_REG_WR(i2c, F, freq);
 }
 
 /*
@@ -59,9 +203,7 @@ static void i2c_stop_bit()
  */
 static void i2c_repeated_start()
 {
-	//Setting the repeated start (RSTA) bit to generate repeated START condition
-	//If set at a wrong time, causes the loss of bus arbitration
-	I2C0->C1 |= I2C_C1_RSTA_MASK;
+	i2c_rsta(I2C0);
 }
 
 /*
@@ -75,7 +217,7 @@ static void i2c_repeated_start()
 static void begin_transmit()
 {
 	//Setting the bit to enable transmission from Master to Slave
-	I2C0->C1 |= I2C_C1_TX_MASK;
+	I2C_REG_SET(I2C0, C1, I2C_C1_TX_MASK);
 }
 
 /*
@@ -89,7 +231,7 @@ static void begin_transmit()
 static void begin_recieve()
 {
 	//Setting the bit to enable reception from Slave to Master
-	I2C0->C1 &= ~(I2C_C1_TX_MASK);
+	I2C_REG_CLEAR(I2C0, C1, I2C_C1_TX_MASK);
 }
 
 /*
@@ -102,7 +244,7 @@ static void begin_recieve()
 static void i2c_send_ack_bit()
 {
 	//Clearing the bit TXAK enables an acknowledge on reception of byte of data
-	I2C0->C1 &= ~(I2C_C1_TXAK_MASK);
+	I2C_REG_CLEAR(I2C0, C1, I2C_C1_TXAK_MASK);
 }
 
 /*
@@ -116,7 +258,7 @@ static void i2c_send_ack_bit()
 static void i2c_send_nack_bit()
 {
 	//Setting the TXAK bit causes no acknowledge to be sent on reception of a byte of data
-	I2C0->C1 |= I2C_C1_TXAK_MASK;
+	I2C_REG_SET(I2C0, C1, I2C_C1_TXAK_MASK);
 }
 
 /*
@@ -131,7 +273,7 @@ static void tx_addr_read(uint8_t dev_addr)
 {
 	//Transmits the device address with the Write bit or LSB set indicating that it wants to
 	//read from slave. This is done by setting the LSB of the device address byte.
-	I2C0->D = (dev_addr|0x1);
+	I2C_REG_WR(I2C0, D, dev_addr|0x1);
 }
 
 /*
@@ -145,7 +287,7 @@ static void tx_addr_write(uint8_t dev_addr)
 {
 	//Transmits the device address with the Write bit or LSB low indicating that its a
 	//write to slave
-	I2C0->D = (dev_addr);
+	I2C_REG_WR(I2C0, D, dev_addr);
 }
 
 /*
@@ -159,7 +301,7 @@ static void tx_addr_write(uint8_t dev_addr)
 static uint8_t i2c_rx_slave_data()
 {
 	//Return the data in the Data register
-	return I2C0->D;
+	return I2C_REG_RD(I2C0, D);
 }
 
 /*
@@ -175,38 +317,133 @@ void init_I2C()
 	PORTE->PCR[I2C_SCL_PIN] |= PORT_PCR_MUX(I2C_PORT);
 	PORTE->PCR[I2C_SDA_PIN] |= PORT_PCR_MUX(I2C_PORT);
 
-	//Reset the frequency divider register and pre-scale it with 64
-	//so that the I2C module is operated in the standard I2C mode of 100 kHz
-	I2C0->F = RESET;
- 	I2C0->F = (I2C_F_ICR(PRESCALE_64));
+	//Reset the frequency divider register and program the divider for the configured SCL rate
+	I2C_REG_WR(I2C0, F, RESET);
+	i2c_set_speed(I2C_BUS_CLOCK, I2C_SCL_HZ, NULL);
 
 	//Enable the I2C module as the master
-	I2C0->C1 |= (I2C_C1_IICEN_MASK | I2C_C1_MST_MASK );
+	I2C_REG_SET(I2C0, C1, I2C_C1_IICEN_MASK | I2C_C1_MST_MASK);
 
 	//Sets the I2C pads in high drive mode
-	I2C0->C2 |= I2C_C2_HDRS_MASK;
+	I2C_REG_SET(I2C0, C2, I2C_C2_HDRS_MASK);
 }
 
 /*
  * See documentation in .h file
  */
-void i2c_ack_wait()
+void i2c_set_speed(uint32_t bus_hz, uint32_t scl_hz, i2c_divider_t *result)
 {
+	i2c_divider_t divider = i2c_divider_select(bus_hz, scl_hz);
+
+	I2C_REG_WR(I2C0, F, I2C_F_MULT(divider.mult) | I2C_F_ICR(divider.icr));
+	if(result)
+		*result = divider;
+}
+
+/*
+ * See documentation in .h file
+ */
+void init_I2C1()
+{
+	i2c_divider_t divider = i2c_divider_select(I2C1_CLOCK, I2C_SCL_HZ);
+
+	//Clock gating to I2C1 and port E, PTE1 and PTE0 carry SCL and SDA as alternative 6
+	SIM->SCGC4 |= SIM_SCGC4_I2C1_MASK;
+	SIM->SCGC5 |= SIM_SCGC5_PORTE_MASK;
+	PORTE->PCR[I2C1_SCL_PIN] = PORT_PCR_MUX(I2C1_PORT);
+	PORTE->PCR[I2C1_SDA_PIN] = PORT_PCR_MUX(I2C1_PORT);
+
+	I2C_REG_WR(I2C1, C1, RESET);
+	I2C_REG_WR(I2C1, F, I2C_F_MULT(divider.mult) | I2C_F_ICR(divider.icr));
+	I2C_REG_SET(I2C1, C2, I2C_C2_HDRS_MASK);
+	I2C_REG_WR(I2C1, C1, I2C_C1_IICEN_MASK);
+
+	engine1.head = 0;
+	engine1.count = 0;
+	engine1.state = XFER_IDLE;
+	engine1.enabled = true;
+
+	NVIC_SetPriority(I2C1_IRQn, I2C_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(I2C1_IRQn);
+	NVIC_EnableIRQ(I2C1_IRQn);
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t i2c_ack_wait()
+{
+	byte_deadline = timebase_now() + TIMEBASE_US(I2C_BYTE_TIMEOUT_US);
+
 	//On completion of transfer or reception of slave, the bit is set
-	while(((I2C0->S & I2C_S_IICIF_MASK)==0));
+	while(((I2C_REG_RD(I2C0, S) & I2C_S_IICIF_MASK)==0))
+	{
+		if(deadline_passed(byte_deadline))
+			return I2C_ERR_TIMEOUT;
+	}
 
-	//Before the next transmission, the bit is cleared manually, to allow transfer/reception
-	I2C0->S |= I2C_S_IICIF_MASK;
+	//Before the next transmission, the bit is cleared manually, to allow transfer/reception.
+	//Only IICIF is written so a pending arbitration lost flag stays visible to the caller
+	I2C_REG_WR(I2C0, S, I2C_S_IICIF_MASK);
+	return I2C_OK;
 }
 
 /*
  * See documentation in .h file
  */
-void i2c_start_seq()
+i2c_status_t i2c_start_seq()
 {
+	uint32_t deadline, masking_state;
+
+	//The polled sequence must not interleave with a transaction owned by the interrupt engine,
+	//which is bounded by its own deadline. Once it is done, claim the bus so that transactions
+	//queued meanwhile (e.g. by the scheduler) wait for polled_release
+	for(;;)
+	{
+		masking_state = __get_PRIMASK();
+		__disable_irq();
+		if(engine0.state == XFER_IDLE)
+		{
+			polled_owner = true;
+			__set_PRIMASK(masking_state);
+			break;
+		}
+		__set_PRIMASK(masking_state);
+		engine_check_timeout(&engine0);
+	}
+
+	//Unless KL25Z already is the master, wait for another master to release the bus
+	deadline = timebase_now() + TIMEBASE_US(I2C_BYTE_TIMEOUT_US);
+	while(!(I2C_REG_RD(I2C0, C1) & I2C_C1_MST_MASK) && (I2C_REG_RD(I2C0, S) & I2C_S_BUSY_MASK))
+	{
+		if(deadline_passed(deadline))
+			return I2C_ERR_BUSY;
+	}
+
 	//Set KL25Z as master and begin transmission and immediately generate the start condition
 	begin_transmit();
 	i2c_start_bit();
+	return I2C_OK;
+}
+
+/*
+ * @Name		polled_release
+ * @Description	Ends the ownership of I2C0 taken by i2c_start_seq and starts the engine on
+ * 				the transactions queued while the polled transfer was on the bus
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void polled_release()
+{
+	uint32_t masking_state;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	polled_owner = false;
+	if(engine0.count && engine0.state == XFER_IDLE)
+		engine_start(&engine0);
+	__set_PRIMASK(masking_state);
 }
 
 /*
@@ -270,51 +507,375 @@ uint8_t i2c_read_reg(uint8_t tx_ack)
 	//The data stored in the Data I/O register is the data requested by master, retrieve and
 	//return the data
 	rx_byte = i2c_rx_slave_data();
+	if(!tx_ack)
+		polled_release();
 	return  rx_byte;
 }
 
 /*
- * See documentation in .h file
+ * @Name		i2c_tx_checked
+ * @Description	Transmits an address or data byte, waits for the transfer to complete and checks
+ * 				that the slave acknowledged it and that the master still owns the bus. On failure
+ * 				the STOP condition is generated so the bus is released
+ *
+ * @parameters	uint8_t - the byte to transmit
+ * @Returns		i2c_status_t - I2C_OK when the byte was acknowledged
  */
-uint8_t i2c_rxByte(uint8_t dev_addr, uint8_t location)
+static i2c_status_t i2c_tx_checked(uint8_t byte)
 {
-	//A byte to store the data received from the slave
-	uint8_t rx_byte;
+	uint8_t status;
 
-	//Set KL25Z as master and begin transmission and immediately generate the start condition
-	i2c_start_seq();
+	tx_addr_write(byte);
+	if(i2c_ack_wait() != I2C_OK)
+	{
+		i2c_stop_bit();
+		return I2C_ERR_TIMEOUT;
+	}
 
-	//Transmit the device address as a write operation to write the location
-	//and wait until transfer completes and ACK is sent
-	tx_addr_write(dev_addr);
-	i2c_ack_wait();
+	status = I2C_REG_RD(I2C0, S);
+	if(status & I2C_S_ARBL_MASK)
+	{
+		//Arbitration lost, the module has already dropped to slave mode
+		I2C_REG_WR(I2C0, S, I2C_S_ARBL_MASK);
+		i2c_stop_bit();
+		return I2C_ERR_ARB_LOST;
+	}
+	if(status & I2C_S_RXAK_MASK)
+	{
+		i2c_stop_bit();
+		return I2C_ERR_NACK;
+	}
+	return I2C_OK;
+}
 
-	//Transmit the location from which the master wants to read data from and wait
-	//until transfer completes and an ACK is received
-	tx_addr_write(location);
-	i2c_ack_wait();
+/*
+ * @Name		i2c_recoverable
+ * @Description	Tells whether a failed transaction is worth a bus recovery and a retry. A NACK
+ * 				means the slave is absent or refused the access, retrying would not help
+ *
+ * @parameters	i2c_status_t - result of the attempt
+ * @Returns		bool - true for timeouts, a busy bus and lost arbitration
+ */
+static bool i2c_recoverable(i2c_status_t status)
+{
+	return status == I2C_ERR_TIMEOUT || status == I2C_ERR_BUSY || status == I2C_ERR_ARB_LOST;
+}
 
-	//Generate a repeated start to transmit the device address with the Read bit set
-	//Indicating the master wants to start the read operation, wait until ACK is received
+/*
+ * @Name		read_burst_once
+ * @Description	Single attempt of i2c_read_burst, see documentation in .h file
+ *
+ * @parameters	uint8_t, uint8_t, uint8_t*, uint16_t - as for i2c_read_burst
+ * @Returns		i2c_status_t - result of the attempt
+ */
+static i2c_status_t read_burst_once(uint8_t dev_addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+	i2c_status_t status;
+
+	//START, device address with the write bit low and the first register to read
+	if((status = i2c_start_seq()) != I2C_OK)
+		return status;
+	if((status = i2c_tx_checked(dev_addr)) != I2C_OK)
+		return status;
+	if((status = i2c_tx_checked(reg)) != I2C_OK)
+		return status;
+
+	//Repeated START and the device address with the read bit set
 	i2c_repeated_start();
-	tx_addr_read(dev_addr);
-	i2c_ack_wait();
+	if((status = i2c_tx_checked(dev_addr | READ_BIT)) != I2C_OK)
+		return status;
 
-	//begin reading the data from Data I/O register which contains data sent by the slave
-	//and send NACK bit to indicate end of read operation
+	//Switch to receive; a single byte read is NACKed straight away. The dummy read of the
+	//data register starts the reception of the first byte
 	begin_recieve();
-	i2c_send_nack_bit();
-	
-	//perform a dummy read to initiate receiving the next byte of data and wait until
-	//reception of data is complete
-	rx_byte = i2c_rx_slave_data();
-	i2c_ack_wait();
+	if(len == 1)
+		i2c_send_nack_bit();
+	else
+		i2c_send_ack_bit();
+	(void)i2c_rx_slave_data();
 
-	//Transmit the stop bit to indicate end of operation and retrieve the data stored in
-	//the Data I/O register which is data sent by the slave and return the data
+	for(uint16_t i = 0; i < len; i++)
+	{
+		if(i2c_ack_wait() != I2C_OK)
+		{
+			//Give up on the transfer and leave the module ready for the next one
+			i2c_stop_bit();
+			i2c_send_ack_bit();
+			begin_transmit();
+			return I2C_ERR_TIMEOUT;
+		}
+		//Every read of the data register starts the next byte: NACK the byte started by
+		//reading the second to last one, and STOP before reading the last one
+		if(i == len - 1)
+			i2c_stop_bit();
+		else if(i == len - 2)
+			i2c_send_nack_bit();
+		buf[i] = i2c_rx_slave_data();
+	}
+
+	//Back to transmit with ACK for the next transaction
+	i2c_send_ack_bit();
+	begin_transmit();
+	return I2C_OK;
+}
+
+/*
+ * @Name		write_burst_once
+ * @Description	Single attempt of i2c_write_burst, see documentation in .h file
+ *
+ * @parameters	uint8_t, uint8_t, const uint8_t*, uint16_t - as for i2c_write_burst
+ * @Returns		i2c_status_t - result of the attempt
+ */
+static i2c_status_t write_burst_once(uint8_t dev_addr, uint8_t reg, const uint8_t *buf, uint16_t len)
+{
+	i2c_status_t status;
+
+	//START, device address with the write bit low and the first register to write
+	if((status = i2c_start_seq()) != I2C_OK)
+		return status;
+	if((status = i2c_tx_checked(dev_addr)) != I2C_OK)
+		return status;
+	if((status = i2c_tx_checked(reg)) != I2C_OK)
+		return status;
+
+	//The slave auto-increments the register address after every acknowledged byte
+	for(uint16_t i = 0; i < len; i++)
+	{
+		if((status = i2c_tx_checked(buf[i])) != I2C_OK)
+			return status;
+	}
+
+	//Once the transfer is complete, the write operation is stopped by generating a STOP condition
 	i2c_stop_bit();
-	rx_byte = i2c_rx_slave_data();
+	return I2C_OK;
+}
+
+/*
+ * @Name		trace_record
+ * @Description	Appends a transaction to the trace ring, overwriting the oldest record when full.
+ * 				Costs a timebase read and a copy of at most I2C_TRACE_DATA_MAX bytes, and may be
+ * 				called from the engine interrupt
+ *
+ * @parameters	uint8_t, uint8_t - slave address with the R/W bit and first register
+ * 				const uint8_t*, uint16_t - data bytes of the transaction
+ * 				i2c_status_t - result of the transaction
+ * @Returns		none
+ */
+static void trace_record(uint8_t addr, uint8_t reg, const uint8_t *buf, uint16_t len,
+		i2c_status_t result)
+{
+	uint32_t masking_state;
+	i2c_trace_rec_t *rec;
+	uint16_t n = (len < I2C_TRACE_DATA_MAX) ? len : I2C_TRACE_DATA_MAX;
+
+	if(!trace.enabled || trace.replaying)
+		return;
 
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	rec = &trace.rec[trace.write++ & (I2C_TRACE_LEN - 1)];
+	rec->timestamp = timebase_now();
+	rec->addr = addr;
+	rec->reg = reg;
+	rec->len = (len > UINT8_MAX) ? UINT8_MAX : len;
+	rec->result = result;
+	for(uint16_t i = 0; i < n; i++)
+		rec->data[i] = buf[i];
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * @Name		trace_replay_read
+ * @Description	Serves a read from the trace: the next recorded read of the same slave and
+ * 				register provides the data and the result. Replay ends when none is left, or
+ * 				when the read asks for more bytes than the record holds: the trace keeps only
+ * 				the first I2C_TRACE_DATA_MAX bytes and made up data must not reach the drivers
+ *
+ * @parameters	uint8_t, uint8_t, uint8_t*, uint16_t - as for i2c_read_burst
+ * @Returns		i2c_status_t - recorded result, or I2C_ERR_NACK once replay has ended
+ */
+static i2c_status_t trace_replay_read(uint8_t dev_addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+	uint16_t count = i2c_trace_count();
+	i2c_trace_rec_t rec;
+	uint16_t recorded;
+
+	while(trace.replay_pos < count)
+	{
+		i2c_trace_get(trace.replay_pos++, &rec);
+		if(rec.addr != (dev_addr | READ_BIT) || rec.reg != reg)
+			continue;
+		if(rec.result != I2C_OK)
+			return (i2c_status_t)rec.result;
+
+		recorded = (rec.len < I2C_TRACE_DATA_MAX) ? rec.len : I2C_TRACE_DATA_MAX;
+		if(len > recorded)
+			break;
+		for(uint16_t i = 0; i < len; i++)
+			buf[i] = rec.data[i];
+		return I2C_OK;
+	}
+	trace.replaying = false;
+	return I2C_ERR_NACK;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t i2c_read_burst(uint8_t dev_addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+	i2c_status_t status;
+	uint32_t started;
+
+	if(len == 0)
+		return I2C_OK;
+	if(trace.replaying)
+		return trace_replay_read(dev_addr, reg, buf, len);
+
+	started = timebase_now();
+	status = read_burst_once(dev_addr, reg, buf, len);
+	for(int retry = 0; retry < I2C_MAX_RETRIES && i2c_recoverable(status); retry++)
+	{
+		i2c_bus_recover();
+		engine0.stats.retries++;
+		status = read_burst_once(dev_addr, reg, buf, len);
+	}
+	stats_record(&engine0, status, len, started);
+	trace_record(dev_addr | READ_BIT, reg, buf, len, status);
+	polled_release();
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t i2c_write_burst(uint8_t dev_addr, uint8_t reg, const uint8_t *buf, uint16_t len)
+{
+	i2c_status_t status;
+	uint32_t started;
+
+	//Writes are dropped while replaying so the device keeps its configuration
+	if(trace.replaying)
+		return I2C_OK;
+
+	started = timebase_now();
+	status = write_burst_once(dev_addr, reg, buf, len);
+	for(int retry = 0; retry < I2C_MAX_RETRIES && i2c_recoverable(status); retry++)
+	{
+		i2c_bus_recover();
+		engine0.stats.retries++;
+		status = write_burst_once(dev_addr, reg, buf, len);
+	}
+	stats_record(&engine0, status, len, started);
+	trace_record(dev_addr, reg, buf, len, status);
+	polled_release();
+	return status;
+}
+
+/*
+ * @Name		recovery_delay
+ * @Description	Waits for half a period of the recovery clock
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void recovery_delay()
+{
+	uint32_t start = timebase_now();
+	while(timebase_now() - start < TIMEBASE_US(RECOVERY_HALF_PERIOD_US));
+}
+
+/*
+ * @Name		line_release
+ * @Description	Releases an I2C line driven as GPIO by turning the pin into an input, the bus
+ * 				pull-up then pulls it high (open drain emulation)
+ *
+ * @parameters	uint32_t - pin number on port E
+ * @Returns		none
+ */
+static void line_release(uint32_t pin)
+{
+	PTE->PDDR &= ~MASK(pin);
+}
+
+/*
+ * @Name		line_low
+ * @Description	Pulls an I2C line driven as GPIO low
+ *
+ * @parameters	uint32_t - pin number on port E
+ * @Returns		none
+ */
+static void line_low(uint32_t pin)
+{
+	PTE->PCOR = MASK(pin);
+	PTE->PDDR |= MASK(pin);
+}
+
+/*
+ * @Name		module_reset
+ * @Description	Resets the state machine of an I2C module, which also releases the bus from its
+ * 				side, keeping the frequency divider. Pins, clock gating and C2 are left alone
+ *
+ * @parameters	I2C_Type* - the I2C module
+ * @Returns		none
+ */
+static void module_reset(I2C_Type *i2c)
+{
+	uint8_t freq = I2C_REG_RD(i2c, F);
+
+	I2C_REG_WR(i2c, C1, RESET);
+	I2C_REG_WR(i2c, F, freq);
+	I2C_REG_WR(i2c, C1, I2C_C1_IICEN_MASK);
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t i2c_bus_recover()
+{
+	//Disable the module and take over both lines as GPIO, released (high) to start with
+	I2C_REG_WR(I2C0, C1, RESET);
+	line_release(I2C_SCL_PIN);
+	line_release(I2C_SDA_PIN);
+	PORTE->PCR[I2C_SCL_PIN] = PORT_PCR_MUX(GPIO_MUX);
+	PORTE->PCR[I2C_SDA_PIN] = PORT_PCR_MUX(GPIO_MUX);
+
+	//Clock the slave until it finishes the byte it is sending and releases SDA
+	for(int i = 0; i < RECOVERY_CLOCKS && !(PTE->PDIR & MASK(I2C_SDA_PIN)); i++)
+	{
+		line_low(I2C_SCL_PIN);
+		recovery_delay();
+		line_release(I2C_SCL_PIN);
+		recovery_delay();
+	}
+
+	//STOP condition: SDA rises while SCL is high
+	line_low(I2C_SCL_PIN);
+	recovery_delay();
+	line_low(I2C_SDA_PIN);
+	recovery_delay();
+	line_release(I2C_SCL_PIN);
+	recovery_delay();
+	line_release(I2C_SDA_PIN);
+	recovery_delay();
+
+	//Hand the pins back to the module and restart it, F still holds the configured bus speed
+	PORTE->PCR[I2C_SCL_PIN] = PORT_PCR_MUX(I2C_PORT);
+	PORTE->PCR[I2C_SDA_PIN] = PORT_PCR_MUX(I2C_PORT);
+	module_reset(I2C0);
+
+	return (PTE->PDIR & MASK(I2C_SDA_PIN)) ? I2C_OK : I2C_ERR_BUSY;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint8_t i2c_rxByte(uint8_t dev_addr, uint8_t location)
+{
+	//A byte to store the data received from the slave
+	uint8_t rx_byte = 0;
+
+	i2c_read_burst(dev_addr, location, &rx_byte, 1);
 	return rx_byte;
 }
 
@@ -323,23 +884,609 @@ uint8_t i2c_rxByte(uint8_t dev_addr, uint8_t location)
  */
 void i2c_txByte(uint8_t dev_addr, uint8_t reg_addr, uint8_t txbyte)
 {
-	//Set KL25Z as master and begin transmission and immediately generate the start condition
-	i2c_start_seq();
-	
-	//Write the device address onto the SDA line and wait the slave to provide an acknowledgment
-	tx_addr_write(dev_addr);
-	i2c_ack_wait();
+	i2c_write_burst(dev_addr, reg_addr, &txbyte, 1);
+}
 
-	//Transmit the control register address/location in the slave to which the following data byte
-	//is to be written and wait for an acknowledgment
-	tx_addr_write(reg_addr);
-	i2c_ack_wait();
+/*
+ * @Name		dma_rx_start
+ * @Description	Hands the data phase of a read to DMA0: every received byte raises a DMA request
+ * 				and the channel copies the data register into the caller buffer, which also starts
+ * 				the next byte. The channel moves all but the last 2 bytes so the CPU can still set
+ * 				the NACK ahead of the final byte and the STOP before reading it. The module
+ * 				interrupt is masked until DMA0_IRQHandler hands the transfer back
+ *
+ * @parameters	i2c_engine_t*, i2c_xfer_t* - engine owning the bus and the read in progress
+ * @Returns		none
+ */
+static void dma_rx_start(i2c_engine_t *eng, i2c_xfer_t *xfer)
+{
+	I2C_Type *i2c = eng->regs;
 
-	//Transmit the data byte value and wait for an acknowledgment from the slave
-	tx_addr_write(txbyte);
-	i2c_ack_wait();
+	//Clear a previous done/error status and point the channel from the data register to the buffer
+	DMA0->DMA[DMA_CH].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	DMA0->DMA[DMA_CH].SAR = I2C_REG_ADDR(i2c, D);
+	DMA0->DMA[DMA_CH].DAR = (uint32_t)(uintptr_t)xfer->buf;
+	DMA0->DMA[DMA_CH].DSR_BCR = DMA_DSR_BCR_BCR(xfer->len - 2);
 
-	//Once the transfer is complete, the write operation is stopped by generating a STOP condition
-	i2c_stop_bit();
-	
+	//Byte wide cycle-steal transfers, destination increments, request is dropped at the end
+	DMA0->DMA[DMA_CH].DCR = DMA_DCR_EINT_MASK | DMA_DCR_ERQ_MASK | DMA_DCR_CS_MASK |
+			DMA_DCR_SSIZE(DMA_SIZE_8BIT) | DMA_DCR_DINC_MASK | DMA_DCR_DSIZE(DMA_SIZE_8BIT) |
+			DMA_DCR_D_REQ_MASK;
+
+	I2C_REG_CLEAR(i2c, C1, I2C_C1_IICIE_MASK);
+	I2C_REG_SET(i2c, C1, I2C_C1_DMAEN_MASK);
+}
+
+/*
+ * @Name		watchdog_arm
+ * @Description	Starts the SysTick watchdog of the engines unless it is running. It checks the
+ * 				deadlines of transactions submitted from interrupts, which no i2c_wait polls,
+ * 				and stops itself once every engine is idle. Called with interrupts masked or
+ * 				from an interrupt
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void watchdog_arm()
+{
+	if(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)
+		return;
+	SysTick->LOAD = TIMEBASE_US(WATCHDOG_PERIOD_US) * TIMEBASE_CYCLES_PER_TICK - 1;
+	SysTick->VAL = 0;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+/*
+ * @Name		engine_start
+ * @Description	Generates the START condition for the transaction at the head of the queue and
+ * 				transmits the device address with the write bit low. Called with the engine idle
+ * 				and a non empty queue, either from i2c_submit or from the ISR on completion
+ *
+ * @parameters	i2c_engine_t* - engine owning the bus
+ * @Returns		none
+ */
+static void engine_start(i2c_engine_t *eng)
+{
+	I2C_Type *i2c = eng->regs;
+
+	eng->index = 0;
+	eng->state = XFER_ADDR_WRITE;
+	eng->started = timebase_now();
+	eng->deadline = eng->started +
+			TIMEBASE_US(I2C_BYTE_TIMEOUT_US) * (eng->queue[eng->head]->len + ENGINE_OVERHEAD_BYTES);
+	watchdog_arm();
+
+	//Enable the module interrupt, become master transmitter (START) and send the address
+	I2C_REG_SET(i2c, C1, I2C_C1_IICIE_MASK | I2C_C1_TX_MASK);
+	I2C_REG_SET(i2c, C1, I2C_C1_MST_MASK);
+	I2C_REG_WR(i2c, D, eng->queue[eng->head]->dev_addr);
+}
+
+/*
+ * @Name		engine_finish
+ * @Description	Ends the head transaction with the given result, releases the bus with a STOP,
+ * 				starts the next queued transaction if any and then reports the completion
+ *
+ * @parameters	i2c_engine_t*, i2c_status_t - engine owning the bus and result of the transaction
+ * @Returns		none
+ */
+static void engine_finish(i2c_engine_t *eng, i2c_status_t status)
+{
+	I2C_Type *i2c = eng->regs;
+	i2c_xfer_t *xfer = eng->queue[eng->head];
+
+	//STOP (if still master), back to transmit mode and ACK for the next transaction
+	I2C_REG_CLEAR(i2c, C1, I2C_C1_MST_MASK | I2C_C1_TXAK_MASK);
+	I2C_REG_SET(i2c, C1, I2C_C1_TX_MASK);
+
+	eng->head = (eng->head + 1) % I2C_QUEUE_LEN;
+	eng->count--;
+	stats_record(eng, status, xfer->len, eng->started);
+	trace_record(xfer->dev_addr | (xfer->dir == I2C_READ ? READ_BIT : 0), xfer->reg, xfer->buf,
+			(status == I2C_OK) ? xfer->len : 0, status);
+
+	//Keep the bus busy with the next descriptor, otherwise hand the module back to polled use.
+	//A polled transfer waiting for I2C0 goes first, it restarts the queue when it is done.
+	//This is settled before the callback: a transaction it submits is then only queued
+	//behind a running one, or starts the idle engine itself
+	if(eng->count && !(eng == &engine0 && polled_owner))
+	{
+		engine_start(eng);
+	}
+	else
+	{
+		eng->state = XFER_IDLE;
+		I2C_REG_CLEAR(i2c, C1, I2C_C1_IICIE_MASK);
+	}
+
+	xfer->status = status;
+	xfer->done = true;
+	if(xfer->callback)
+		xfer->callback(xfer);
+}
+
+/*
+ * @Name		engine_irq
+ * @Description	Advances the head transaction by one step on every IICIF interrupt: checks for lost
+ * 				arbitration and missing ACKs, sends the register address, the repeated start with
+ * 				the read address or the next data byte, and on reception sets NACK ahead of the last
+ * 				byte and the STOP before the last byte is read out of the data register
+ *
+ * @parameters	i2c_engine_t* - engine whose module raised the interrupt
+ * @Returns		none
+ */
+static void engine_irq(i2c_engine_t *eng)
+{
+	I2C_Type *i2c = eng->regs;
+	i2c_xfer_t *xfer;
+	uint8_t status = I2C_REG_RD(i2c, S);
+
+	//Clear the interrupt flag (and the arbitration lost flag, both write 1 to clear)
+	I2C_REG_WR(i2c, S, I2C_S_IICIF_MASK | (status & I2C_S_ARBL_MASK));
+
+	if(eng->state == XFER_IDLE || eng->count == 0)
+		return;
+	xfer = eng->queue[eng->head];
+
+	if(status & I2C_S_ARBL_MASK)
+	{
+		engine_finish(eng, I2C_ERR_ARB_LOST);
+		return;
+	}
+	//Every transmitted byte must be acknowledged by the slave
+	if(eng->state != XFER_RX_DATA && (status & I2C_S_RXAK_MASK))
+	{
+		engine_finish(eng, I2C_ERR_NACK);
+		return;
+	}
+
+	switch(eng->state)
+	{
+	case XFER_ADDR_WRITE:
+		I2C_REG_WR(i2c, D, xfer->reg);
+		eng->state = XFER_REG;
+		break;
+
+	case XFER_REG:
+		if(xfer->dir == I2C_READ)
+		{
+			i2c_rsta(i2c);
+			I2C_REG_WR(i2c, D, xfer->dev_addr | READ_BIT);
+			eng->state = XFER_ADDR_READ;
+		}
+		else if(xfer->len == 0)
+		{
+			engine_finish(eng, I2C_OK);
+		}
+		else
+		{
+			I2C_REG_WR(i2c, D, xfer->buf[eng->index++]);
+			eng->state = XFER_TX_DATA;
+		}
+		break;
+
+	case XFER_ADDR_READ:
+		//Switch to receive, NACK straight away for a single byte read and start the first
+		//byte with a dummy read of the data register
+		I2C_REG_CLEAR(i2c, C1, I2C_C1_TX_MASK);
+		if(xfer->len == 1)
+			I2C_REG_SET(i2c, C1, I2C_C1_TXAK_MASK);
+		else
+			I2C_REG_CLEAR(i2c, C1, I2C_C1_TXAK_MASK);
+		eng->state = XFER_RX_DATA;
+		if(xfer->dma && xfer->len >= I2C_DMA_MIN_LEN && eng == &engine0)
+			dma_rx_start(eng, xfer);
+		(void)I2C_REG_RD(i2c, D);
+		break;
+
+	case XFER_RX_DATA:
+		if(eng->index == xfer->len - 1)
+		{
+			//Last byte: STOP before reading the data register so no further byte is clocked in
+			I2C_REG_CLEAR(i2c, C1, I2C_C1_MST_MASK);
+			xfer->buf[eng->index++] = I2C_REG_RD(i2c, D);
+			engine_finish(eng, I2C_OK);
+			break;
+		}
+		//NACK the byte that the read below starts if it is the last one
+		if(eng->index == xfer->len - 2)
+			I2C_REG_SET(i2c, C1, I2C_C1_TXAK_MASK);
+		xfer->buf[eng->index++] = I2C_REG_RD(i2c, D);
+		break;
+
+	case XFER_TX_DATA:
+		if(eng->index < xfer->len)
+			I2C_REG_WR(i2c, D, xfer->buf[eng->index++]);
+		else
+			engine_finish(eng, I2C_OK);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+ * @Name		engine_check_timeout
+ * @Description	Aborts the transaction on the bus once it has missed its deadline: the interrupt
+ * 				and DMA requests are stopped, the bus is recovered and the transaction completes
+ * 				with I2C_ERR_TIMEOUT, which also starts the next queued one. Called from i2c_wait,
+ * 				i2c_start_seq and the SysTick watchdog; whichever sees the deadline first does the
+ * 				abort, the others return. Only the interrupts of the engine are masked during the
+ * 				line recovery
+ *
+ * @parameters	i2c_engine_t* - engine to check
+ * @Returns		none
+ */
+static void engine_check_timeout(i2c_engine_t *eng)
+{
+	uint32_t masking_state;
+	bool expired;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	expired = eng->count && eng->state != XFER_IDLE && !eng->recovering &&
+			deadline_passed(eng->deadline);
+	if(expired)
+	{
+		eng->recovering = true;
+		NVIC_DisableIRQ(eng->irq);
+		I2C_REG_CLEAR(eng->regs, C1, I2C_C1_IICIE_MASK | I2C_C1_DMAEN_MASK);
+		if(eng == &engine0)
+		{
+			NVIC_DisableIRQ(DMA0_IRQn);
+			DMA0->DMA[DMA_CH].DCR = 0;
+			DMA0->DMA[DMA_CH].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+		}
+	}
+	__set_PRIMASK(masking_state);
+	if(!expired)
+		return;
+
+	//The line recovery clocks the bus by hand for hundreds of us. The engine stays busy, so
+	//transactions submitted meanwhile from other interrupts are only queued
+	if(eng == &engine0)
+		i2c_bus_recover();
+	else
+		module_reset(eng->regs);	//No line recovery on I2C1, the module at least lets go
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	NVIC_ClearPendingIRQ(eng->irq);
+	NVIC_EnableIRQ(eng->irq);
+	if(eng == &engine0)
+	{
+		NVIC_ClearPendingIRQ(DMA0_IRQn);
+		NVIC_EnableIRQ(DMA0_IRQn);
+	}
+	eng->recovering = false;
+	engine_finish(eng, I2C_ERR_TIMEOUT);
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_engine_init()
+{
+	engine0.head = 0;
+	engine0.count = 0;
+	engine0.state = XFER_IDLE;
+	engine0.enabled = true;
+
+	NVIC_SetPriority(I2C0_IRQn, I2C_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(I2C0_IRQn);
+	NVIC_EnableIRQ(I2C0_IRQn);
+
+	//DMA0 serves the receive requests of I2C0 through the DMA multiplexer
+	SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+	SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+	DMAMUX0->CHCFG[DMA_CH] = 0;
+	DMAMUX0->CHCFG[DMA_CH] = DMAMUX_CHCFG_SOURCE(DMAMUX_SRC_I2C0) | DMAMUX_CHCFG_ENBL_MASK;
+
+	NVIC_SetPriority(DMA0_IRQn, DMA_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(DMA0_IRQn);
+	NVIC_EnableIRQ(DMA0_IRQn);
+
+	//SysTick is the engine watchdog, armed by the first transaction
+	SysTick->CTRL = 0;
+	NVIC_SetPriority(SysTick_IRQn, WATCHDOG_IRQ_PRIORITY);
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_submit(i2c_xfer_t *xfer)
+{
+	return i2c_submit_bus(I2C_BUS0, xfer);
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_submit_bus(i2c_bus_t bus, i2c_xfer_t *xfer)
+{
+	i2c_engine_t *eng;
+	uint32_t masking_state;
+	bool queued = false;
+
+	if(bus >= I2C_BUS_COUNT || !engines[bus]->enabled)
+		return false;
+	eng = engines[bus];
+	if(xfer == NULL || (xfer->len && xfer->buf == NULL) || (xfer->dir == I2C_READ && xfer->len == 0))
+		return false;
+
+	xfer->status = I2C_PENDING;
+	xfer->done = false;
+
+	//The queue is shared with the ISR, protect the update from preemption
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	if(eng->count < I2C_QUEUE_LEN)
+	{
+		eng->queue[(eng->head + eng->count) % I2C_QUEUE_LEN] = xfer;
+		eng->count++;
+		queued = true;
+		//Kick the bus if nothing was in flight and the polled functions do not own it
+		if(eng->state == XFER_IDLE && !(eng == &engine0 && polled_owner))
+			engine_start(eng);
+	}
+	__set_PRIMASK(masking_state);
+
+	return queued;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t i2c_wait(i2c_xfer_t *xfer)
+{
+	while(!xfer->done)
+	{
+		for(int bus = 0; bus < I2C_BUS_COUNT; bus++)
+		{
+			if(engines[bus]->enabled)
+				engine_check_timeout(engines[bus]);
+		}
+	}
+	return xfer->status;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_engine_busy()
+{
+	return engine0.count != 0;
+}
+
+/*
+ * @Name		I2C0_IRQHandler
+ * @Description	I2C0 interrupt service routine, drives the transaction engine
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void I2C0_IRQHandler(void)
+{
+#if I2C_BENCHMARK
+	uint32_t start = timebase_now();
+	engine_irq(&engine0);
+	engine0.cpu_ticks += timebase_now() - start;
+#else
+	engine_irq(&engine0);
+#endif
+}
+
+/*
+ * @Name		I2C1_IRQHandler
+ * @Description	I2C1 interrupt service routine, drives the transaction engine of the second bus
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void I2C1_IRQHandler(void)
+{
+#if I2C_BENCHMARK
+	uint32_t start = timebase_now();
+	engine_irq(&engine1);
+	engine1.cpu_ticks += timebase_now() - start;
+#else
+	engine_irq(&engine1);
+#endif
+}
+
+/*
+ * @Name		SysTick_Handler
+ * @Description	Engine watchdog: aborts a transaction past its deadline on either bus, whoever
+ * 				submitted it, and stops the tick when no transaction is left
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void SysTick_Handler(void)
+{
+	uint32_t masking_state;
+	bool busy = false;
+
+	for(int bus = 0; bus < I2C_BUS_COUNT; bus++)
+	{
+		if(engines[bus]->enabled)
+			engine_check_timeout(engines[bus]);
+	}
+
+	//Decided with interrupts masked, a transaction submitted in between re-arms the tick
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	for(int bus = 0; bus < I2C_BUS_COUNT; bus++)
+		busy |= engines[bus]->count != 0;
+	if(!busy)
+		SysTick->CTRL = 0;
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * @Name		DMA0_IRQHandler
+ * @Description	End of the DMA part of a read: stops the I2C DMA requests and returns the last 2
+ * 				bytes to the engine interrupt, which sets NACK and STOP as for a polled read.
+ * 				The IICIF left by the DMA driven bytes is stale, but the byte started by the last
+ * 				DMA read may have completed as well if this interrupt was held up. TCF, cleared
+ * 				by that read, tells: a byte whose flag went with the stale one is handled here
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void DMA0_IRQHandler(void)
+{
+#if I2C_BENCHMARK
+	uint32_t start = timebase_now();
+#endif
+	I2C_Type *i2c = engine0.regs;
+	uint8_t status;
+
+	//Acknowledge the channel and stop requesting DMA on received bytes
+	DMA0->DMA[DMA_CH].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	I2C_REG_CLEAR(i2c, C1, I2C_C1_DMAEN_MASK);
+
+	//The DMA read the first len-2 bytes, the interrupt engine picks up the remaining two.
+	//Drop the stale flag left by the DMA driven bytes before unmasking the interrupt
+	engine0.index = engine0.queue[engine0.head]->len - 2;
+	I2C_REG_WR(i2c, S, I2C_S_IICIF_MASK);
+	I2C_REG_SET(i2c, C1, I2C_C1_IICIE_MASK);
+
+	//Byte len-2 done but its IICIF cleared above: no interrupt will come for it. Had it
+	//completed after the clear, IICIF is set again and the engine interrupt takes it
+	status = I2C_REG_RD(i2c, S);
+	if((status & I2C_S_TCF_MASK) && !(status & I2C_S_IICIF_MASK))
+		engine_irq(&engine0);
+#if I2C_BENCHMARK
+	engine0.cpu_ticks += timebase_now() - start;
+#endif
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_bench_rx(uint8_t dev_addr, uint8_t reg, uint8_t *buf, uint16_t len, i2c_bench_t *result)
+{
+	uint32_t start, submit_ticks;
+	i2c_xfer_t xfer = {.dev_addr = dev_addr, .reg = reg, .dir = I2C_READ, .buf = buf, .len = len,
+			.dma = true};
+
+	result->len = len;
+
+	//Polled path: the CPU spins through every byte of the transfer
+	start = timebase_now();
+	i2c_read_burst(dev_addr, reg, buf, len);
+	result->pio_cpu_cycles = (timebase_now() - start) * TIMEBASE_CYCLES_PER_TICK;
+
+	//DMA path: only the submit and the interrupts cost CPU time
+#if I2C_BENCHMARK
+	engine0.cpu_ticks = 0;
+#endif
+	start = timebase_now();
+	i2c_submit(&xfer);
+	submit_ticks = timebase_now() - start;
+	i2c_wait(&xfer);
+	result->dma_bus_cycles = (timebase_now() - start) * TIMEBASE_CYCLES_PER_TICK;
+#if I2C_BENCHMARK
+	result->dma_cpu_cycles = (submit_ticks + engine0.cpu_ticks) * TIMEBASE_CYCLES_PER_TICK;
+#else
+	result->dma_cpu_cycles = submit_ticks * TIMEBASE_CYCLES_PER_TICK;
+#endif
+	result->dma_status = xfer.status;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_stats_get(i2c_bus_t bus, i2c_stats_t *stats)
+{
+	uint32_t masking_state;
+
+	if(bus >= I2C_BUS_COUNT)
+		return false;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	*stats = engines[bus]->stats;
+	__set_PRIMASK(masking_state);
+	return true;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_stats_reset(i2c_bus_t bus)
+{
+	uint32_t masking_state;
+
+	if(bus >= I2C_BUS_COUNT)
+		return;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	memset(&engines[bus]->stats, 0, sizeof(i2c_stats_t));
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_trace_enable(bool enable)
+{
+	trace.enabled = enable;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_trace_clear()
+{
+	trace.write = 0;
+	trace.replaying = false;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint16_t i2c_trace_count()
+{
+	return (trace.write < I2C_TRACE_LEN) ? trace.write : I2C_TRACE_LEN;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_trace_get(uint16_t index, i2c_trace_rec_t *rec)
+{
+	uint32_t masking_state;
+	uint16_t count = i2c_trace_count();
+
+	if(index >= count)
+		return false;
+
+	//Copy with interrupts masked, the engine may be appending a record
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	*rec = trace.rec[(trace.write - count + index) & (I2C_TRACE_LEN - 1)];
+	__set_PRIMASK(masking_state);
+	return true;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_trace_replay(bool enable)
+{
+	trace.replay_pos = 0;
+	trace.replaying = enable && i2c_trace_count();
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_trace_replaying()
+{
+	return trace.replaying;
 }
@@ -5,31 +5,163 @@
  * Author: Venkat Sai Krishna Tata
  */
 
+#ifndef I2C_H_
+#define I2C_H_
+
 //INCLUDES
 #include <stdint.h>
+#include <stdbool.h>
+#include "i2c_divider.h"
+
+//MACROS
+#define I2C_BUS_CLOCK (12000000U)	//Bus clock feeding I2C0: 24 MHz core with OUTDIV4 dividing by 2
+#define I2C_SCL_HZ (400000U)		//SCL rate set by init_I2C, the MMA8451 supports fast mode
+#define I2C1_CLOCK (24000000U)		//System clock feeding I2C1, unlike I2C0 it is not on the bus clock
+#define I2C_QUEUE_LEN (8)		//Transaction descriptors the interrupt engine can hold
+#define I2C_DMA_MIN_LEN (3)		//Shortest read moved by DMA, the CPU always handles the last 2 bytes
+#define I2C_BYTE_TIMEOUT_US (1000)	//Deadline for one byte including clock stretching
+#define I2C_MAX_RETRIES (2)			//Attempts after a bus recovery before an error is returned
+#ifndef I2C_TRACE
+#define I2C_TRACE (1)				//Record every transaction in the trace ring, also in release
+#endif
+#define I2C_TRACE_LEN (64)			//Transactions kept in the trace ring (power of 2)
+#define I2C_TRACE_DATA_MAX (8)		//Data bytes stored per transaction, longer ones are truncated
+#define I2C_LAT_BUCKETS (16)		//Latency histogram buckets, bucket k counts [2^k, 2^(k+1)) us
+#ifndef I2C_BENCHMARK
+#define I2C_BENCHMARK (1)		//Account CPU time spent in the engine interrupts
+#endif
+
+/* public types*/
+
+//Result of an I2C transaction
+typedef enum
+{
+	I2C_OK = 0,
+	I2C_ERR_NACK,			//Slave did not acknowledge the address or a data byte
+	I2C_ERR_ARB_LOST,		//Master lost arbitration of the bus
+	I2C_ERR_TIMEOUT,		//A byte or transaction did not complete before its deadline
+	I2C_ERR_BUSY,			//The bus stayed busy (another master or a stuck line)
+	I2C_ERR_ARG,			//Invalid argument, refused before any bus access
+	I2C_PENDING				//Transaction queued or in progress on the interrupt engine
+} i2c_status_t;
+
+//I2C modules the transaction engine can drive
+typedef enum
+{
+	I2C_BUS0 = 0,			//I2C0 on PTE24/PTE25, shared with the MMA8451
+	I2C_BUS1,				//I2C1 on PTE1 (SCL) / PTE0 (SDA), for auxiliary sensors
+	I2C_BUS_COUNT
+} i2c_bus_t;
+
+//Direction of the data phase of a register transaction
+typedef enum
+{
+	I2C_WRITE = 0,
+	I2C_READ
+} i2c_dir_t;
+
+struct i2c_xfer;
+typedef void (*i2c_callback_t)(struct i2c_xfer *xfer);
+
+//Transaction descriptor queued on the interrupt driven engine. The descriptor and its buffer
+//must stay valid until done is set
+typedef struct i2c_xfer
+{
+	uint8_t dev_addr;				//8-bit slave address (R/W bit clear)
+	uint8_t reg;					//First register of the transfer
+	i2c_dir_t dir;					//Read from or write to the slave
+	uint8_t *buf;					//Source or destination of the data bytes
+	uint16_t len;					//Number of data bytes
+	bool dma;						//Move the bytes of a read with DMA0 instead of per byte interrupts
+	i2c_callback_t callback;		//Called from the ISR on completion, may be NULL
+	volatile i2c_status_t status;	//Result, I2C_PENDING until the transaction ends
+	volatile bool done;				//Set once the transaction has finished
+} i2c_xfer_t;
+
+//One transaction in the trace ring, 16 bytes
+typedef struct
+{
+	uint32_t timestamp;						//Timebase tick at completion
+	uint8_t addr;							//Slave address with the R/W bit of the data phase
+	uint8_t reg;							//First register
+	uint8_t len;							//Data bytes transferred, saturated at 255
+	uint8_t result;							//i2c_status_t of the transaction
+	uint8_t data[I2C_TRACE_DATA_MAX];		//First data bytes
+} i2c_trace_rec_t;
+
+//CPU and bus time of one burst read through the polled path and the DMA path, in core cycles
+typedef struct
+{
+	uint16_t len;					//Bytes read on each path
+	uint32_t pio_cpu_cycles;		//Polled path, the CPU is busy for the whole transfer
+	uint32_t dma_cpu_cycles;		//DMA path, submit plus time spent in the I2C0 and DMA0 ISRs
+	uint32_t dma_bus_cycles;		//DMA path, submit until completion
+	i2c_status_t dma_status;
+} i2c_bench_t;
+
+//Performance counters of one bus, cleared by i2c_stats_reset
+typedef struct
+{
+	uint32_t transactions;					//Completed transactions, successful or not
+	uint32_t bytes;							//Data bytes of the successful transactions
+	uint32_t nacks;							//Transactions ending with I2C_ERR_NACK
+	uint32_t timeouts;						//Transactions ending with I2C_ERR_TIMEOUT
+	uint32_t other_errors;					//Lost arbitration or a busy bus
+	uint32_t retries;						//Polled attempts repeated after a bus recovery
+	uint32_t worst_us;						//Longest transaction latency
+	uint32_t hist[I2C_LAT_BUCKETS];			//Latency histogram, below 2 us in bucket 0 and
+											//everything from 2^15 us up in the last bucket
+} i2c_stats_t;
 
 /* public function prototypes*/
 
 /*
  * @Name		init_I2C
  * @Description	Initializes the I2C0 peripheral wired to the accelerometer from the KL25Z
- * 				pins of 24 and 25. The pre-scaler is set to enable the I2C module operate with
- * 				the standard I2C mode (in 100kHz). KL25Z is set as master and the communication
- * 				is enabled
+ * 				pins of 24 and 25. The frequency divider is set for I2C_SCL_HZ (400 kHz fast
+ * 				mode by default). KL25Z is set as master and the communication is enabled
  *
  * @parameters	none
  * @Returns		none
  */
 void init_I2C();
+/*
+ * @Name		i2c_set_speed
+ * @Description	Programs the frequency divider of I2C0 with the MULT/ICR pair giving the fastest
+ * 				SCL rate not above the target. Must be called while the bus is idle
+ *
+ * @parameters	uint32_t, uint32_t - bus clock feeding the module and target SCL rate in Hz
+ * 				i2c_divider_t* - receives the chosen setting, achieved rate and error, may be NULL
+ * @Returns		none
+ */
+void i2c_set_speed(uint32_t bus_hz, uint32_t scl_hz, i2c_divider_t *result);
+
+/*
+ * @Name		init_I2C1
+ * @Description	Initializes I2C1 on the alternate pins PTE1 (SCL) and PTE0 (SDA) at I2C_SCL_HZ
+ * 				and enables its transaction engine. I2C1 is only driven through i2c_submit_bus,
+ * 				the polled functions of this driver always use I2C0
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void init_I2C1();
+
 /*
  * @Name		i2c_start_seq
  * @Description	Function implements the sequence of initiating the transmission and generating
  * 				a start bit together
  *
+ * 				If another master holds the bus, the function waits for it to be released until the
+ * 				operation deadline expires
+ *
+ * 				A transaction of the engine in progress on I2C0 is completed first, queued ones are
+ * 				held back until the polled transfer ends. Not to be called from interrupt context
+ *
  * @parameters	none
- * @Returns		none
+ * @Returns		i2c_status_t - I2C_OK, or I2C_ERR_BUSY if the bus did not become free in time
  */
-void i2c_start_seq();
+i2c_status_t i2c_start_seq();
 
 /*
  * @Name		i2c_read_addr
@@ -59,12 +191,51 @@ uint8_t i2c_read_reg(uint8_t tx_ack);
  * @Description	The Interrupt Flag is set when the transfer, including the ACK/NACK is complete
  * 				or when slave address matches indicating the presence of slave. Note: Though the
  * 				operation of I2C is not in interrupt mode, IICIF flag is set and more reliable than
- * 				the TCF Transfer complete flag (source : NXP support)
+ * 				the TCF Transfer complete flag (source : NXP support). The wait is bounded by
+ * 				I2C_BYTE_TIMEOUT_US so a missing slave or a stuck line cannot hang the caller
  *
  * @parameters	none
- * @Returns		none
+ * @Returns		i2c_status_t - I2C_OK, or I2C_ERR_TIMEOUT if the flag was not set in time
+ */
+i2c_status_t i2c_ack_wait();
+
+/*
+ * @Name		i2c_read_burst
+ * @Description	Reads a run of consecutive registers in one transaction: START, device and register
+ * 				address, repeated START, then len bytes relying on the slave auto-increment. Every
+ * 				byte is ACKed except the last one, which is NACKed, and the STOP is generated before
+ * 				the last byte is read out so no extra byte is clocked from the slave. A timeout,
+ * 				busy bus or lost arbitration triggers a bus recovery and up to I2C_MAX_RETRIES
+ * 				further attempts; a NACK is returned straight away
+ *
+ * @parameters	uint8_t, uint8_t - slave address and first register to read
+ * 				uint8_t*, uint16_t - destination buffer and number of bytes to read
+ * @Returns		i2c_status_t - I2C_OK, or the reason the transaction was abandoned
+ */
+i2c_status_t i2c_read_burst(uint8_t dev_addr, uint8_t reg, uint8_t *buf, uint16_t len);
+
+/*
+ * @Name		i2c_write_burst
+ * @Description	Writes a run of consecutive registers in one transaction: START, device and register
+ * 				address, then len data bytes, each of which must be acknowledged, then STOP.
+ * 				Errors are retried after a bus recovery as for i2c_read_burst
+ *
+ * @parameters	uint8_t, uint8_t - slave address and first register to write
+ * 				const uint8_t*, uint16_t - source buffer and number of bytes to write
+ * @Returns		i2c_status_t - I2C_OK, or the reason the transaction was abandoned
  */
-void i2c_ack_wait();
+i2c_status_t i2c_write_burst(uint8_t dev_addr, uint8_t reg, const uint8_t *buf, uint16_t len);
+
+/*
+ * @Name		i2c_bus_recover
+ * @Description	Clears a bus held by a slave that lost track of the clock: the module is disabled,
+ * 				SCL on PTE24 is toggled as a GPIO (up to 9 clocks) until the slave releases SDA, a
+ * 				STOP is generated by hand and the module is reset, keeping its frequency divider
+ *
+ * @parameters	none
+ * @Returns		i2c_status_t - I2C_OK if SDA was released, I2C_ERR_BUSY if it is still held low
+ */
+i2c_status_t i2c_bus_recover();
 
 /*
  * @Name		i2c_rxByte
@@ -89,3 +260,153 @@ uint8_t i2c_rxByte(uint8_t dev_addr, uint8_t location);
  * @Returns		none
  */
 void i2c_txByte(uint8_t dev_addr, uint8_t reg_addr, uint8_t txbyte);
+
+/*
+ * @Name		i2c_engine_init
+ * @Description	Prepares the interrupt driven transaction engine on I2C0 by clearing the queue
+ * 				and enabling the I2C0 interrupt in the NVIC. The module interrupt (IICIE) is only
+ * 				enabled while a transaction is in flight so the polled functions above keep working
+ * 				whenever the engine is idle. SysTick is taken as the watchdog of the engines: it
+ * 				ticks every I2C_BYTE_TIMEOUT_US while a transaction is queued and aborts the ones
+ * 				past their deadline, including those submitted from interrupts
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void i2c_engine_init();
+
+/*
+ * @Name		i2c_submit
+ * @Description	Queues a transaction descriptor on the engine and starts the bus if it is idle.
+ * 				The call returns immediately; the START, repeated START, ACK/NACK handling and STOP
+ * 				are walked by I2C0_IRQHandler and done/status/callback report the completion
+ *
+ * @parameters	i2c_xfer_t* - the transaction to queue
+ * @Returns		bool - false if the queue is full or the descriptor is invalid
+ */
+bool i2c_submit(i2c_xfer_t *xfer);
+
+/*
+ * @Name		i2c_submit_bus
+ * @Description	Same as i2c_submit on the given module. Transactions of a bus run back-to-back in
+ * 				the order they were queued; I2C1 has no DMA and ignores the dma flag
+ *
+ * @parameters	i2c_bus_t, i2c_xfer_t* - module to use and the transaction to queue
+ * @Returns		bool - false if the queue is full, the descriptor is invalid or the module
+ * 				has not been initialised
+ */
+bool i2c_submit_bus(i2c_bus_t bus, i2c_xfer_t *xfer);
+
+/*
+ * @Name		i2c_wait
+ * @Description	Waits for a submitted transaction to finish. If the transaction on the bus misses
+ * 				its deadline (I2C_BYTE_TIMEOUT_US per byte) it is aborted with I2C_ERR_TIMEOUT,
+ * 				the bus is recovered and the engine moves on to the next descriptor
+ *
+ * @parameters	i2c_xfer_t* - a transaction previously accepted by i2c_submit
+ * @Returns		i2c_status_t - the final status of the transaction
+ */
+i2c_status_t i2c_wait(i2c_xfer_t *xfer);
+
+/*
+ * @Name		i2c_engine_busy
+ * @Description	Reports whether the engine still owns the bus
+ *
+ * @parameters	none
+ * @Returns		bool - true while a queued transaction is pending or in progress
+ */
+bool i2c_engine_busy();
+
+/*
+ * @Name		i2c_bench_rx
+ * @Description	Benchmark mode for the receive paths: reads the same register burst once through
+ * 				the polled functions and once through the engine with DMA, timing both with the
+ * 				timebase. Must be called with the engine idle
+ *
+ * @parameters	uint8_t, uint8_t - slave address and first register of the burst
+ * 				uint8_t*, uint16_t - scratch buffer and number of bytes to read
+ * 				i2c_bench_t* - filled with the measured cycles
+ * @Returns		none
+ */
+void i2c_bench_rx(uint8_t dev_addr, uint8_t reg, uint8_t *buf, uint16_t len, i2c_bench_t *result);
+
+/*
+ * @Name		i2c_stats_get
+ * @Description	Copies the performance counters of a bus. Latency is timed with the timebase
+ * 				from the first START to the end of the transaction: it includes the retries of
+ * 				the polled functions, and excludes the time a queued transaction waits for the bus
+ *
+ * @parameters	i2c_bus_t, i2c_stats_t* - bus to report and destination of the counters
+ * @Returns		bool - false for an invalid bus
+ */
+bool i2c_stats_get(i2c_bus_t bus, i2c_stats_t *stats);
+
+/*
+ * @Name		i2c_stats_reset
+ * @Description	Clears the performance counters of a bus
+ *
+ * @parameters	i2c_bus_t - bus to clear
+ * @Returns		none
+ */
+void i2c_stats_reset(i2c_bus_t bus);
+
+/*
+ * @Name		i2c_trace_enable
+ * @Description	Starts or stops recording transactions in the trace ring. Recording is on after
+ * 				reset when I2C_TRACE is set
+ *
+ * @parameters	bool - true to record
+ * @Returns		none
+ */
+void i2c_trace_enable(bool enable);
+
+/*
+ * @Name		i2c_trace_clear
+ * @Description	Empties the trace ring
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void i2c_trace_clear();
+
+/*
+ * @Name		i2c_trace_count
+ * @Description	Number of transactions currently held in the trace ring
+ *
+ * @parameters	none
+ * @Returns		uint16_t - records available, at most I2C_TRACE_LEN
+ */
+uint16_t i2c_trace_count();
+
+/*
+ * @Name		i2c_trace_get
+ * @Description	Copies a record out of the trace ring, index 0 being the oldest one
+ *
+ * @parameters	uint16_t, i2c_trace_rec_t* - record index and destination
+ * @Returns		bool - false if the index is out of range
+ */
+bool i2c_trace_get(uint16_t index, i2c_trace_rec_t *rec);
+
+/*
+ * @Name		i2c_trace_replay
+ * @Description	Starts or stops replaying the trace ring. While replaying, i2c_read_burst is served
+ * 				from the recorded reads of the same slave and register, in recorded order, and
+ * 				writes are dropped, so the drivers and the UI run on captured data without the
+ * 				bus. Replay stops by itself, returning I2C_ERR_NACK, when the trace is used up or
+ * 				a read is longer than its record (I2C_TRACE_DATA_MAX bytes at most)
+ *
+ * @parameters	bool - true to replay from the oldest record
+ * @Returns		none
+ */
+void i2c_trace_replay(bool enable);
+
+/*
+ * @Name		i2c_trace_replaying
+ * @Description	Reports whether reads are currently served from the trace
+ *
+ * @parameters	none
+ * @Returns		bool - true while replaying
+ */
+bool i2c_trace_replaying();
+
+#endif /* I2C_H_ */
@@ -0,0 +1,82 @@
+/*
+ * i2c_divider.h
+ *
+ * Created on: 12-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef I2C_DIVIDER_H_
+#define I2C_DIVIDER_H_
+
+/*
+ * Selection of the I2C frequency divider register (MULT and ICR fields) for a requested SCL
+ * rate. SCL = bus clock / (mul * SCL divider), where mul is 1, 2 or 4 and the SCL divider is
+ * picked by ICR from the table in the KL25Z reference manual (I2C divider and hold values).
+ * The code only depends on stdint so it builds for the target and for a Linux host alike, and
+ * is static inline so that calls with constant arguments can be folded by the compiler.
+ */
+
+//INCLUDES
+#include <stdint.h>
+
+//MACROS
+#define I2C_ICR_COUNT (64)
+#define I2C_MULT_COUNT (3)
+#define I2C_PPM (1000000)
+
+//Chosen divider setting and the SCL rate it achieves
+typedef struct
+{
+	uint8_t mult;			//MULT field, 0..2 for a multiplier of 1, 2 or 4
+	uint8_t icr;			//ICR field, index into the SCL divider table
+	uint32_t scl_hz;		//Achieved SCL rate
+	int32_t error_ppm;		//Deviation of the achieved from the requested rate
+} i2c_divider_t;
+
+//SCL divider for every ICR value (KL25Z reference manual, I2C divider and hold values)
+static const uint16_t i2c_scl_divider[I2C_ICR_COUNT] = {
+	20, 22, 24, 26, 28, 30, 34, 40, 28, 32, 36, 40, 44, 48, 56, 68,
+	48, 56, 64, 72, 80, 88, 104, 128, 80, 96, 112, 128, 144, 160, 192, 240,
+	160, 192, 224, 256, 288, 320, 384, 480, 320, 384, 448, 512, 576, 640, 768, 960,
+	640, 768, 896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840
+};
+
+/*
+ * @Name		i2c_divider_select
+ * @Description	Searches all MULT/ICR pairs for the fastest SCL rate that does not exceed the
+ * 				target, so a slave rated for the target rate is never overclocked. On equal rates
+ * 				the smaller multiplier wins, which keeps MULT at 0 whenever possible. If even the
+ * 				slowest setting is above the target, the slowest setting is returned
+ *
+ * @parameters	uint32_t, uint32_t - bus clock feeding the I2C module and target SCL rate in Hz
+ * @Returns		i2c_divider_t - register fields, achieved rate and error in ppm
+ */
+static inline i2c_divider_t i2c_divider_select(uint32_t bus_hz, uint32_t target_hz)
+{
+	i2c_divider_t best = {.mult = I2C_MULT_COUNT - 1, .icr = I2C_ICR_COUNT - 1, .scl_hz = 0};
+	uint32_t slowest = bus_hz / ((1U << (I2C_MULT_COUNT - 1)) * i2c_scl_divider[I2C_ICR_COUNT - 1]);
+
+	for(uint8_t mult = 0; mult < I2C_MULT_COUNT; mult++)
+	{
+		for(uint8_t icr = 0; icr < I2C_ICR_COUNT; icr++)
+		{
+			uint32_t rate = bus_hz / ((1U << mult) * i2c_scl_divider[icr]);
+			if(rate <= target_hz && rate > best.scl_hz)
+			{
+				best.mult = mult;
+				best.icr = icr;
+				best.scl_hz = rate;
+			}
+		}
+	}
+	if(best.scl_hz == 0)
+		best.scl_hz = slowest;
+
+	if(target_hz)
+		best.error_ppm = (int32_t)(((int64_t)best.scl_hz - target_hz) * I2C_PPM / target_hz);
+	else
+		best.error_ppm = 0;
+	return best;
+}
+
+#endif /* I2C_DIVIDER_H_ */
@@ -0,0 +1,36 @@
+/*
+ * i2c_regs.h
+ *
+ * Created on: 17-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef I2C_REGS_H_
+#define I2C_REGS_H_
+
+/*
+ * Register accesses of the I2C modules. On the board they are the memory mapped registers of
+ * MKL25Z4.h and the macros compile to the same loads and stores as a direct access, a set or
+ * clear being the read-modify-write of |= and &=. With I2C_HOST_MODEL (defined by the MKL25Z4.h
+ * of the host folder) an I2C_Type is the register model of host/i2c_model.h and every access
+ * goes through it, so the driver runs unmodified on a Linux host.
+ */
+
+//INCLUDES
+#include <stdint.h>
+
+//MACROS
+#ifdef I2C_HOST_MODEL
+#include "i2c_model.h"
+#define I2C_REG_RD(i2c, reg) i2c_model_read((i2c), I2C_MODEL_##reg)
+#define I2C_REG_WR(i2c, reg, value) i2c_model_write((i2c), I2C_MODEL_##reg, (value))
+#define I2C_REG_ADDR(i2c, name) ((uint32_t)(uintptr_t)&(i2c)->reg[I2C_MODEL_##name])
+#else
+#define I2C_REG_RD(i2c, reg) ((i2c)->reg)
+#define I2C_REG_WR(i2c, reg, value) ((i2c)->reg = (value))
+#define I2C_REG_ADDR(i2c, reg) ((uint32_t)&(i2c)->reg)		//Bus address, for the DMA
+#endif
+#define I2C_REG_SET(i2c, reg, mask) I2C_REG_WR(i2c, reg, I2C_REG_RD(i2c, reg) | (mask))
+#define I2C_REG_CLEAR(i2c, reg, mask) I2C_REG_WR(i2c, reg, I2C_REG_RD(i2c, reg) & ~(mask))
+
+#endif /* I2C_REGS_H_ */
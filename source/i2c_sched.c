@@ -0,0 +1,251 @@
+/**
+ * @file    i2c_sched.c
+ * @brief   Priority aware scheduler of periodic and one-shot I2C jobs on top of the transaction
+ * 			engine. A PIT tick releases the due jobs in priority order, the engine then runs them
+ * 			back-to-back and the completion callback accounts run time and deadline misses
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Date	05/16/2021
+ */
+
+//INCLUDES
+#include <MKL25Z4.H>
+#include <stdint.h>
+#include <stddef.h>
+#include "i2c_sched.h"
+#include "timebase.h"
+
+//MACROS
+#define SCHED_CH (1)
+#define SCHED_IRQ_PRIORITY (2)		//Below the I2C and DMA interrupts that complete the batch
+
+//Registered jobs sorted by priority
+static struct
+{
+	i2c_job_t *jobs[I2C_SCHED_MAX_JOBS];
+	volatile uint8_t count;
+} sched;
+
+/*
+ * @Name		sched_tick_enable
+ * @Description	Starts or stops the scheduler tick, it only runs while jobs are registered
+ *
+ * @parameters	bool - true to start the tick
+ * @Returns		none
+ */
+static void sched_tick_enable(bool enable)
+{
+	PIT->CHANNEL[SCHED_CH].TFLG = PIT_TFLG_TIF_MASK;
+	PIT->CHANNEL[SCHED_CH].TCTRL = enable ? (PIT_TCTRL_TIE_MASK | PIT_TCTRL_TEN_MASK) : 0;
+}
+
+/*
+ * @Name		sched_done
+ * @Description	Completion callback of every scheduled transaction, runs in the engine ISR.
+ * 				The run time is measured from the release, so a job that waited behind more
+ * 				urgent ones in the batch is charged for the wait
+ *
+ * @parameters	i2c_xfer_t* - the xfer member of the job that completed
+ * @Returns		none
+ */
+static void sched_done(i2c_xfer_t *xfer)
+{
+	i2c_job_t *job = (i2c_job_t *)xfer;
+	uint32_t elapsed_us = (timebase_now() - job->released) / TIMEBASE_US(1);
+	uint32_t limit_us = job->deadline_us ? job->deadline_us : job->period_us;
+
+	job->runs++;
+	if(xfer->status != I2C_OK)
+		job->errors++;
+	if(limit_us && elapsed_us > limit_us)
+		job->misses++;
+	if(elapsed_us > job->worst_us)
+		job->worst_us = elapsed_us;
+	job->in_flight = false;
+
+	if(job->callback)
+		job->callback(job);
+}
+
+/*
+ * @Name		sched_insert
+ * @Description	Inserts a job into the table behind the jobs of the same or higher priority.
+ * 				Called with interrupts masked
+ *
+ * @parameters	i2c_job_t* - the job to insert, the table has room for it
+ * @Returns		none
+ */
+static void sched_insert(i2c_job_t *job)
+{
+	uint8_t pos = sched.count;
+
+	while(pos && sched.jobs[pos - 1]->priority > job->priority)
+	{
+		sched.jobs[pos] = sched.jobs[pos - 1];
+		pos--;
+	}
+	sched.jobs[pos] = job;
+	sched.count++;
+}
+
+/*
+ * @Name		sched_delete
+ * @Description	Removes the job at the given position keeping the priority order. Called with
+ * 				interrupts masked
+ *
+ * @parameters	uint8_t - position in the table
+ * @Returns		none
+ */
+static void sched_delete(uint8_t pos)
+{
+	for(; pos + 1 < sched.count; pos++)
+		sched.jobs[pos] = sched.jobs[pos + 1];
+	sched.count--;
+	if(sched.count == 0)
+		sched_tick_enable(false);
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_sched_init()
+{
+	//The PIT clock and module are enabled by the timebase, channel 1 is left to the scheduler
+	sched.count = 0;
+	PIT->CHANNEL[SCHED_CH].TCTRL = 0;
+	PIT->CHANNEL[SCHED_CH].LDVAL = TIMEBASE_US(I2C_SCHED_TICK_US) - 1;
+
+	NVIC_SetPriority(PIT_IRQn, SCHED_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(PIT_IRQn);
+	NVIC_EnableIRQ(PIT_IRQn);
+}
+
+/*
+ * See documentation in .h file
+ */
+bool i2c_sched_add(i2c_job_t *job)
+{
+	uint32_t masking_state;
+	bool added = false;
+
+	if(job == NULL || job->bus >= I2C_BUS_COUNT)
+		return false;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	for(uint8_t i = 0; i < sched.count; i++)
+	{
+		if(sched.jobs[i] == job)
+		{
+			__set_PRIMASK(masking_state);
+			return false;
+		}
+	}
+	if(sched.count < I2C_SCHED_MAX_JOBS && !job->in_flight)
+	{
+		job->xfer.callback = sched_done;
+		job->release = timebase_now();
+		job->runs = 0;
+		job->errors = 0;
+		job->misses = 0;
+		job->worst_us = 0;
+		sched_insert(job);
+		if(sched.count == 1)
+			sched_tick_enable(true);
+		added = true;
+	}
+	__set_PRIMASK(masking_state);
+
+	return added;
+}
+
+/*
+ * See documentation in .h file
+ */
+void i2c_sched_remove(i2c_job_t *job)
+{
+	uint32_t masking_state;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	for(uint8_t i = 0; i < sched.count; i++)
+	{
+		if(sched.jobs[i] == job)
+		{
+			sched_delete(i);
+			break;
+		}
+	}
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * See documentation in .h file
+ */
+uint8_t i2c_sched_count()
+{
+	return sched.count;
+}
+
+/*
+ * See documentation in .h file
+ */
+const i2c_job_t *i2c_sched_get(uint8_t index)
+{
+	return (index < sched.count) ? sched.jobs[index] : NULL;
+}
+
+/*
+ * @Name		PIT_IRQHandler
+ * @Description	Scheduler tick: submits every due job in priority order. A periodic job whose
+ * 				previous run is still in flight, or whose releases fell behind, misses the
+ * 				release instead of piling up in the engine queue. One-shot jobs leave the
+ * 				table when they are released
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void PIT_IRQHandler(void)
+{
+	uint32_t now, period;
+	i2c_job_t *job;
+
+	PIT->CHANNEL[SCHED_CH].TFLG = PIT_TFLG_TIF_MASK;
+	now = timebase_now();
+
+	for(uint8_t i = 0; i < sched.count; i++)
+	{
+		job = sched.jobs[i];
+		if((int32_t)(now - job->release) < 0)
+			continue;
+
+		if(job->in_flight)
+		{
+			job->misses++;
+		}
+		else
+		{
+			job->released = now;
+			job->in_flight = true;
+			if(!i2c_submit_bus(job->bus, &job->xfer))
+			{
+				job->in_flight = false;
+				job->misses++;
+			}
+		}
+
+		if(job->period_us == 0)
+		{
+			sched_delete(i--);
+			continue;
+		}
+		//Next release one period later, skipping the ones already in the past
+		period = TIMEBASE_US(job->period_us);
+		job->release += period;
+		while((int32_t)(now - job->release) >= 0)
+		{
+			job->release += period;
+			job->misses++;
+		}
+	}
+}
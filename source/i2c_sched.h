@@ -0,0 +1,96 @@
+/*
+ * i2c_sched.h
+ *
+ * Created on: 16-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef I2C_SCHED_H_
+#define I2C_SCHED_H_
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+
+//MACROS
+#define I2C_SCHED_MAX_JOBS (8)		//Jobs that can be registered at the same time
+#define I2C_SCHED_TICK_US (1000)	//Release granularity of the scheduler (PIT channel 1)
+
+/* public types*/
+
+struct i2c_job;
+typedef void (*i2c_job_callback_t)(struct i2c_job *job);
+
+//A client of the scheduler: one register transaction released once or every period. The job
+//must stay valid while registered, its xfer member is owned by the scheduler
+typedef struct i2c_job
+{
+	i2c_xfer_t xfer;				//Transaction issued on every release (first member)
+	i2c_bus_t bus;					//Module the transaction runs on
+	const char *name;				//Shown by the sched command
+	uint32_t period_us;				//Release period, 0 for a one-shot job
+	uint32_t deadline_us;			//Completion deadline after the release, 0 for the period
+	uint8_t priority;				//0 is the most urgent, ties run in registration order
+	i2c_job_callback_t callback;	//Called from the ISR after every completion, may be NULL
+
+	//Bookkeeping of the scheduler
+	uint32_t release;				//Timebase tick of the next release
+	uint32_t released;				//Timebase tick of the release of the current run
+	volatile bool in_flight;		//Submitted and not completed yet
+	uint32_t runs;					//Completed runs
+	uint32_t errors;				//Runs that ended with an I2C error
+	uint32_t misses;				//Runs completed late or releases skipped or dropped
+	uint32_t worst_us;				//Longest release to completion time
+} i2c_job_t;
+
+/*
+ * @Name		i2c_sched_init
+ * @Description	Starts PIT channel 1 as the scheduler tick. On every tick the due jobs are
+ * 				submitted to their bus in priority order, so a batch runs back-to-back on the
+ * 				transaction engine without CPU involvement between the transactions.
+ * 				init_timebase and i2c_engine_init must have been called
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void i2c_sched_init();
+
+/*
+ * @Name		i2c_sched_add
+ * @Description	Registers a job, first released on the next tick. The statistics of the job
+ * 				are cleared. A one-shot job is removed after its run
+ *
+ * @parameters	i2c_job_t* - the job with xfer, bus, period, deadline and priority filled in
+ * @Returns		bool - false if the table is full, the job is invalid or already registered
+ */
+bool i2c_sched_add(i2c_job_t *job);
+
+/*
+ * @Name		i2c_sched_remove
+ * @Description	Unregisters a job. A transaction of the job still on the bus completes normally
+ *
+ * @parameters	i2c_job_t* - a registered job
+ * @Returns		none
+ */
+void i2c_sched_remove(i2c_job_t *job);
+
+/*
+ * @Name		i2c_sched_count
+ * @Description	Number of registered jobs
+ *
+ * @parameters	none
+ * @Returns		uint8_t - registered jobs
+ */
+uint8_t i2c_sched_count();
+
+/*
+ * @Name		i2c_sched_get
+ * @Description	Gives access to the registered jobs in priority order, used to report statistics
+ *
+ * @parameters	uint8_t - index, 0 is the most urgent job
+ * @Returns		const i2c_job_t* - the job, NULL past the last one
+ */
+const i2c_job_t *i2c_sched_get(uint8_t index);
+
+#endif /* I2C_SCHED_H_ */
@@ -0,0 +1,91 @@
+/**
+ * @file    lowpass.c
+ * @brief   q15/q31 fixed-point IIR low-pass stage on the accelerometer axis counts
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Date	05/24/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "lowpass.h"
+
+//MACROS
+#define Q15_ONE (32768U)
+#define STATE_SHIFT (16)				//q15 counts to the q31 state
+#define LOW_HALF (0xFFFF)
+#define TWO_PI_Q16 (411775U)			//2 pi in Q16
+#define CASCADE2_SCALE_Q16 (101830U)	//1/sqrt(sqrt(2) - 1) in Q16
+#define ONE_Q16 (65536U)
+
+/*
+ * @Name		scale_q15
+ * @Description	alpha * value in q31 with 32-bit multiplies only (the Cortex-M0+ has no long
+ * 				multiply): the value is split in its high and low halves
+ *
+ * @parameters	q15_t, q31_t - coefficient, value
+ * @Returns		q31_t - the product
+ */
+static q31_t scale_q15(q15_t alpha, q31_t value)
+{
+	return ((alpha * (value >> STATE_SHIFT)) << 1) + ((alpha * (value & LOW_HALF)) >> 15);
+}
+
+/*
+ * See documentation in .h file
+ */
+q15_t lowpass_alpha(uint32_t cutoff_mhz, uint32_t rate_mhz)
+{
+	uint64_t w = (uint64_t)TWO_PI_Q16 * cutoff_mhz;
+
+	if(rate_mhz == 0)
+		return 0;
+	//alpha = w / (1 + w) = 2 pi fc / (fs + 2 pi fc), w scaled by 2^16 on both sides
+	return (q15_t)(w * Q15_ONE / (((uint64_t)rate_mhz << 16) + w));
+}
+
+/*
+ * See documentation in .h file
+ */
+bool lowpass_config(lowpass_t *filter, uint8_t order, uint32_t cutoff_mhz, uint32_t rate_mhz)
+{
+	if(order > LOWPASS_MAX_ORDER || (order && (cutoff_mhz == 0 || cutoff_mhz >= rate_mhz / 2)))
+		return false;
+
+	if(order == LOWPASS_MAX_ORDER)
+		cutoff_mhz = (uint64_t)cutoff_mhz * CASCADE2_SCALE_Q16 / ONE_Q16;
+	filter->order = order;
+	filter->alpha = order ? lowpass_alpha(cutoff_mhz, rate_mhz) : 0;
+	filter->primed = false;
+	return true;
+}
+
+/*
+ * See documentation in .h file
+ */
+void lowpass_apply(lowpass_t *filter, mma_sample_t *sample)
+{
+	int16_t *axes[MMA_AXES] = {&sample->x, &sample->y, &sample->z};
+	q31_t value;
+
+	if(filter->order == 0)
+		return;
+
+	for(int axis = 0; axis < MMA_AXES; axis++)
+	{
+		//14-bit counts: the difference of two states cannot overflow 32 bits
+		value = (q31_t)*axes[axis] << STATE_SHIFT;
+		for(int section = 0; section < filter->order; section++)
+		{
+			if(!filter->primed)
+				filter->state[section][axis] = value;
+			filter->state[section][axis] += scale_q15(filter->alpha,
+					value - filter->state[section][axis]);
+			value = filter->state[section][axis];
+		}
+		//Rounded back to counts
+		*axes[axis] = clip_q31_to_q15((value + (1L << (STATE_SHIFT - 1))) >> STATE_SHIFT);
+	}
+	filter->primed = true;
+}
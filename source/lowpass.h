@@ -0,0 +1,73 @@
+/*
+ * lowpass.h
+ *
+ * Created on: 24-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef LOWPASS_H_
+#define LOWPASS_H_
+
+/*
+ * Low-pass IIR stage on the raw axis counts, between acquisition and angle conversion. One or two
+ * cascaded first-order sections y += alpha * (x - y), the backward Euler discretization of an RC
+ * low-pass, with alpha in q15 and the state in q31 (the counts taken as q15, 16 more fraction
+ * bits), so a sample costs a few integer multiplies and no floating point. The functions only
+ * compute, so the stage builds and can be checked against a floating point reference on a Linux
+ * host as well.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "arm_math.h"
+#include "mma8451.h"
+
+//MACROS
+#define LOWPASS_MAX_ORDER (2)			//Cascaded first-order sections
+
+/* public types*/
+
+//State of the stage for the three axes
+typedef struct
+{
+	uint8_t order;					//Sections in use, 0 passes the samples through
+	q15_t alpha;					//Coefficient of every section
+	bool primed;					//The state holds a sample, the first one sets it
+	q31_t state[LOWPASS_MAX_ORDER][MMA_AXES];
+} lowpass_t;
+
+/*
+ * @Name		lowpass_alpha
+ * @Description	Coefficient of one section for a cutoff at a sample rate,
+ * 				alpha = w / (1 + w) with w = 2 pi fc / fs, in integer arithmetic
+ *
+ * @parameters	uint32_t, uint32_t - cutoff and sample rate, both in mHz
+ * @Returns		q15_t - alpha, 0 for an invalid rate
+ */
+q15_t lowpass_alpha(uint32_t cutoff_mhz, uint32_t rate_mhz);
+
+/*
+ * @Name		lowpass_config
+ * @Description	Sets the order and the cutoff of the stage at a sample rate. With two sections the
+ * 				cutoff of each is raised by 1/sqrt(sqrt(2) - 1) so the cascade is 3 dB down at the
+ * 				requested cutoff. The state restarts from the next sample
+ *
+ * @parameters	lowpass_t* - the stage
+ * 				uint8_t - number of sections, 0 to LOWPASS_MAX_ORDER
+ * 				uint32_t, uint32_t - cutoff and sample rate, both in mHz
+ * @Returns		bool - false if the order is too high or the cutoff not below half the rate
+ */
+bool lowpass_config(lowpass_t *filter, uint8_t order, uint32_t cutoff_mhz, uint32_t rate_mhz);
+
+/*
+ * @Name		lowpass_apply
+ * @Description	Filters the axes of a sample in place. The first sample after a configuration
+ * 				initializes the state, so the output starts without a step from zero
+ *
+ * @parameters	lowpass_t*, mma_sample_t* - the stage, the sample
+ * @Returns		none
+ */
+void lowpass_apply(lowpass_t *filter, mma_sample_t *sample);
+
+#endif /* LOWPASS_H_ */
@@ -11,31 +11,44 @@
 #include "test_buffer.h"
 #include "LEDs.h"
 #include "i2c.h"
+#include "i2c_sched.h"
 #include "extra_switch.h"
 #include "touch.h"
 #include "test_mma.h"
 #include "mma8451.h"
+#include "timebase.h"
 #include "MKL25Z4.h"
 
 int main(void)
 {
+	mma_selftest_t selftest;
+
 	//Initialize the system clock
 	sysclock_init();
+	//Start the free running timebase used for timestamps and driver timing
+	init_timebase();
 	//Initialise the UART0 module
 	Init_UART0();
 	//Test the buffer if in DEBUG mode only
 	init_I2C();
+	i2c_engine_init();
+	init_I2C1();
+	i2c_sched_init();
 
 	Init_RGB_LEDs();
 #ifdef DEBUG
 		test_cbfifo();
 		test_accelerometer();
 	#endif
-	if (!init_MMA()) {
+	//The red LED reports an accelerometer that does not answer or fails its self-test
+	if (!init_MMA() || mma_self_test(&selftest) != I2C_OK || !selftest.pass) {
 		Control_RGB_LEDs(1, 0, 0);
 		while (1)
 			;
 	}
+#ifdef DEBUG
+	test_mma_fifo();
+#endif
 
 	init_TSI();
 	init_switch();
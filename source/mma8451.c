@@ -12,49 +12,473 @@
  */
 
 //INCLUDES
-#include <math.h>
 #include <stdint.h>
+#include <stddef.h>
 #include "i2c.h"
 #include "mma8451.h"
+#include "angle.h"
 #include "MKL25Z4.h"
+#include "timebase.h"
+#include "sample_timing.h"
+#include "selftest.h"
+#include "lowpass.h"
+#include "decimate.h"
 
 //MACROS
-#define MMA_DEV_ADDR (0x3A)
-#define REG_OUT_Y_MSB 0x03
-#define CTRL_REG1  0x2A
-#define ANGLE_CONV (180)
-#define PI_NUM (22)
-#define PI_DEN (7)
 #define MSB_SHIFT (8)
 #define ADJUST_OUT (2)
-#define OUT_MSB_Y (0)
-#define OUT_LSB_Y (1)
-#define OUT_MSB_Z (2)
-#define OUT_LSB_Z (3)
-#define SENSITIVITY (4096.0)
 #define SET_MMA_ACTIVE (0x01)
-#define TOTAL_AXIS_BYTES (4)
-#define LAST_AXIS_BYTE (2)
-#define SET (1)
-#define RESET (0)
-#define ACK_RXD (0)
 #define INIT_SUCCESS (1)
 #define INIT_FAILURE (0)
+#define SHADOW_IDX(reg) ((reg) - MMA_SHADOW_FIRST)
+#define SHADOW_BIT(reg) (1ULL << SHADOW_IDX(reg))
+#define MAX_MERGE_GAP (2)		//Clean writable registers rewritten to join two dirty runs
+#define MSB_X (0)
+#define MSB_Y (2)
+#define MSB_Z (4)
+#define STATUS_XYZ_BYTES (7)		//STATUS followed by OUT_X_MSB..OUT_Z_LSB
+#define OFFSET_LSB_PER_1024_COUNTS (125)	//OFF_x LSB is 2 mg in every range, 8.192 counts at +/-2 g
+#define FAST_READ_MAX (127)
+#define FAST_READ_MIN (-128)
+#define COUNTS_MAX (8191)			//14-bit output at the end of the range
+#define COUNTS_MIN (-8192)
+#define OFFSET_MIN (-128)
+#define OFFSET_MAX (127)
+#define CAL_SETTLE_SAMPLES (2)		//Samples dropped after the offsets are written
+#define MG_PER_G (1000)
+#define AXES (MMA_AXES)
+#define FF_MT_CFG_ELE (0x80)
+#define FF_MT_CFG_OAE (0x40)
+#define FF_MT_CFG_AXES_SHIFT (3)
+#define TRANSIENT_CFG_ELE (0x10)
+#define TRANSIENT_CFG_AXES_SHIFT (1)
+#define THS_DBCNTM (0x80)			//Debounce counter restarts as soon as the condition fails
+#define PL_CFG_DBCNTM (0x80)
+#define PL_CFG_PL_EN (0x40)
+#define PL_STATUS_LAPO_SHIFT (1)
+#define PL_STATUS_LAPO_MASK (0x06)
+#define PL_STATUS_BAFRO (0x01)
+#define DETECTOR_SOURCES (MMA_INT_EN_FF_MT | MMA_INT_EN_TRANS | MMA_INT_EN_LNDPRT)
+#define SYSMOD_MASK (0x03)
+#define SYSMOD_SLEEP (0x02)
+#define ASLP_COUNT_MAX (255)
+#define CTRL_REG3_WAKE_FF_MT (0x08)
+#define CTRL_REG3_WAKE_LNDPRT (0x20)
+#define CTRL_REG3_WAKE_TRANS (0x40)
+#define CTRL_REG3_WAKE_MASK (0x78)	//Pulse detector included
+#define FAST_Y (1)					//Offsets of the MSBs in the fast-read auto-increment map
+#define FAST_Z (2)
+#define STATUS_BYTE (0)
+#define PIN_MASK(x) (1UL << (x))
+#define GPIO_MUX (1)
+#define IRQC_FALLING (0xA)
+#define INT_IRQ_PRIORITY (2)
+#define DRDY_STALL_PERIODS (2)		//Sample periods without data before a read is forced
+#define DRDY_MAX_FORCED (3)			//Forced reads without a sample before the wait gives up
+#define MHZ_PER_HZ (1000U)
+#define US_PER_S (1000000U)
+#define CTRL_REG1_LNOISE (0x04)
+#define CTRL_REG2_ST (0x80)
+#define ST_SETTLE_SAMPLES (4)		//Samples dropped after a mode change, beyond the 2/ODR + 1 ms turn-on
+#define ST_SAMPLE_TIMEOUT_US (10000)
+#define ST_SAVED_REGS (4)
+
+//RAM copy of the writable control registers and the ones changed since the last flush
+typedef struct
+{
+	uint8_t regs[MMA_SHADOW_LEN];
+	uint64_t dirty;
+	uint8_t ctrl_reg1_device;	//CTRL_REG1 as last written to the device
+} mma_shadow_t;
+
+static mma_shadow_t shadow;
+
+//FIFO drain state: raw burst, converted block and the handler of the blocks
+typedef struct
+{
+	mma_fifo_mode_t mode;
+	uint8_t raw[MMA_FIFO_SIZE * MMA_SAMPLE_BYTES];
+	mma_sample_t block[MMA_FIFO_SIZE];
+	mma_block_handler_t handler;
+	uint32_t overflows;
+	volatile bool edge_valid;		//edge holds the time of an unserved watermark interrupt
+	volatile uint32_t edge;
+} mma_fifo_t;
+
+static mma_fifo_t fifo;
+
+//Data-ready interrupt state, the read descriptor is queued from PORTA_IRQHandler
+typedef struct
+{
+	bool enabled;
+	volatile bool fresh;			//latest holds a sample compute_angle has not used yet
+	volatile bool fifo_pending;		//FIFO watermark interrupt seen, drain on the next poll
+	uint8_t raw[STATUS_XYZ_BYTES];
+	i2c_xfer_t xfer;
+	volatile uint32_t edge;			//Timebase tick of the data-ready edge being served
+	volatile uint32_t received;
+	volatile uint32_t lost;
+	volatile uint32_t errors;
+} mma_int_t;
+
+static mma_int_t irq;
+
+//INT2 events of the embedded detectors
+static volatile bool event_pending;
+static volatile uint32_t event_edge;
+
+//Auto-sleep state, the rate listeners follow the transitions
+static bool aslp_enabled;
+static bool asleep;
+
+//Newest sample from the FIFO or the data-ready read
+static mma_sample_t latest;
+
+//8-bit fast-read mode configured (CTRL_REG1 F_READ)
+static bool fast_read;
+
+//Full-scale range configured (XYZ_DATA_CFG FS) and samples found at the end of it per axis
+static mma_range_t range;
+static volatile uint32_t saturated[AXES];
+
+//Timing of the samples delivered by the data-ready interrupt and the FIFO, and the sample
+//period in timebase ticks at the rate in effect
+static sample_timing_t timing;
+static uint32_t sample_ticks;
+
+//Low-pass stage applied to every sample delivered, and its setting kept across rate changes
+static lowpass_t lpf;
+static uint8_t lpf_order;
+static uint32_t lpf_cutoff_mhz;
+
+//Block averaging of the filtered samples for mma_acquire_decimated, dec_fresh flags an output
+//it has not taken yet
+static decimator_t dec = {.n = 1};
+static volatile bool dec_fresh;
+
+//Sample rate of every DR setting in mHz
+static const uint32_t odr_mhz[MMA_ODR_COUNT] = {
+		800000, 400000, 200000, 100000, 50000, 12500, 6250, 1563
+};
+
+//Stages told about the sample rate, and the data-ready stall timeout derived from it
+static mma_rate_listener_t rate_listeners[MMA_RATE_LISTENERS];
+static uint32_t drdy_stall_ticks;
+
+static void decode_xyz(const uint8_t *raw, mma_sample_t *sample);
+static uint8_t axis_bytes();
+static void rate_changed();
+static void aslp_poll();
+static void aslp_transition();
+
+//Writable registers within the shadow range, the others are read only or reserved
+static const uint64_t writable_mask =
+		SHADOW_BIT(MMA_REG_F_SETUP) | SHADOW_BIT(MMA_REG_TRIG_CFG) |
+		SHADOW_BIT(MMA_REG_XYZ_DATA_CFG) | SHADOW_BIT(MMA_REG_HP_FILTER_CUTOFF) |
+		SHADOW_BIT(MMA_REG_PL_CFG) | SHADOW_BIT(MMA_REG_PL_COUNT) |
+		SHADOW_BIT(MMA_REG_PL_BF_ZCOMP) | SHADOW_BIT(MMA_REG_P_L_THS) |
+		SHADOW_BIT(MMA_REG_FF_MT_CFG) | SHADOW_BIT(MMA_REG_FF_MT_THS) |
+		SHADOW_BIT(MMA_REG_FF_MT_COUNT) | SHADOW_BIT(MMA_REG_TRANSIENT_CFG) |
+		SHADOW_BIT(MMA_REG_TRANSIENT_THS) | SHADOW_BIT(MMA_REG_TRANSIENT_COUNT) |
+		SHADOW_BIT(MMA_REG_PULSE_CFG) | (SHADOW_BIT(MMA_REG_PULSE_WIND + 1) -
+		SHADOW_BIT(MMA_REG_PULSE_THSX)) | (SHADOW_BIT(MMA_SHADOW_LAST + 1) -
+		SHADOW_BIT(MMA_REG_ASLP_COUNT));
+
+//Datasheet names of the shadowed registers, indexed from F_SETUP
+static const char *const shadow_names[MMA_SHADOW_LEN] = {
+		"F_SETUP", "TRIG_CFG", "SYSMOD", "INT_SOURCE", "WHO_AM_I", "XYZ_DATA_CFG",
+		"HP_FILTER_CUTOFF", "PL_STATUS", "PL_CFG", "PL_COUNT", "PL_BF_ZCOMP", "P_L_THS_REG",
+		"FF_MT_CFG", "FF_MT_SRC", "FF_MT_THS", "FF_MT_COUNT", "RESERVED", "RESERVED",
+		"RESERVED", "RESERVED", "TRANSIENT_CFG", "TRANSIENT_SRC", "TRANSIENT_THS",
+		"TRANSIENT_COUNT", "PULSE_CFG", "PULSE_SRC", "PULSE_THSX", "PULSE_THSY", "PULSE_THSZ",
+		"PULSE_TMLT", "PULSE_LTCY", "PULSE_WIND", "ASLP_COUNT", "CTRL_REG1", "CTRL_REG2",
+		"CTRL_REG3", "CTRL_REG4", "CTRL_REG5", "OFF_X", "OFF_Y", "OFF_Z"
+};
 
 /*
  * See documentation in .h file
  */
 int init_MMA()
 {
-	//Initialize the accelerometer in active mode, with output data rate at 800 Hz
-	i2c_txByte(MMA_DEV_ADDR, CTRL_REG1, SET_MMA_ACTIVE);
+	fifo.overflows = 0;
+	irq.enabled = false;
+	irq.received = 0;
+	irq.lost = 0;
+	irq.errors = 0;
+
+	//Mirror the control registers of the device, a NACK here means the device is absent
+	if(mma_cache_load() != I2C_OK)
+		return INIT_FAILURE;
+
+	//The FIFO and auto-sleep keep their setting across a reset of the KL25Z alone
+	fifo.mode = (mma_fifo_mode_t)(mma_reg_read(MMA_REG_F_SETUP) >> MMA_F_SETUP_MODE_SHIFT);
+	aslp_enabled = mma_reg_read(MMA_REG_CTRL_REG2) & MMA_CTRL_REG2_SLPE;
+	range = (mma_range_t)(mma_reg_read(MMA_REG_XYZ_DATA_CFG) & MMA_XYZ_DATA_CFG_FS_MASK);
+	if(range >= MMA_RANGE_COUNT)
+		range = MMA_RANGE_8G;
+	for(int axis = 0; axis < AXES; axis++)
+		saturated[axis] = 0;
+	asleep = (mma_reg_read(MMA_REG_SYSMOD) & SYSMOD_MASK) == SYSMOD_SLEEP;
+
+	//Initialize the accelerometer in active mode, with output data rate at 800 Hz in normal
+	//oversampling mode
+	mma_reg_update(MMA_REG_CTRL_REG1, MMA_CTRL_REG1_DR_MASK | MMA_CTRL_REG1_F_READ | SET_MMA_ACTIVE,
+			(MMA_ODR_800HZ << MMA_CTRL_REG1_DR_SHIFT) | SET_MMA_ACTIVE);
+	fast_read = false;
+	mma_reg_update(MMA_REG_CTRL_REG2, MMA_CTRL_REG2_MODS_MASK, MMA_MODS_NORMAL);
 
 	//On successful acknowledge received from I2C device, the registers are set with
-	//the value and hence initialization complete; lack of ACK means initialization failure
-	if((I2C0->S & I2C_S_RXAK_MASK) ==ACK_RXD)
-		return INIT_SUCCESS;
-	else
+	//the value and hence initialization complete; lack of ACK means initialization failure.
+	//The data-ready interrupt is configured in the same flush
+	if(mma_int_enable(true) != I2C_OK)
 		return INIT_FAILURE;
+
+	rate_changed();
+	return INIT_SUCCESS;
+}
+
+/*
+ * @Name		rate_changed
+ * @Description	Derives the data-ready stall timeout from the configured rate and tells the
+ * 				listeners the new sample rate
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void rate_changed()
+{
+	uint32_t rate_mhz = mma_effective_rate();
+	uint32_t masking_state;
+
+	sample_ticks = (uint64_t)TIMEBASE_HZ * MHZ_PER_HZ / rate_mhz;
+	drdy_stall_ticks = DRDY_STALL_PERIODS * sample_ticks;
+
+	//The statistics are against the nominal period, they restart with the new one. The filter
+	//coefficient follows the rate, a cutoff the new rate cannot carry turns the filter off
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	sample_timing_reset(&timing, sample_ticks);
+	if(!lowpass_config(&lpf, lpf_order, lpf_cutoff_mhz, rate_mhz))
+		lowpass_config(&lpf, 0, 0, rate_mhz);
+	decimator_config(&dec, dec.n);
+	__set_PRIMASK(masking_state);
+
+	for(int i = 0; i < MMA_RATE_LISTENERS; i++)
+	{
+		if(rate_listeners[i])
+			rate_listeners[i](rate_mhz);
+	}
+}
+
+/*
+ * @Name		drdy_done
+ * @Description	Completion of the STATUS+XYZ read queued by the data-ready interrupt, runs in the
+ * 				engine ISR. Reading the data clears the data-ready source and releases INT1
+ *
+ * @parameters	i2c_xfer_t* - the read descriptor
+ * @Returns		none
+ */
+static void drdy_done(i2c_xfer_t *xfer)
+{
+	if(xfer->status != I2C_OK)
+	{
+		irq.errors++;
+		return;
+	}
+	if(irq.raw[STATUS_BYTE] & MMA_STATUS_ZYXOW)
+		irq.lost++;
+	decode_xyz(&irq.raw[STATUS_BYTE + 1], &latest);
+	latest.status = irq.raw[STATUS_BYTE];
+	latest.timestamp = irq.edge;
+	irq.received++;
+
+	//A read forced after a stall may find no new data, its time says nothing of the sample clock
+	if(latest.status & MMA_STATUS_ZYXDR)
+		sample_timing_add(&timing, latest.timestamp);
+	lowpass_apply(&lpf, &latest);
+	if(decimator_push(&dec, &latest))
+		dec_fresh = true;
+	irq.fresh = true;
+}
+
+/*
+ * @Name		drdy_read
+ * @Description	Queues the STATUS+XYZ read unless the previous one is still pending. Safe to call
+ * 				from thread mode and from the interrupt
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void drdy_read()
+{
+	uint32_t masking_state;
+
+	//Also called from thread mode, the check and the submit must not be split by the ISR
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	if(irq.xfer.done)
+	{
+		irq.edge = timebase_now();
+		i2c_submit(&irq.xfer);
+	}
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * @Name		dec_restart
+ * @Description	Drops the partial block and the noise estimate of the decimator after the scale or
+ * 				the offset of the samples changed. Safe against the data-ready interrupt
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void dec_restart()
+{
+	uint32_t masking_state;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	decimator_config(&dec, dec.n);
+	dec_fresh = false;
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * @Name		drdy_wait
+ * @Description	Waits for a sample delivered by the data-ready interrupt and takes it. INT1 is
+ * 				edge triggered, so if a read was lost (bus error) the pin stays asserted and no
+ * 				further edge comes: after DRDY_STALL_PERIODS sample periods without a sample a
+ * 				read is queued by hand. The wait ends after DRDY_MAX_FORCED such periods, when
+ * 				the device does not answer or the reads keep failing
+ *
+ * @parameters	mma_sample_t* - receives the sample
+ * @Returns		i2c_status_t - I2C_OK, the error of the last read or I2C_ERR_TIMEOUT if the
+ * 				read never completed
+ */
+static i2c_status_t drdy_wait(mma_sample_t *sample)
+{
+	uint32_t masking_state;
+	uint32_t start = timebase_now();
+	uint8_t forced = 0;
+
+	while(!irq.fresh)
+	{
+		if(timebase_now() - start >= drdy_stall_ticks)
+		{
+			if(forced++ == DRDY_MAX_FORCED)
+			{
+				if(irq.xfer.done && irq.xfer.status != I2C_OK)
+					return irq.xfer.status;
+				return I2C_ERR_TIMEOUT;
+			}
+			drdy_read();
+			start = timebase_now();
+		}
+	}
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	*sample = latest;
+	irq.fresh = false;
+	__set_PRIMASK(masking_state);
+	return I2C_OK;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_read_sample(mma_sample_t *sample)
+{
+	uint8_t raw[STATUS_XYZ_BYTES];
+	i2c_status_t status;
+
+	//STATUS and the three axes in one burst, the same single transaction the Y/Z read used to be
+	status = i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, raw, 1 + axis_bytes());
+	if(status != I2C_OK)
+		return status;
+
+	decode_xyz(&raw[STATUS_BYTE + 1], sample);
+	sample->status = raw[STATUS_BYTE];
+	sample->timestamp = timebase_now();
+	return I2C_OK;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_acquire(mma_sample_t *sample)
+{
+	uint8_t drained;
+	i2c_status_t status = I2C_OK;
+
+	//A sleep/wake transition changes the sample period the wait below depends on
+	if(aslp_enabled && event_pending)
+		aslp_poll();
+
+	if(fifo.mode != MMA_FIFO_OFF)
+	{
+		//The output registers are the FIFO head now: drain blocks and use the newest sample.
+		//With the interrupt on, STATUS is only read once the watermark has been signalled
+		if(!irq.enabled || irq.fifo_pending || i2c_trace_replaying())
+		{
+			irq.fifo_pending = false;
+			status = mma_fifo_poll(&drained);
+		}
+		*sample = latest;
+	}
+	else if(irq.enabled && !i2c_trace_replaying())
+	{
+		//One bus read per sample, done by the interrupt: wait for a sample not used yet
+		status = drdy_wait(sample);
+	}
+	else
+	{
+		status = mma_read_sample(sample);
+		if(status == I2C_OK)
+		{
+			lowpass_apply(&lpf, sample);
+			//A poll faster than the ODR reads the same sample again, it is averaged once
+			if((sample->status & MMA_STATUS_ZYXDR) && decimator_push(&dec, sample))
+				dec_fresh = true;
+		}
+	}
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_acquire_decimated(mma_sample_t *sample)
+{
+	uint32_t masking_state;
+	uint32_t start, limit;
+	i2c_status_t status;
+
+	if(dec.n == 1)
+		return mma_acquire(sample);
+
+	//A FIFO block may hold the whole decimation block, it is only drained at the watermark
+	start = timebase_now();
+	limit = (dec.n + MMA_FIFO_SIZE + DRDY_STALL_PERIODS) * sample_ticks;
+	while(!dec_fresh)
+	{
+		if((status = mma_acquire(sample)) != I2C_OK)
+			return status;
+		if(timebase_now() - start >= limit)
+			break;
+	}
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	status = I2C_ERR_TIMEOUT;
+	if(dec_fresh)
+	{
+		status = I2C_OK;
+		*sample = dec.out;
+		dec_fresh = false;
+	}
+	__set_PRIMASK(masking_state);
+	return status;
 }
 
 /*
@@ -62,44 +486,1156 @@ int init_MMA()
  */
 int compute_angle()
 {
-	//variables to read axis value, convert them to 14-bit values and convert
-	//from radian to angles
-	int angle=RESET,ack=SET;
-	uint8_t axis_value[TOTAL_AXIS_BYTES];
-	int16_t y_axis_read,z_axis_read;
-	float radians_y,radians_z;
+	int32_t angle;
+
+	if(compute_angle_cdeg(&angle) != I2C_OK)
+		return MMA_ANGLE_INVALID;
+	return angle / ANGLE_CDEG;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t compute_angle_cdeg(int32_t *angle)
+{
+	mma_sample_t sample;
+	i2c_status_t status;
+
+	//A failed read leaves no sample to convert, a zeroed one would read as level
+	status = mma_acquire_decimated(&sample);
+	if(status != I2C_OK)
+		return status;
+
+	//The orientation of the board along its long edge is the roll angle of the sample
+	*angle = angle_roll_cdeg(&sample);
+	return I2C_OK;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_reg_cached(uint8_t reg)
+{
+	return reg >= MMA_SHADOW_FIRST && reg <= MMA_SHADOW_LAST && (writable_mask & SHADOW_BIT(reg));
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_reg_dirty(uint8_t reg)
+{
+	return mma_reg_cached(reg) && (shadow.dirty & SHADOW_BIT(reg));
+}
+
+/*
+ * See documentation in .h file
+ */
+const char *mma_reg_name(uint8_t reg)
+{
+	if(!mma_reg_cached(reg))
+		return NULL;
+	return shadow_names[SHADOW_IDX(reg)];
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_cache_load()
+{
+	i2c_status_t status;
+
+	status = i2c_read_burst(MMA_DEV_ADDR, MMA_SHADOW_FIRST, shadow.regs, MMA_SHADOW_LEN);
+	if(status == I2C_OK)
+	{
+		shadow.dirty = 0;
+		shadow.ctrl_reg1_device = shadow.regs[SHADOW_IDX(MMA_REG_CTRL_REG1)];
+	}
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint8_t mma_reg_read(uint8_t reg)
+{
+	if(mma_reg_cached(reg))
+		return shadow.regs[SHADOW_IDX(reg)];
+	return i2c_rxByte(MMA_DEV_ADDR, reg);
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_reg_write(uint8_t reg, uint8_t value)
+{
+	if(!mma_reg_cached(reg))
+	{
+		i2c_txByte(MMA_DEV_ADDR, reg, value);
+		return;
+	}
+	if(shadow.regs[SHADOW_IDX(reg)] != value)
+	{
+		shadow.regs[SHADOW_IDX(reg)] = value;
+		shadow.dirty |= SHADOW_BIT(reg);
+	}
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_reg_update(uint8_t reg, uint8_t mask, uint8_t value)
+{
+	mma_reg_write(reg, (mma_reg_read(reg) & ~mask) | (value & mask));
+}
+
+/*
+ * @Name		flush_run
+ * @Description	Writes one burst of shadow registers starting at the given register. The run is
+ * 				extended over following dirty registers and over gaps of up to MAX_MERGE_GAP clean
+ * 				writable registers when a dirty one follows, but never across a read only register
+ *
+ * @parameters	uint8_t - first register of the run, must be dirty
+ * 				uint8_t - value to send for CTRL_REG1 if it is part of the run
+ * @Returns		i2c_status_t - result of the burst write
+ */
+static i2c_status_t flush_run(uint8_t first, uint8_t ctrl_reg1)
+{
+	uint8_t buf[MMA_SHADOW_LEN];
+	uint8_t last = first, gap = 0;
+	i2c_status_t status;
+
+	for(uint8_t reg = first + 1; reg <= MMA_SHADOW_LAST && mma_reg_cached(reg); reg++)
+	{
+		if(shadow.dirty & SHADOW_BIT(reg))
+		{
+			last = reg;
+			gap = 0;
+		}
+		else if(++gap > MAX_MERGE_GAP)
+			break;
+	}
+
+	for(uint8_t reg = first; reg <= last; reg++)
+		buf[reg - first] = shadow.regs[SHADOW_IDX(reg)];
+	if(first <= MMA_REG_CTRL_REG1 && last >= MMA_REG_CTRL_REG1)
+		buf[MMA_REG_CTRL_REG1 - first] = ctrl_reg1;
+
+	status = i2c_write_burst(MMA_DEV_ADDR, first, buf, last - first + 1);
+	if(status == I2C_OK)
+		shadow.dirty &= ~(SHADOW_BIT(last + 1) - SHADOW_BIT(first));
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_flush()
+{
+	uint8_t ctrl_reg1 = shadow.regs[SHADOW_IDX(MMA_REG_CTRL_REG1)];
+	uint8_t standby = ctrl_reg1 & ~MMA_CTRL_REG1_ACTIVE;
+	i2c_status_t status;
+
+	if(!shadow.dirty)
+		return I2C_OK;
+
+	//Only the ACTIVE bit changes: a single byte write, no standby needed
+	if(!(shadow.dirty & ~SHADOW_BIT(MMA_REG_CTRL_REG1)) &&
+			!((ctrl_reg1 ^ shadow.ctrl_reg1_device) & ~MMA_CTRL_REG1_ACTIVE))
+	{
+		status = flush_run(MMA_REG_CTRL_REG1, ctrl_reg1);
+		if(status == I2C_OK)
+			shadow.ctrl_reg1_device = ctrl_reg1;
+		return status;
+	}
+
+	//The first burst starts at CTRL_REG1 so that its first byte puts the part in STANDBY and
+	//CTRL_REG2..OFF_Z changes ride along in the same transaction
+	shadow.dirty |= SHADOW_BIT(MMA_REG_CTRL_REG1);
+	if((status = flush_run(MMA_REG_CTRL_REG1, standby)) != I2C_OK)
+		return status;
+	shadow.ctrl_reg1_device = standby;
+
+	//Remaining dirty runs in ascending register order
+	for(uint8_t reg = MMA_SHADOW_FIRST; reg <= MMA_SHADOW_LAST; reg++)
+	{
+		if(shadow.dirty & SHADOW_BIT(reg))
+		{
+			if((status = flush_run(reg, standby)) != I2C_OK)
+				return status;
+		}
+	}
+
+	//Back to ACTIVE once every register is configured
+	if(ctrl_reg1 != standby)
+	{
+		shadow.dirty |= SHADOW_BIT(MMA_REG_CTRL_REG1);
+		if((status = flush_run(MMA_REG_CTRL_REG1, ctrl_reg1)) != I2C_OK)
+			return status;
+		shadow.ctrl_reg1_device = ctrl_reg1;
+	}
+	return I2C_OK;
+}
+
+/*
+ * @Name		raw_to_counts
+ * @Description	Joins the MSB and LSB of an output register pair into a signed 14-bit value, the
+ * 				2 least significant bits of the left aligned register pair are always 0
+ *
+ * @parameters	const uint8_t* - MSB followed by LSB
+ * @Returns		int16_t - acceleration in counts
+ */
+static int16_t raw_to_counts(const uint8_t *msb)
+{
+	return ((int16_t)((msb[0] << MSB_SHIFT) | msb[1])) >> ADJUST_OUT;
+}
+
+/*
+ * @Name		axis_bytes
+ * @Description	Bytes of the X, Y and Z output registers read per sample in the configured mode
+ *
+ * @parameters	none
+ * @Returns		uint8_t - 6 at full resolution, 3 in fast-read mode
+ */
+static uint8_t axis_bytes()
+{
+	return fast_read ? MMA_FAST_SAMPLE_BYTES : MMA_SAMPLE_BYTES;
+}
+
+/*
+ * @Name		decode_xyz
+ * @Description	Converts the output register bytes of a sample into its axes: OUT_X_MSB..OUT_Z_LSB
+ * 				at full resolution, or the three MSBs in fast-read mode, scaled to 14-bit counts.
+ * 				Tags the sample with the range and counts the saturated axes
+ *
+ * @parameters	const uint8_t*, mma_sample_t* - raw register bytes and the sample to fill
+ * @Returns		none
+ */
+static void decode_xyz(const uint8_t *raw, mma_sample_t *sample)
+{
+	int16_t max = COUNTS_MAX, min = COUNTS_MIN;
 
-	//Initiate the start sequence and initialize to read register with address 0x03
-	//which corresponds to the Y-AXIS MSB output as per accelerometer register map
-	i2c_start_seq();
-	i2c_read_addr(MMA_DEV_ADDR, REG_OUT_Y_MSB );
-	
-	//Read total of 4 bytes starting with Most significant Byte value of y-axis until least
-	//significant byte of z-axis which corresponds to reading the real-time 14 bit sample
-	//output values of y and z axis
-	for( int i=RESET; i<TOTAL_AXIS_BYTES; i++)
+	sample->range = range;
+	if(fast_read)
+	{
+		sample->x = (int8_t)raw[MSB_X] * MMA_FAST_READ_SCALE;
+		sample->y = (int8_t)raw[FAST_Y] * MMA_FAST_READ_SCALE;
+		sample->z = (int8_t)raw[FAST_Z] * MMA_FAST_READ_SCALE;
+		max = FAST_READ_MAX * MMA_FAST_READ_SCALE;
+		min = FAST_READ_MIN * MMA_FAST_READ_SCALE;
+	}
+	else
 	{
-		//Read register and master transmits ACK on reception since nack value is not yet set
-		axis_value[i] = i2c_read_reg(ack);
+		sample->x = raw_to_counts(&raw[MSB_X]);
+		sample->y = raw_to_counts(&raw[MSB_Y]);
+		sample->z = raw_to_counts(&raw[MSB_Z]);
+	}
+
+	//An axis at the end of the range has clipped, the angles of the sample are not valid
+	if(sample->x >= max || sample->x <= min)
+		saturated[0]++;
+	if(sample->y >= max || sample->y <= min)
+		saturated[1]++;
+	if(sample->z >= max || sample->z <= min)
+		saturated[2]++;
+}
+
+/*
+ * @Name		int_route
+ * @Description	Enables the interrupt source matching the FIFO mode in the shadow and routes it
+ * 				to INT1, the other source is disabled
+ *
+ * @parameters	mma_fifo_mode_t - FIFO mode the interrupt has to serve
+ * @Returns		none
+ */
+static void int_route(mma_fifo_mode_t mode)
+{
+	uint8_t source = (mode == MMA_FIFO_OFF) ? MMA_INT_EN_DRDY : MMA_INT_EN_FIFO;
+
+	mma_reg_update(MMA_REG_CTRL_REG4, MMA_INT_EN_DRDY | MMA_INT_EN_FIFO, source);
+	mma_reg_update(MMA_REG_CTRL_REG5, MMA_INT_EN_DRDY | MMA_INT_EN_FIFO, source);
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_fifo_config(mma_fifo_mode_t mode, uint8_t watermark)
+{
+	i2c_status_t status;
 
-		//For the last byte to be read, setting of ack indicates NACK is sent to convey end of read
-		if(i==LAST_AXIS_BYTE)
-			ack=RESET;
+	if(mode != MMA_FIFO_OFF && (watermark == 0 || watermark > MMA_FIFO_SIZE))
+		return I2C_ERR_ARG;
+
+	mma_reg_write(MMA_REG_F_SETUP, (mode << MMA_F_SETUP_MODE_SHIFT) |
+			(watermark & MMA_F_SETUP_WMRK_MASK));
+	if(irq.enabled)
+		int_route(mode);
+	status = mma_flush();
+	if(status == I2C_OK)
+	{
+		fifo.mode = mode;
+		//Back to data-ready: a sample may already hold INT1 low, read it to get the next edge
+		if(irq.enabled && mode == MMA_FIFO_OFF)
+			drdy_read();
 	}
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_fifo_set_handler(mma_block_handler_t handler)
+{
+	fifo.handler = handler;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_fifo_poll(uint8_t *drained)
+{
+	uint8_t status_reg, count, watermark, anchor;
+	uint32_t anchor_time;
+	i2c_status_t status;
+
+	*drained = 0;
+	if(fifo.mode == MMA_FIFO_OFF)
+		return I2C_OK;
+
+	//Without a watermark edge the newest sample is dated by the STATUS read
+	anchor_time = timebase_now();
 
-	//Appending MSB to LSB of y and z axis measurements and adjusting 16 bit values to the valid
-	//14 bit output values by shifting the least significant 2 bits which are always 0
-	y_axis_read=(((int16_t) ((axis_value[OUT_MSB_Y]<<MSB_SHIFT) | axis_value[OUT_LSB_Y]))>>ADJUST_OUT);
-	z_axis_read=(((int16_t) ((axis_value[OUT_MSB_Z]<<MSB_SHIFT) | axis_value[OUT_LSB_Z]))>>ADJUST_OUT);
+	if((status = i2c_read_burst(MMA_DEV_ADDR, MMA_REG_STATUS, &status_reg, 1)) != I2C_OK)
+		return status;
+	if(status_reg & MMA_STATUS_F_OVF)
+		fifo.overflows++;
+	count = status_reg & MMA_STATUS_F_CNT_MASK;
+	if(!(status_reg & MMA_STATUS_F_WMRK_FLAG) || count == 0)
+		return I2C_OK;
+	if(count > MMA_FIFO_SIZE)
+		count = MMA_FIFO_SIZE;
 
-	//The digital sensitivity of MMA8451 in 2g mode is set to 4096 counts/g as per specifications
-	//The acceleration in g-force measurement is hence output values per g or sensitivity
-	radians_y = y_axis_read/SENSITIVITY;
-	radians_z = z_axis_read/SENSITIVITY;
+	//One burst for the whole block, the FIFO pops a sample every time OUT_Z_LSB is read
+	status = i2c_read_burst(MMA_DEV_ADDR, MMA_REG_OUT_X_MSB, fifo.raw, count * axis_bytes());
+	if(status != I2C_OK)
+		return status;
 
-	//inverse tan math function evaluates the quadrant in which the angle is present
-	//The resultant value is in radian, hence converted to angle and returned
-	angle = atan2(radians_y, radians_z)*ANGLE_CONV*PI_DEN/PI_NUM;
-	return angle;
+	//The FIFO does not date its samples: the sample that reached the watermark was taken at
+	//the watermark edge (else the newest one at the STATUS read), the others are one sample
+	//period apart from it
+	watermark = mma_reg_read(MMA_REG_F_SETUP) & MMA_F_SETUP_WMRK_MASK;
+	anchor = count - 1;
+	if(fifo.edge_valid && watermark && watermark <= count)
+	{
+		anchor = watermark - 1;
+		anchor_time = fifo.edge;
+	}
+	fifo.edge_valid = false;
+
+	//Every sample of the block carries the STATUS of the drain
+	for(uint8_t i = 0; i < count; i++)
+	{
+		decode_xyz(&fifo.raw[i * axis_bytes()], &fifo.block[i]);
+		fifo.block[i].status = status_reg;
+		fifo.block[i].timestamp = anchor_time + (int32_t)(i - anchor) * (int32_t)sample_ticks;
+		sample_timing_add(&timing, fifo.block[i].timestamp);
+		lowpass_apply(&lpf, &fifo.block[i]);
+		if(decimator_push(&dec, &fifo.block[i]))
+			dec_fresh = true;
+	}
+	latest = fifo.block[count - 1];
+	*drained = count;
+
+	if(fifo.handler)
+		fifo.handler(fifo.block, count);
+	return I2C_OK;
 }
 
+/*
+ * See documentation in .h file
+ */
+uint32_t mma_fifo_overflows()
+{
+	return fifo.overflows;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_int_enable(bool enable)
+{
+	i2c_status_t status;
+
+	if(enable)
+	{
+		//PTA14 as GPIO input interrupting on the falling edge of the active low INT1
+		SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK;
+		PORTA->PCR[MMA_INT1_PIN] = PORT_PCR_MUX(GPIO_MUX) | PORT_PCR_IRQC(IRQC_FALLING) |
+				PORT_PCR_ISF_MASK;
+		PTA->PDDR &= ~PIN_MASK(MMA_INT1_PIN);
+
+		irq.xfer = (i2c_xfer_t){.dev_addr = MMA_DEV_ADDR, .reg = MMA_REG_STATUS, .dir = I2C_READ,
+				.buf = irq.raw, .len = 1 + axis_bytes(), .callback = drdy_done, .done = true};
+		irq.fresh = false;
+		irq.fifo_pending = true;
+		int_route(fifo.mode);
+	}
+	else
+	{
+		//Only the INT1 pin interrupt is stopped, PORTA also serves the detectors on INT2
+		PORTA->PCR[MMA_INT1_PIN] &= ~(PORT_PCR_IRQC_MASK | PORT_PCR_ISF_MASK);
+		irq.enabled = false;
+		mma_reg_update(MMA_REG_CTRL_REG4, MMA_INT_EN_DRDY | MMA_INT_EN_FIFO, 0);
+	}
+
+	status = mma_flush();
+	if(status != I2C_OK || !enable)
+	{
+		irq.enabled = false;
+		return status;
+	}
+
+	irq.enabled = true;
+	NVIC_SetPriority(PORTA_IRQn, INT_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(PORTA_IRQn);
+	NVIC_EnableIRQ(PORTA_IRQn);
+
+	//INT1 may already be asserted by a sample from before, read it so that the next one gives
+	//an edge
+	if(fifo.mode == MMA_FIFO_OFF)
+		drdy_read();
+	return I2C_OK;
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_int_stats(uint32_t *received, uint32_t *lost, uint32_t *errors)
+{
+	*received = irq.received;
+	*lost = irq.lost;
+	*errors = irq.errors;
+}
+
+/*
+ * @Name		PORTA_IRQHandler
+ * @Description	INT1 of the accelerometer: with the FIFO off the new sample is read through the
+ * 				transaction engine, with the FIFO on the next compute_angle drains the block.
+ * 				INT2 flags an event of the embedded detectors
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void PORTA_IRQHandler(void)
+{
+	uint32_t flags = PORTA->ISFR;
+
+	//Write 1 to clear the flags of this port, INT1 and INT2 are expected to interrupt
+	PORTA->ISFR = flags;
+
+	//The detector sources are read in thread mode, the event wakes the application
+	if(flags & PIN_MASK(MMA_INT2_PIN))
+	{
+		event_edge = timebase_now();
+		event_pending = true;
+	}
+
+	if(!(flags & PIN_MASK(MMA_INT1_PIN)) || !irq.enabled)
+		return;
+
+	if(fifo.mode != MMA_FIFO_OFF)
+	{
+		if(!fifo.edge_valid)
+		{
+			fifo.edge = timebase_now();
+			fifo.edge_valid = true;
+		}
+		irq.fifo_pending = true;
+	}
+	else
+		drdy_read();
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t mma_odr_mhz(mma_odr_t odr)
+{
+	return (odr < MMA_ODR_COUNT) ? odr_mhz[odr] : 0;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t mma_get_rate(mma_odr_t *odr, mma_mods_t *mods)
+{
+	mma_odr_t dr = (mma_odr_t)((mma_reg_read(MMA_REG_CTRL_REG1) & MMA_CTRL_REG1_DR_MASK) >>
+			MMA_CTRL_REG1_DR_SHIFT);
+
+	if(odr)
+		*odr = dr;
+	if(mods)
+		*mods = (mma_mods_t)(mma_reg_read(MMA_REG_CTRL_REG2) & MMA_CTRL_REG2_MODS_MASK);
+	return odr_mhz[dr];
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_set_rate(mma_odr_t odr, mma_mods_t mods)
+{
+	i2c_status_t status;
+
+	if(odr >= MMA_ODR_COUNT || mods >= MMA_MODS_COUNT)
+		return I2C_ERR_ARG;
+
+	mma_reg_update(MMA_REG_CTRL_REG1, MMA_CTRL_REG1_DR_MASK, odr << MMA_CTRL_REG1_DR_SHIFT);
+	mma_reg_update(MMA_REG_CTRL_REG2, MMA_CTRL_REG2_MODS_MASK, mods);
+	status = mma_flush();
+	if(status == I2C_OK)
+		rate_changed();
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_rate_subscribe(mma_rate_listener_t listener)
+{
+	for(int i = 0; i < MMA_RATE_LISTENERS; i++)
+	{
+		if(rate_listeners[i] == NULL)
+		{
+			rate_listeners[i] = listener;
+			listener(mma_effective_rate());
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_set_fast_read(bool enable)
+{
+	i2c_status_t status = I2C_OK;
+
+	//No data-ready read may be queued or on the bus while the length and the decoding change.
+	//The read is bounded by the engine deadline, if it failed the mode is left alone
+	if(irq.enabled)
+	{
+		NVIC_DisableIRQ(PORTA_IRQn);
+		if(!irq.xfer.done)
+			status = i2c_wait(&irq.xfer);
+	}
+
+	if(status == I2C_OK)
+	{
+		mma_reg_update(MMA_REG_CTRL_REG1, MMA_CTRL_REG1_F_READ, enable ? MMA_CTRL_REG1_F_READ : 0);
+		status = mma_flush();
+	}
+	if(status == I2C_OK)
+	{
+		fast_read = enable;
+		irq.xfer.len = 1 + axis_bytes();
+	}
+
+	//INT1 may have been asserted meanwhile without an edge being served, read the sample
+	if(irq.enabled)
+	{
+		NVIC_EnableIRQ(PORTA_IRQn);
+		if(fifo.mode == MMA_FIFO_OFF)
+			drdy_read();
+	}
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_fast_read()
+{
+	return fast_read;
+}
+
+/*
+ * @Name		cal_collect
+ * @Description	Sums the next samples of the stream, each of them once. mma_acquire hands out the
+ * 				newest FIFO sample as long as no new block is drained, so with the FIFO on every
+ * 				sample of the drained blocks is taken instead. Otherwise only samples flagged new
+ * 				by ZYXDR count: a poll faster than the ODR, or a read forced after a data-ready
+ * 				stall, returns the previous one again
+ *
+ * @parameters	int32_t* - receives the X, Y, Z sums
+ * 				int - samples to take
+ * @Returns		i2c_status_t - I2C_OK, the first failed acquisition, or I2C_ERR_TIMEOUT if they
+ * 				did not come within a FIFO more sample periods
+ */
+static i2c_status_t cal_collect(int32_t *sum, int samples)
+{
+	uint32_t start = timebase_now();
+	uint32_t limit = (samples + MMA_FIFO_SIZE + DRDY_STALL_PERIODS) * sample_ticks;
+	mma_sample_t sample;
+	i2c_status_t status;
+	uint8_t drained;
+	int count = 0;
+
+	for(int axis = 0; axis < AXES; axis++)
+		sum[axis] = 0;
+	while(count < samples)
+	{
+		if(timebase_now() - start >= limit)
+			return I2C_ERR_TIMEOUT;
+
+		if(fifo.mode != MMA_FIFO_OFF)
+		{
+			//Same drain as mma_acquire, a watermark already signalled is taken care of here
+			irq.fifo_pending = false;
+			if((status = mma_fifo_poll(&drained)) != I2C_OK)
+				return status;
+			for(uint8_t i = 0; i < drained && count < samples; i++, count++)
+			{
+				sum[0] += fifo.block[i].x;
+				sum[1] += fifo.block[i].y;
+				sum[2] += fifo.block[i].z;
+			}
+			continue;
+		}
+
+		if((status = mma_acquire(&sample)) != I2C_OK)
+			return status;
+		if(!(sample.status & MMA_STATUS_ZYXDR))
+			continue;
+		sum[0] += sample.x;
+		sum[1] += sample.y;
+		sum[2] += sample.z;
+		count++;
+	}
+	return I2C_OK;
+}
+
+/*
+ * @Name		cal_mean
+ * @Description	Averages MMA_CAL_SAMPLES new samples and returns the deviation from the reference
+ * 				pose (0, 0, +1 g) of each axis
+ *
+ * @parameters	int32_t* - receives the X, Y, Z error in counts
+ * @Returns		i2c_status_t - I2C_OK, or the failure of cal_collect
+ */
+static i2c_status_t cal_mean(int32_t *error)
+{
+	const int32_t expected[AXES] = {0, 0, MMA_RANGE_COUNTS_PER_G(range)};
+	int32_t sum[AXES];
+	i2c_status_t status;
+
+	if((status = cal_collect(sum, MMA_CAL_SAMPLES)) != I2C_OK)
+		return status;
+	for(int axis = 0; axis < AXES; axis++)
+		error[axis] = sum[axis] / MMA_CAL_SAMPLES - expected[axis];
+	return I2C_OK;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_calibrate_zero(mma_cal_result_t *result)
+{
+	static const uint8_t off_reg[AXES] = {MMA_REG_OFF_X, MMA_REG_OFF_Y, MMA_REG_OFF_Z};
+	int32_t error[AXES], offset[AXES];
+
+	result->in_range = true;
+	if((result->status = cal_mean(error)) != I2C_OK)
+		return result->status;
+
+	//The registers add to the output, so the new offset is the current one minus the error,
+	//rounded to the nearest 2 mg step. A count weighs twice as much with every range step
+	for(int axis = 0; axis < AXES; axis++)
+	{
+		int32_t delta = error[axis] * OFFSET_LSB_PER_1024_COUNTS * (1 << range);
+		delta = (delta >= 0) ? (delta + 512) / 1024 : (delta - 512) / 1024;
+		offset[axis] = (int8_t)mma_reg_read(off_reg[axis]) - delta;
+		if(offset[axis] < OFFSET_MIN || offset[axis] > OFFSET_MAX)
+			result->in_range = false;
+	}
+
+	if(result->in_range)
+	{
+		for(int axis = 0; axis < AXES; axis++)
+			mma_reg_write(off_reg[axis], (uint8_t)offset[axis]);
+		if((result->status = mma_flush()) != I2C_OK)
+			return result->status;
+
+		//Samples converted around the STANDBY/ACTIVE transition are not corrected yet, and the
+		//filter state still holds the uncorrected pose
+		lpf.primed = false;
+		if((result->status = cal_collect(error, CAL_SETTLE_SAMPLES)) != I2C_OK)
+			return result->status;
+		dec_restart();
+		if((result->status = cal_mean(error)) != I2C_OK)
+			return result->status;
+	}
+
+	for(int axis = 0; axis < AXES; axis++)
+	{
+		result->offset[axis] = (int8_t)mma_reg_read(off_reg[axis]);
+		result->residual_mg[axis] = error[axis] * MG_PER_G / MMA_RANGE_COUNTS_PER_G(range);
+	}
+	return result->status;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_calibrate_clear()
+{
+	mma_reg_write(MMA_REG_OFF_X, 0);
+	mma_reg_write(MMA_REG_OFF_Y, 0);
+	mma_reg_write(MMA_REG_OFF_Z, 0);
+	return mma_flush();
+}
+
+/*
+ * @Name		detector_route
+ * @Description	Enables or disables a detector interrupt in the shadow, routed to INT2, and sets
+ * 				up the INT2 pin interrupt on PTA15 when a detector is enabled
+ *
+ * @parameters	uint8_t, bool - CTRL_REG4 enable bit of the detector, true to enable
+ * @Returns		none
+ */
+static void detector_route(uint8_t source, bool enable)
+{
+	mma_reg_update(MMA_REG_CTRL_REG4, source, enable ? source : 0);
+	mma_reg_update(MMA_REG_CTRL_REG5, source, 0);
+	if(!enable)
+		return;
+
+	//PTA15 as GPIO input interrupting on the falling edge of the active low INT2. The pin may
+	//already be low from an event latched earlier, so the first poll reads the sources anyway
+	SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK;
+	PORTA->PCR[MMA_INT2_PIN] = PORT_PCR_MUX(GPIO_MUX) | PORT_PCR_IRQC(IRQC_FALLING) |
+			PORT_PCR_ISF_MASK;
+	PTA->PDDR &= ~PIN_MASK(MMA_INT2_PIN);
+	event_edge = timebase_now();
+	event_pending = true;
+	NVIC_SetPriority(PORTA_IRQn, INT_IRQ_PRIORITY);
+	NVIC_EnableIRQ(PORTA_IRQn);
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_motion_config(bool freefall, const mma_detect_cfg_t *cfg)
+{
+	if(cfg)
+	{
+		if(cfg->threshold > MMA_DETECT_THS_MAX)
+			return I2C_ERR_ARG;
+		mma_reg_write(MMA_REG_FF_MT_CFG, FF_MT_CFG_ELE | (freefall ? 0 : FF_MT_CFG_OAE) |
+				((cfg->axes & (MMA_AXIS_X | MMA_AXIS_Y | MMA_AXIS_Z)) << FF_MT_CFG_AXES_SHIFT));
+		mma_reg_write(MMA_REG_FF_MT_THS, THS_DBCNTM | cfg->threshold);
+		mma_reg_write(MMA_REG_FF_MT_COUNT, cfg->debounce);
+	}
+	detector_route(MMA_INT_EN_FF_MT, cfg != NULL);
+	return mma_flush();
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_transient_config(const mma_detect_cfg_t *cfg)
+{
+	if(cfg)
+	{
+		if(cfg->threshold > MMA_DETECT_THS_MAX)
+			return I2C_ERR_ARG;
+		mma_reg_write(MMA_REG_TRANSIENT_CFG, TRANSIENT_CFG_ELE |
+				((cfg->axes & (MMA_AXIS_X | MMA_AXIS_Y | MMA_AXIS_Z)) << TRANSIENT_CFG_AXES_SHIFT));
+		mma_reg_write(MMA_REG_TRANSIENT_THS, THS_DBCNTM | cfg->threshold);
+		mma_reg_write(MMA_REG_TRANSIENT_COUNT, cfg->debounce);
+	}
+	detector_route(MMA_INT_EN_TRANS, cfg != NULL);
+	return mma_flush();
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_orientation_config(bool enable, uint8_t debounce)
+{
+	mma_reg_update(MMA_REG_PL_CFG, PL_CFG_DBCNTM | PL_CFG_PL_EN,
+			enable ? (PL_CFG_DBCNTM | PL_CFG_PL_EN) : 0);
+	if(enable)
+		mma_reg_write(MMA_REG_PL_COUNT, debounce);
+	detector_route(MMA_INT_EN_LNDPRT, enable);
+	return mma_flush();
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t mma_effective_rate()
+{
+	if(asleep)
+		return odr_mhz[MMA_ODR_50HZ + ((mma_reg_read(MMA_REG_CTRL_REG1) & MMA_CTRL_REG1_ASLP_MASK) >>
+				MMA_CTRL_REG1_ASLP_SHIFT)];
+	return mma_get_rate(NULL, NULL);
+}
+
+/*
+ * @Name		aslp_transition
+ * @Description	Services the ASLP source: reading SYSMOD clears it and tells the new state, the
+ * 				rate listeners are told the rate now in effect
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void aslp_transition()
+{
+	bool sleeping = (mma_reg_read(MMA_REG_SYSMOD) & SYSMOD_MASK) == SYSMOD_SLEEP;
+
+	if(sleeping != asleep)
+	{
+		asleep = sleeping;
+		rate_changed();
+	}
+}
+
+/*
+ * @Name		aslp_poll
+ * @Description	Services a pending INT2 for the sake of auto-sleep only. The detector sources are
+ * 				left latched, with the event still pending, for mma_event_get
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+static void aslp_poll()
+{
+	uint8_t sources;
+
+	event_pending = false;
+	sources = mma_reg_read(MMA_REG_INT_SOURCE);
+	if(sources & MMA_INT_EN_ASLP)
+		aslp_transition();
+	if(sources & DETECTOR_SOURCES)
+		event_pending = true;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_autosleep_config(const mma_autosleep_cfg_t *cfg)
+{
+	uint32_t step_ms = MMA_ASLP_STEP_MS;
+	uint32_t count;
+	uint8_t wake = 0;
+	i2c_status_t status;
+
+	if(cfg)
+	{
+		if(cfg->sleep_odr >= MMA_ASLP_COUNT || cfg->sleep_mods >= MMA_MODS_COUNT || !cfg->wake)
+			return I2C_ERR_ARG;
+		if(mma_get_rate(NULL, NULL) == odr_mhz[MMA_ODR_1_56HZ])
+			step_ms *= 2;
+		count = (cfg->idle_ms + step_ms - 1) / step_ms;
+		if(count == 0 || count > ASLP_COUNT_MAX)
+			return I2C_ERR_ARG;
+
+		if(cfg->wake & MMA_INT_EN_FF_MT)
+			wake |= CTRL_REG3_WAKE_FF_MT;
+		if(cfg->wake & MMA_INT_EN_TRANS)
+			wake |= CTRL_REG3_WAKE_TRANS;
+		if(cfg->wake & MMA_INT_EN_LNDPRT)
+			wake |= CTRL_REG3_WAKE_LNDPRT;
+		mma_reg_write(MMA_REG_ASLP_COUNT, count);
+		mma_reg_update(MMA_REG_CTRL_REG1, MMA_CTRL_REG1_ASLP_MASK,
+				cfg->sleep_odr << MMA_CTRL_REG1_ASLP_SHIFT);
+		mma_reg_update(MMA_REG_CTRL_REG2, MMA_CTRL_REG2_SMODS_MASK,
+				cfg->sleep_mods << MMA_CTRL_REG2_SMODS_SHIFT);
+	}
+	mma_reg_update(MMA_REG_CTRL_REG3, CTRL_REG3_WAKE_MASK, wake);
+	mma_reg_update(MMA_REG_CTRL_REG2, MMA_CTRL_REG2_SLPE, cfg ? MMA_CTRL_REG2_SLPE : 0);
+	detector_route(MMA_INT_EN_ASLP, cfg != NULL);
+
+	//The flush goes through standby, which wakes the device
+	status = mma_flush();
+	if(status == I2C_OK)
+	{
+		aslp_enabled = (cfg != NULL);
+		aslp_transition();
+	}
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_asleep()
+{
+	return asleep;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_event_pending()
+{
+	return event_pending;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_event_get(mma_event_t *event)
+{
+	uint8_t pl_status;
+
+	if(!event_pending)
+		return false;
+	event_pending = false;
+
+	//Reading the source registers clears the latched events, INT2 is released once all are read
+	event->timestamp = event_edge;
+	event->sources = mma_reg_read(MMA_REG_INT_SOURCE) & (DETECTOR_SOURCES | MMA_INT_EN_ASLP);
+	if(event->sources & MMA_INT_EN_ASLP)
+		aslp_transition();
+	event->asleep = asleep;
+	event->ff_mt = (event->sources & MMA_INT_EN_FF_MT) ? mma_reg_read(MMA_REG_FF_MT_SRC) : 0;
+	event->transient = (event->sources & MMA_INT_EN_TRANS) ?
+			mma_reg_read(MMA_REG_TRANSIENT_SRC) : 0;
+	if(event->sources & MMA_INT_EN_LNDPRT)
+	{
+		pl_status = mma_reg_read(MMA_REG_PL_STATUS);
+		event->orientation = (mma_orientation_t)((pl_status & PL_STATUS_LAPO_MASK) >>
+				PL_STATUS_LAPO_SHIFT);
+		event->back = pl_status & PL_STATUS_BAFRO;
+	}
+
+	//A detector that latched during the reads keeps INT2 low without a new edge
+	if(mma_reg_read(MMA_REG_INT_SOURCE) & (DETECTOR_SOURCES | MMA_INT_EN_ASLP))
+		event_pending = true;
+	return event->sources != 0;
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_timing_get(sample_timing_t *copy)
+{
+	uint32_t masking_state;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	*copy = timing;
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_timing_reset()
+{
+	uint32_t masking_state;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	sample_timing_reset(&timing, sample_ticks);
+	__set_PRIMASK(masking_state);
+}
+
+/*
+ * @Name		st_collect
+ * @Description	Drops ST_SETTLE_SAMPLES samples then reads the requested number, each one polled
+ * 				on STATUS ZYXDR
+ *
+ * @parameters	mma_sample_t*, uint8_t - receives the samples, number of samples
+ * @Returns		i2c_status_t - result of the reads, I2C_ERR_TIMEOUT if a sample did not come
+ */
+static i2c_status_t st_collect(mma_sample_t *samples, uint8_t count)
+{
+	mma_sample_t sample;
+	uint32_t start;
+	i2c_status_t status;
+
+	for(int i = -ST_SETTLE_SAMPLES; i < count; i++)
+	{
+		start = timebase_now();
+		do
+		{
+			if((status = mma_read_sample(&sample)) != I2C_OK)
+				return status;
+			if(timebase_now() - start > TIMEBASE_US(ST_SAMPLE_TIMEOUT_US))
+				return I2C_ERR_TIMEOUT;
+		} while(!(sample.status & MMA_STATUS_ZYXDR));
+		if(i >= 0)
+			samples[i] = sample;
+	}
+	return I2C_OK;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_self_test(mma_selftest_t *result)
+{
+	static const uint8_t saved_regs[ST_SAVED_REGS] = {MMA_REG_F_SETUP, MMA_REG_XYZ_DATA_CFG,
+			MMA_REG_CTRL_REG1, MMA_REG_CTRL_REG2};
+	mma_sample_t off[MMA_ST_SAMPLES], on[MMA_ST_SAMPLES];
+	uint8_t saved[ST_SAVED_REGS];
+	bool int_enabled = irq.enabled, was_fast_read = fast_read;
+	mma_range_t was_range = range;
+	uint32_t start = timebase_now();
+	i2c_status_t status, restored;
+
+	*result = (mma_selftest_t){0};
+	if(int_enabled)
+		mma_int_enable(false);
+	for(int i = 0; i < ST_SAVED_REGS; i++)
+		saved[i] = mma_reg_read(saved_regs[i]);
+
+	//Polled full resolution samples at 800 Hz in the range the self-test change is specified for
+	fast_read = false;
+	range = MMA_RANGE_4G;
+	mma_reg_update(MMA_REG_F_SETUP, ~MMA_F_SETUP_WMRK_MASK, MMA_FIFO_OFF << MMA_F_SETUP_MODE_SHIFT);
+	mma_reg_write(MMA_REG_XYZ_DATA_CFG, MMA_RANGE_4G);
+	mma_reg_update(MMA_REG_CTRL_REG1, MMA_CTRL_REG1_DR_MASK | CTRL_REG1_LNOISE |
+			MMA_CTRL_REG1_F_READ | MMA_CTRL_REG1_ACTIVE,
+			(MMA_ODR_800HZ << MMA_CTRL_REG1_DR_SHIFT) | MMA_CTRL_REG1_ACTIVE);
+	mma_reg_write(MMA_REG_CTRL_REG2, MMA_MODS_NORMAL);
+	status = mma_flush();
+	if(status == I2C_OK)
+		status = st_collect(off, MMA_ST_SAMPLES);
+	if(status == I2C_OK)
+	{
+		mma_reg_write(MMA_REG_CTRL_REG2, CTRL_REG2_ST | MMA_MODS_NORMAL);
+		status = mma_flush();
+	}
+	if(status == I2C_OK)
+		status = st_collect(on, MMA_ST_SAMPLES);
+
+	//Restore the settings, the saved CTRL_REG2 has ST clear
+	for(int i = 0; i < ST_SAVED_REGS; i++)
+		mma_reg_write(saved_regs[i], saved[i]);
+	restored = mma_flush();
+	if(status == I2C_OK)
+		status = restored;
+	fast_read = was_fast_read;
+	range = was_range;
+	if(int_enabled)
+		mma_int_enable(true);
+
+	result->status = status;
+	if(status == I2C_OK)
+		selftest_evaluate(off, on, MMA_ST_SAMPLES, result);
+	result->duration_us = (timebase_now() - start) / TIMEBASE_US(1);
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+i2c_status_t mma_set_range(mma_range_t new_range, bool hpf_out)
+{
+	i2c_status_t status;
+
+	if(new_range >= MMA_RANGE_COUNT)
+		return I2C_ERR_ARG;
+
+	//The flush writes the range in standby
+	mma_reg_update(MMA_REG_XYZ_DATA_CFG, MMA_XYZ_DATA_CFG_FS_MASK | MMA_XYZ_DATA_CFG_HPF_OUT,
+			new_range | (hpf_out ? MMA_XYZ_DATA_CFG_HPF_OUT : 0));
+	status = mma_flush();
+	if(status == I2C_OK)
+	{
+		range = new_range;
+		lpf.primed = false;
+		dec_restart();
+		for(int axis = 0; axis < AXES; axis++)
+			saturated[axis] = 0;
+	}
+	return status;
+}
+
+/*
+ * See documentation in .h file
+ */
+mma_range_t mma_get_range(bool *hpf_out)
+{
+	if(hpf_out)
+		*hpf_out = mma_reg_read(MMA_REG_XYZ_DATA_CFG) & MMA_XYZ_DATA_CFG_HPF_OUT;
+	return range;
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_saturation(uint32_t *counts)
+{
+	for(int axis = 0; axis < AXES; axis++)
+		counts[axis] = saturated[axis];
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_lowpass_config(uint8_t order, uint32_t cutoff_mhz)
+{
+	uint32_t masking_state;
+	bool valid;
+
+	//The data-ready interrupt filters samples, the stage changes between two of them
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	valid = lowpass_config(&lpf, order, cutoff_mhz, mma_effective_rate());
+	__set_PRIMASK(masking_state);
+	if(valid)
+	{
+		lpf_order = order;
+		lpf_cutoff_mhz = cutoff_mhz;
+	}
+	return valid;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint8_t mma_lowpass_get(uint32_t *cutoff_mhz)
+{
+	*cutoff_mhz = lpf_cutoff_mhz;
+	return lpf.order;
+}
+
+/*
+ * See documentation in .h file
+ */
+bool mma_decimation_config(uint16_t n)
+{
+	uint32_t masking_state;
+	bool valid;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	valid = decimator_config(&dec, n);
+	dec_fresh = false;
+	__set_PRIMASK(masking_state);
+	return valid;
+}
+
+/*
+ * See documentation in .h file
+ */
+void mma_decimation_stats(mma_decim_stats_t *stats)
+{
+	uint32_t masking_state;
+
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	stats->n = dec.n;
+	stats->out_rate_mhz = mma_effective_rate() / dec.n;
+	stats->blocks = dec.blocks;
+	for(int axis = 0; axis < AXES; axis++)
+	{
+		stats->raw_var[axis] = decimator_variance(&dec, axis);
+		stats->out_var[axis] = stats->raw_var[axis] / dec.n;
+	}
+	__set_PRIMASK(masking_state);
+}
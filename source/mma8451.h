@@ -7,11 +7,272 @@
 #ifndef MMA8451_H
 #define MMA8451_H
 
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+#include "sample_timing.h"
+
+//MACROS
+#define MMA_DEV_ADDR (0x3A)
+
+//Register map of the MMA8451Q
+#define MMA_REG_STATUS (0x00)
+#define MMA_REG_OUT_X_MSB (0x01)
+#define MMA_REG_OUT_Y_MSB (0x03)
+#define MMA_REG_OUT_Z_MSB (0x05)
+#define MMA_REG_F_SETUP (0x09)
+#define MMA_REG_TRIG_CFG (0x0A)
+#define MMA_REG_SYSMOD (0x0B)
+#define MMA_REG_INT_SOURCE (0x0C)
+#define MMA_REG_WHO_AM_I (0x0D)
+#define MMA_REG_XYZ_DATA_CFG (0x0E)
+#define MMA_REG_HP_FILTER_CUTOFF (0x0F)
+#define MMA_REG_PL_STATUS (0x10)
+#define MMA_REG_PL_CFG (0x11)
+#define MMA_REG_PL_COUNT (0x12)
+#define MMA_REG_PL_BF_ZCOMP (0x13)
+#define MMA_REG_P_L_THS (0x14)
+#define MMA_REG_FF_MT_CFG (0x15)
+#define MMA_REG_FF_MT_SRC (0x16)
+#define MMA_REG_FF_MT_THS (0x17)
+#define MMA_REG_FF_MT_COUNT (0x18)
+#define MMA_REG_TRANSIENT_CFG (0x1D)
+#define MMA_REG_TRANSIENT_SRC (0x1E)
+#define MMA_REG_TRANSIENT_THS (0x1F)
+#define MMA_REG_TRANSIENT_COUNT (0x20)
+#define MMA_REG_PULSE_CFG (0x21)
+#define MMA_REG_PULSE_SRC (0x22)
+#define MMA_REG_PULSE_THSX (0x23)
+#define MMA_REG_PULSE_WIND (0x28)
+#define MMA_REG_ASLP_COUNT (0x29)
+#define MMA_REG_CTRL_REG1 (0x2A)
+#define MMA_REG_CTRL_REG2 (0x2B)
+#define MMA_REG_CTRL_REG3 (0x2C)
+#define MMA_REG_CTRL_REG4 (0x2D)
+#define MMA_REG_CTRL_REG5 (0x2E)
+#define MMA_REG_OFF_X (0x2F)
+#define MMA_REG_OFF_Y (0x30)
+#define MMA_REG_OFF_Z (0x31)
+
+#define MMA_CTRL_REG1_ACTIVE (0x01)
+#define MMA_CTRL_REG1_F_READ (0x02)
+#define MMA_CTRL_REG1_DR_SHIFT (3)
+#define MMA_CTRL_REG1_DR_MASK (0x38)
+#define MMA_CTRL_REG1_ASLP_SHIFT (6)
+#define MMA_CTRL_REG1_ASLP_MASK (0xC0)
+#define MMA_CTRL_REG2_SLPE (0x04)
+#define MMA_CTRL_REG2_SMODS_SHIFT (3)
+#define MMA_CTRL_REG2_SMODS_MASK (0x18)
+#define MMA_ASLP_STEP_MS (320)		//ASLP_COUNT step, doubled when the active ODR is 1.56 Hz
+#define MMA_CTRL_REG2_MODS_MASK (0x03)
+#define MMA_RATE_LISTENERS (4)		//Stages that can be told about sample rate changes
+#define MMA_COUNTS_PER_G (4096)		//14-bit counts per g in the +/-2 g range
+#define MMA_RANGE_COUNTS_PER_G(range) (MMA_COUNTS_PER_G >> (range))
+#define MMA_XYZ_DATA_CFG_FS_MASK (0x03)
+#define MMA_XYZ_DATA_CFG_HPF_OUT (0x10)
+#define MMA_AXES (3)
+#define MMA_ANGLE_INVALID (INT32_MIN)	//compute_angle result when no sample could be read
+#define MMA_CAL_SAMPLES (32)		//Samples averaged by the zero calibration
+#define MMA_ST_SAMPLES (8)			//Samples averaged with the self-test off and on
+
+//FIFO: F_SETUP holds the mode and watermark, STATUS reports overflow, watermark and sample count
+#define MMA_FIFO_SIZE (32)
+#define MMA_F_SETUP_MODE_SHIFT (6)
+#define MMA_F_SETUP_WMRK_MASK (0x3F)
+#define MMA_STATUS_F_OVF (0x80)
+#define MMA_STATUS_F_WMRK_FLAG (0x40)
+#define MMA_STATUS_F_CNT_MASK (0x3F)
+#define MMA_SAMPLE_BYTES (6)		//X, Y and Z, MSB first
+#define MMA_FAST_SAMPLE_BYTES (3)	//X, Y and Z MSBs only in fast-read mode
+#define MMA_FAST_READ_SCALE (64)	//8-bit fast-read value to 14-bit counts
+
+//Data-ready and FIFO interrupts, enabled in CTRL_REG4 and routed to INT1 by CTRL_REG5
+#define MMA_STATUS_ZYXOW (0x80)		//A sample was overwritten before it was read
+#define MMA_STATUS_ZYXDR (0x08)
+#define MMA_INT_EN_DRDY (0x01)
+#define MMA_INT_EN_FIFO (0x40)
+#define MMA_INT1_PIN (14)			//INT1 is wired to PTA14 on the FRDM-KL25Z
+#define MMA_INT2_PIN (15)			//INT2 is wired to PTA15, used by the embedded detectors
+
+//Embedded detectors: enable bits in CTRL_REG4 and sources in INT_SOURCE
+#define MMA_INT_EN_FF_MT (0x04)
+#define MMA_INT_EN_LNDPRT (0x10)
+#define MMA_INT_EN_TRANS (0x20)
+#define MMA_INT_EN_ASLP (0x80)		//Sleep/wake transition of the auto-sleep function
+#define MMA_DETECT_THS_MG (63)		//FF_MT and transient threshold step, 0.063 g
+#define MMA_DETECT_THS_MAX (127)
+
+//Axis selection of the motion and transient detectors
+#define MMA_AXIS_X (0x01)
+#define MMA_AXIS_Y (0x02)
+#define MMA_AXIS_Z (0x04)
+
+//FF_MT_SRC and TRANSIENT_SRC: event active and per axis flags
+#define MMA_FF_MT_SRC_EA (0x80)
+#define MMA_FF_MT_SRC_ZHE (0x20)
+#define MMA_FF_MT_SRC_YHE (0x08)
+#define MMA_FF_MT_SRC_XHE (0x02)
+#define MMA_TRANSIENT_SRC_EA (0x40)
+#define MMA_TRANSIENT_SRC_ZE (0x20)
+#define MMA_TRANSIENT_SRC_YE (0x08)
+#define MMA_TRANSIENT_SRC_XE (0x02)
+
+//Registers held in the RAM shadow, F_SETUP up to OFF_Z
+#define MMA_SHADOW_FIRST MMA_REG_F_SETUP
+#define MMA_SHADOW_LAST MMA_REG_OFF_Z
+#define MMA_SHADOW_LEN (MMA_SHADOW_LAST - MMA_SHADOW_FIRST + 1)
+
+/* public types*/
+
+//FIFO modes of F_SETUP
+typedef enum
+{
+	MMA_FIFO_OFF = 0,			//Output registers hold the latest sample
+	MMA_FIFO_CIRCULAR,			//Oldest sample is discarded when the FIFO is full
+	MMA_FIFO_FILL				//Sampling into the FIFO stops when it is full
+} mma_fifo_mode_t;
+
+//Output data rates, values of the CTRL_REG1 DR field
+typedef enum
+{
+	MMA_ODR_800HZ = 0,
+	MMA_ODR_400HZ,
+	MMA_ODR_200HZ,
+	MMA_ODR_100HZ,
+	MMA_ODR_50HZ,
+	MMA_ODR_12_5HZ,
+	MMA_ODR_6_25HZ,
+	MMA_ODR_1_56HZ,
+	MMA_ODR_COUNT
+} mma_odr_t;
+
+//Oversampling modes while awake, values of the CTRL_REG2 MODS field
+typedef enum
+{
+	MMA_MODS_NORMAL = 0,
+	MMA_MODS_LOW_NOISE_LOW_POWER,
+	MMA_MODS_HIGH_RES,
+	MMA_MODS_LOW_POWER,
+	MMA_MODS_COUNT
+} mma_mods_t;
+
+//Configuration of the freefall/motion or the transient detector
+typedef struct
+{
+	uint8_t axes;					//MMA_AXIS_x flags of the axes checked
+	uint8_t threshold;				//Steps of 0.063 g, up to MMA_DETECT_THS_MAX
+	uint8_t debounce;				//Samples the condition must hold before the event fires
+} mma_detect_cfg_t;
+
+//Orientation reported by the portrait/landscape detector (PL_STATUS LAPO)
+typedef enum
+{
+	MMA_PORTRAIT_UP = 0,
+	MMA_PORTRAIT_DOWN,
+	MMA_LANDSCAPE_RIGHT,
+	MMA_LANDSCAPE_LEFT
+} mma_orientation_t;
+
+//A decoded detector interrupt
+typedef struct
+{
+	uint32_t timestamp;				//Timebase tick of the INT2 edge
+	uint8_t sources;				//MMA_INT_EN_FF_MT/TRANS/LNDPRT/ASLP flags of the sources that fired
+	uint8_t ff_mt;					//FF_MT_SRC, axes past the threshold
+	uint8_t transient;				//TRANSIENT_SRC, axes with a transient and its polarity
+	mma_orientation_t orientation;	//New orientation when the LNDPRT source fired
+	bool back;						//Board face down (orientation detector)
+	bool asleep;					//Auto-sleep state after the ASLP source fired
+} mma_event_t;
+
+//Sample rate used while auto-sleep has put the device to sleep (CTRL_REG1 ASLP_RATE)
+typedef enum
+{
+	MMA_ASLP_50HZ = 0,
+	MMA_ASLP_12_5HZ,
+	MMA_ASLP_6_25HZ,
+	MMA_ASLP_1_56HZ,
+	MMA_ASLP_COUNT
+} mma_aslp_odr_t;
+
+//Auto-sleep setting: idle time, sleep rate and the detectors that wake the device
+typedef struct
+{
+	uint32_t idle_ms;				//Time without a wake event before sleeping, 320 ms steps
+	mma_aslp_odr_t sleep_odr;
+	mma_mods_t sleep_mods;			//Oversampling mode while asleep
+	uint8_t wake;					//MMA_INT_EN_FF_MT/TRANS/LNDPRT detectors waking the device
+} mma_autosleep_cfg_t;
+
+//Outcome of a zero calibration, axes in X, Y, Z order
+typedef struct
+{
+	i2c_status_t status;			//Result of the bus transfers
+	bool in_range;					//The correction fitted the offset registers and was written
+	int8_t offset[MMA_AXES];		//OFF_X/OFF_Y/OFF_Z after the calibration, 2 mg per LSB
+	int16_t residual_mg[MMA_AXES];	//Mean error left at the reference pose after the correction
+} mma_cal_result_t;
+
+//Outcome of the self-test, axes in X, Y, Z order
+typedef struct
+{
+	i2c_status_t status;			//Result of the bus transfers
+	bool pass;						//Every check below passed
+	int16_t delta[MMA_AXES];		//Mean output change with the self-test on, +/-4 g counts
+	bool delta_ok[MMA_AXES];		//Change within the accepted window
+	bool stuck[MMA_AXES];			//Output never changed
+	bool saturated[MMA_AXES];		//Output reached the end of the range
+	uint32_t duration_us;			//Time the self-test took
+} mma_selftest_t;
+
+//Setting and noise floor of the decimation ahead of the angle conversion. Variances are in
+//counts^2 with DECIMATE_VAR_Q (8) fraction bits, measured inside the blocks since the last
+//configuration, rate or range change
+typedef struct
+{
+	uint16_t n;						//Samples averaged per output
+	uint32_t out_rate_mhz;			//Output rate at the sample rate in effect
+	uint32_t blocks;				//Blocks in the noise estimate, none while n is 1
+	uint32_t raw_var[MMA_AXES];		//Noise of the samples entering the stage
+	uint32_t out_var[MMA_AXES];		//Noise floor of the outputs, raw_var / n
+} mma_decim_stats_t;
+
+//Told the effective sample rate, in mHz, whenever it changes
+typedef void (*mma_rate_listener_t)(uint32_t rate_mhz);
+
+//Full-scale range (XYZ_DATA_CFG FS), the sensitivity halves with every step
+typedef enum
+{
+	MMA_RANGE_2G = 0,
+	MMA_RANGE_4G,
+	MMA_RANGE_8G,
+	MMA_RANGE_COUNT
+} mma_range_t;
+
+//One acceleration sample: the axes in 14-bit counts of its full-scale range, the STATUS
+//register read with them and the timebase tick of the sample (data-ready edge, reconstructed
+//from the ODR for FIFO blocks, time of the read when polled). Ordered for natural alignment, no
+//padding between the fields
+typedef struct
+{
+	uint32_t timestamp;
+	int16_t x;
+	int16_t y;
+	int16_t z;
+	uint8_t status;
+	uint8_t range;					//mma_range_t, MMA_RANGE_COUNTS_PER_G gives the sensitivity
+} mma_sample_t;
+
+//Receives every block drained from the FIFO, oldest sample first
+typedef void (*mma_block_handler_t)(const mma_sample_t *samples, uint8_t count);
+
 /*
  * @Name		init_MMA
  * @Description	Initializes the MMA with 800 Hz as the Output data rate and the sets the accelerometer
  * 				device in active mode. The device is set in normal mode and function returns 1 on
- * 				successful ACKing by the device
+ * 				successful ACKing by the device. The register shadow is loaded from the device first
+ * 				and the data-ready interrupt on INT1 is enabled (see mma_int_enable)
  *
  * @parameters	none
  *
@@ -21,16 +282,485 @@ int init_MMA();
 
 /*
  * @Name		compute_angle
- * @Description	Function reads the real-time samples stored in the accelerometer register and converts
- * 				them to valid 14-bit output values and based on the axis locations, the quadrant is
- * 				evaluated. The resultant radian value is converted to angles in degrees and returned.
- *
+ * @Description	Function acquires the next sample of the accelerometer (see
+ * 				mma_acquire_decimated) and converts it to the roll angle of the board with angle_roll
  *
  * @parameters	none
  *
- * @Returns		int- current orientation of the device( angles in degree)
+ * @Returns		int- current orientation of the device( angles in degree), MMA_ANGLE_INVALID
+ * 				if the sample could not be acquired
  */
 int compute_angle();
 
+/*
+ * @Name		compute_angle_cdeg
+ * @Description	Same as compute_angle at the full resolution of the integer conversion
+ *
+ * @parameters	int32_t* - receives the roll angle of the board in centi-degrees, untouched on
+ * 				failure
+ *
+ * @Returns		i2c_status_t - result of mma_acquire_decimated
+ */
+i2c_status_t compute_angle_cdeg(int32_t *angle);
+
+/*
+ * @Name		mma_read_sample
+ * @Description	Reads STATUS and OUT_X_MSB..OUT_Z_LSB in a single 7-byte burst (4 bytes in
+ * 				fast-read mode) and fills a sample timestamped at the end of the read. With the
+ * 				FIFO on this pops the oldest sample
+ *
+ * @parameters	mma_sample_t* - receives the sample
+ * @Returns		i2c_status_t - result of the burst read
+ */
+i2c_status_t mma_read_sample(mma_sample_t *sample);
+
+/*
+ * @Name		mma_acquire
+ * @Description	Gets the next sample through the configured path: the newest sample drained from
+ * 				the FIFO, the next sample read on the data-ready interrupt (timestamped at the
+ * 				interrupt) or a polled mma_read_sample
+ *
+ * @parameters	mma_sample_t* - receives the sample
+ * @Returns		i2c_status_t - result of the bus transfers of this call. On the data-ready path,
+ * 				the error of the interrupt read or I2C_ERR_TIMEOUT when no sample arrived within
+ * 				a few sample periods
+ */
+i2c_status_t mma_acquire(mma_sample_t *sample);
+
+/*
+ * @Name		mma_acquire_decimated
+ * @Description	Gets the next output of the decimation stage: the rounded mean of the next N
+ * 				samples delivered by the configured path (see mma_decimation_config), acquired
+ * 				with mma_acquire as needed. The same as mma_acquire while N is 1
+ *
+ * @parameters	mma_sample_t* - receives the sample, the newest raw one if the block timed out
+ * @Returns		i2c_status_t - result of the bus transfers, I2C_ERR_TIMEOUT if the block did not
+ * 				complete within N + MMA_FIFO_SIZE sample periods
+ */
+i2c_status_t mma_acquire_decimated(mma_sample_t *sample);
+
+/*
+ * @Name		mma_set_rate
+ * @Description	Selects the output data rate and the oversampling mode. Both registers go
+ * 				through the shadow, so the flush puts the part in STANDBY, writes CTRL_REG1 and
+ * 				CTRL_REG2 and goes ACTIVE again. The rate listeners are called on success
+ *
+ * @parameters	mma_odr_t, mma_mods_t - output data rate and oversampling mode
+ * @Returns		i2c_status_t - result of the flush, I2C_ERR_ARG for invalid arguments
+ */
+i2c_status_t mma_set_rate(mma_odr_t odr, mma_mods_t mods);
+
+/*
+ * @Name		mma_get_rate
+ * @Description	Reports the configured output data rate and oversampling mode from the shadow.
+ * 				While auto-sleep has put the device to sleep the sleep rate applies instead
+ *
+ * @parameters	mma_odr_t*, mma_mods_t* - receive the setting, either may be NULL
+ * @Returns		uint32_t - active sample rate in mHz
+ */
+uint32_t mma_get_rate(mma_odr_t *odr, mma_mods_t *mods);
+
+/*
+ * @Name		mma_effective_rate
+ * @Description	Sample rate in effect: the sleep rate while auto-sleep has put the device to sleep,
+ * 				the active rate otherwise
+ *
+ * @parameters	none
+ * @Returns		uint32_t - sample rate in mHz
+ */
+uint32_t mma_effective_rate();
+
+/*
+ * @Name		mma_set_range
+ * @Description	Selects the full-scale range and whether the outputs are high-pass filtered
+ * 				(HPF_OUT). The samples carry their range, so the angle conversion follows.
+ * 				With HPF_OUT the gravity is filtered out and the angles lose their meaning, it
+ * 				is meant for vibration measurements. The saturation counters restart
+ *
+ * @parameters	mma_range_t, bool - range, true for high-pass filtered outputs
+ * @Returns		i2c_status_t - result of the flush, I2C_ERR_ARG for an invalid range
+ */
+i2c_status_t mma_set_range(mma_range_t range, bool hpf_out);
+
+/*
+ * @Name		mma_get_range
+ * @Description	Reports the configured full-scale range from the shadow
+ *
+ * @parameters	bool* - receives the HPF_OUT setting, may be NULL
+ * @Returns		mma_range_t - the range
+ */
+mma_range_t mma_get_range(bool *hpf_out);
+
+/*
+ * @Name		mma_saturation
+ * @Description	Copies the number of samples in which each axis was at the end of its range since
+ * 				the last range change
+ *
+ * @parameters	uint32_t* - receives MMA_AXES counts, X, Y, Z
+ * @Returns		none
+ */
+void mma_saturation(uint32_t *counts);
+
+/*
+ * @Name		mma_lowpass_config
+ * @Description	Sets the low-pass stage every sample delivered by the driver (data-ready, FIFO or
+ * 				polled acquisition) goes through before the angle conversion. The coefficient is
+ * 				derived from the rate in effect and follows its changes; a cutoff a new rate
+ * 				cannot carry turns the filter off. mma_read_sample stays unfiltered
+ *
+ * @parameters	uint8_t - first-order sections, 0 to turn the filter off, up to LOWPASS_MAX_ORDER
+ * 				uint32_t - cutoff (-3 dB) in mHz, below half the sample rate
+ * @Returns		bool - false for an invalid order or cutoff, the setting is then unchanged
+ */
+bool mma_lowpass_config(uint8_t order, uint32_t cutoff_mhz);
+
+/*
+ * @Name		mma_lowpass_get
+ * @Description	Reports the low-pass setting in effect
+ *
+ * @parameters	uint32_t* - receives the configured cutoff in mHz
+ * @Returns		uint8_t - sections in use, 0 when the filter is off
+ */
+uint8_t mma_lowpass_get(uint32_t *cutoff_mhz);
+
+/*
+ * @Name		mma_decimation_config
+ * @Description	Sets how many consecutive samples the decimation stage averages per output. Every
+ * 				sample delivered by the driver enters the stage, after the low-pass; the angle
+ * 				conversion then runs at the sample rate / N with sqrt(N) less noise
+ *
+ * @parameters	uint16_t - samples per output, 1 (off) to DECIMATE_MAX_N (256)
+ * @Returns		bool - false for an invalid N, the setting is then unchanged
+ */
+bool mma_decimation_config(uint16_t n);
+
+/*
+ * @Name		mma_decimation_stats
+ * @Description	Reports the decimation factor, the output rate and the noise floor measured on
+ * 				the stream, to pick N for a deployment. Samples are only averaged in blocks when
+ * 				N is 2 or more, so there is no noise estimate while N is 1
+ *
+ * @parameters	mma_decim_stats_t* - receives the figures
+ * @Returns		none
+ */
+void mma_decimation_stats(mma_decim_stats_t *stats);
+
+/*
+ * @Name		mma_odr_mhz
+ * @Description	Sample rate of an ODR setting
+ *
+ * @parameters	mma_odr_t - output data rate
+ * @Returns		uint32_t - sample rate in mHz (1563 for 1.5625 Hz), 0 if invalid
+ */
+uint32_t mma_odr_mhz(mma_odr_t odr);
+
+/*
+ * @Name		mma_rate_subscribe
+ * @Description	Registers a downstream stage (filter, stream) to be told the sample rate. The
+ * 				listener is called straight away with the current rate and after every change,
+ * 				including the switches between the active and sleep rates of auto-sleep
+ *
+ * @parameters	mma_rate_listener_t - the listener
+ * @Returns		bool - false if MMA_RATE_LISTENERS are registered already
+ */
+bool mma_rate_subscribe(mma_rate_listener_t listener);
+
+/*
+ * @Name		mma_set_fast_read
+ * @Description	Switches between full resolution and the 8-bit fast-read mode (CTRL_REG1 F_READ).
+ * 				In fast-read mode the auto-increment skips the LSB registers, so a sample costs
+ * 				STATUS plus 3 bytes (3 bytes per FIFO sample). The MSBs are scaled by
+ * 				MMA_FAST_READ_SCALE so samples keep the units of the 14-bit counts
+ *
+ * @parameters	bool - true for fast-read
+ * @Returns		i2c_status_t - result of the flush, or of a data-ready read that was on the bus
+ * 				and failed, in which case the mode is unchanged
+ */
+i2c_status_t mma_set_fast_read(bool enable);
+
+/*
+ * @Name		mma_fast_read
+ * @Description	Tells whether the 8-bit fast-read mode is configured
+ *
+ * @parameters	none
+ * @Returns		bool - true in fast-read mode
+ */
+bool mma_fast_read();
+
+/*
+ * @Name		mma_calibrate_zero
+ * @Description	Zero calibration at the reference pose (board level, components up, expected
+ * 				reading 0, 0, +1 g): averages MMA_CAL_SAMPLES new samples (every sample of the
+ * 				drained blocks with the FIFO on), writes the correction into OFF_X/OFF_Y/OFF_Z and
+ * 				averages again to measure the residual error. From then on the device outputs
+ * 				corrected samples with no CPU cost. A correction beyond the +/-256 mg range of the
+ * 				registers is not written and in_range is false
+ *
+ * @parameters	mma_cal_result_t* - receives the outcome
+ * @Returns		i2c_status_t - result of the bus transfers, as in the result, I2C_ERR_TIMEOUT if
+ * 				the samples stopped coming
+ */
+i2c_status_t mma_calibrate_zero(mma_cal_result_t *result);
+
+/*
+ * @Name		mma_self_test
+ * @Description	Production self-test: at 800 Hz in the +/-4 g range, averages MMA_ST_SAMPLES samples
+ * 				with the CTRL_REG2 ST actuation off and on and checks the output change of every
+ * 				axis against the datasheet, and that no axis is stuck or saturated. The settings
+ * 				and the data-ready interrupt are restored afterwards. Takes about 30 ms, the board
+ * 				must stay still meanwhile
+ *
+ * @parameters	mma_selftest_t* - receives the result
+ * @Returns		i2c_status_t - result of the bus transfers, I2C_ERR_TIMEOUT if no sample came
+ */
+i2c_status_t mma_self_test(mma_selftest_t *result);
+
+/*
+ * @Name		mma_calibrate_clear
+ * @Description	Clears OFF_X/OFF_Y/OFF_Z, the device reports uncorrected samples again
+ *
+ * @parameters	none
+ * @Returns		i2c_status_t - result of the flush
+ */
+i2c_status_t mma_calibrate_clear();
+
+/*
+ * @Name		mma_motion_config
+ * @Description	Configures the freefall/motion detector (FF_MT) and routes it to INT2. In motion
+ * 				mode the event fires when any selected axis exceeds the threshold, in freefall
+ * 				mode when all selected axes stay below it. The event is latched until read
+ *
+ * @parameters	bool - true for freefall, false for motion
+ * 				const mma_detect_cfg_t* - thresholds and axes, NULL to disable the detector
+ * @Returns		i2c_status_t - result of the flush, I2C_ERR_ARG for an invalid threshold
+ */
+i2c_status_t mma_motion_config(bool freefall, const mma_detect_cfg_t *cfg);
+
+/*
+ * @Name		mma_transient_config
+ * @Description	Configures the transient detector, motion past the threshold after the internal
+ * 				high-pass filter (so the static gravity does not count), and routes it to INT2
+ *
+ * @parameters	const mma_detect_cfg_t* - thresholds and axes, NULL to disable the detector
+ * @Returns		i2c_status_t - result of the flush, I2C_ERR_ARG for an invalid threshold
+ */
+i2c_status_t mma_transient_config(const mma_detect_cfg_t *cfg);
+
+/*
+ * @Name		mma_orientation_config
+ * @Description	Enables the portrait/landscape detector with its debounce count and routes it to
+ * 				INT2
+ *
+ * @parameters	bool, uint8_t - true to enable, samples a new orientation must hold
+ * @Returns		i2c_status_t - result of the flush
+ */
+i2c_status_t mma_orientation_config(bool enable, uint8_t debounce);
+
+/*
+ * @Name		mma_autosleep_config
+ * @Description	Enables auto-sleep: after the idle time without an event of the wake detectors
+ * 				the device drops to the sleep rate, and an event of one of them brings the active
+ * 				rate back. The wake detectors must be enabled (mma_motion_config...). Sleep and
+ * 				wake transitions are signalled on INT2, they reach the rate listeners from
+ * 				mma_acquire or mma_event_get
+ *
+ * @parameters	const mma_autosleep_cfg_t* - the setting, NULL to disable auto-sleep
+ * @Returns		i2c_status_t - result of the flush, I2C_ERR_ARG for an invalid setting
+ */
+i2c_status_t mma_autosleep_config(const mma_autosleep_cfg_t *cfg);
+
+/*
+ * @Name		mma_asleep
+ * @Description	Tells whether auto-sleep has put the device to sleep, as of the last transition
+ * 				serviced
+ *
+ * @parameters	none
+ * @Returns		bool - true while the sleep rate is in effect
+ */
+bool mma_asleep();
+
+/*
+ * @Name		mma_event_pending
+ * @Description	Tells whether INT2 has signalled detector events not read yet. The application can
+ * 				sleep (WFI) until this becomes true, PORTA_IRQHandler wakes it up
+ *
+ * @parameters	none
+ * @Returns		bool - true when mma_event_get has something to read
+ */
+bool mma_event_pending();
+
+/*
+ * @Name		mma_event_get
+ * @Description	Reads INT_SOURCE and the source registers of the detectors that fired, which also
+ * 				releases their latches and INT2, and decodes them
+ *
+ * @parameters	mma_event_t* - receives the event
+ * @Returns		bool - true if a detector event was read
+ */
+bool mma_event_get(mma_event_t *event);
+
+/*
+ * @Name		mma_fifo_config
+ * @Description	Sets the FIFO mode and watermark through the register shadow and flushes it,
+ * 				which passes through STANDBY so the mode may change freely. With the FIFO on,
+ * 				compute_angle works on the samples drained by mma_fifo_poll
+ *
+ * @parameters	mma_fifo_mode_t, uint8_t - FIFO mode and watermark (1 to MMA_FIFO_SIZE samples)
+ * @Returns		i2c_status_t - result of the flush, I2C_ERR_ARG for an invalid watermark
+ */
+i2c_status_t mma_fifo_config(mma_fifo_mode_t mode, uint8_t watermark);
+
+/*
+ * @Name		mma_fifo_set_handler
+ * @Description	Installs the processing stage that receives the drained blocks
+ *
+ * @parameters	mma_block_handler_t - called by mma_fifo_poll with every block, may be NULL
+ * @Returns		none
+ */
+void mma_fifo_set_handler(mma_block_handler_t handler);
+
+/*
+ * @Name		mma_fifo_poll
+ * @Description	Reads STATUS and, once the watermark is reached, drains every stored sample with
+ * 				a single burst read from OUT_X_MSB (the address wraps from OUT_Z_LSB back to
+ * 				OUT_X_MSB in FIFO mode) and hands the block to the handler
+ *
+ * @parameters	uint8_t* - receives the number of samples drained, 0 below the watermark
+ * @Returns		i2c_status_t - result of the bus transfers
+ */
+i2c_status_t mma_fifo_poll(uint8_t *drained);
+
+/*
+ * @Name		mma_fifo_overflows
+ * @Description	Number of polls that found the FIFO overflowed (samples lost in fill mode,
+ * 				overwritten in circular mode) since init_MMA
+ *
+ * @parameters	none
+ * @Returns		uint32_t - overflow count
+ */
+uint32_t mma_fifo_overflows();
+
+/*
+ * @Name		mma_timing_get
+ * @Description	Copies the timing statistics of the samples delivered by the data-ready interrupt
+ * 				and the FIFO since the last reset or rate change. Within a FIFO block the
+ * 				samples are one nominal period apart, the jitter shows between the blocks
+ *
+ * @parameters	sample_timing_t* - receives the statistics
+ * @Returns		none
+ */
+void mma_timing_get(sample_timing_t *copy);
+
+/*
+ * @Name		mma_timing_reset
+ * @Description	Restarts the timing statistics
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void mma_timing_reset();
+
+/*
+ * @Name		mma_int_enable
+ * @Description	Routes the data-ready interrupt (or the FIFO watermark interrupt while the FIFO
+ * 				is on) to INT1 and services it on PTA14 with PORTA_IRQHandler. Every data-ready
+ * 				edge queues exactly one STATUS+XYZ read on the transaction engine, and
+ * 				compute_angle then waits for a new sample instead of polling the bus
+ *
+ * @parameters	bool - true to enable, false to go back to polling
+ * @Returns		i2c_status_t - result of the register flush
+ */
+i2c_status_t mma_int_enable(bool enable);
+
+/*
+ * @Name		mma_int_stats
+ * @Description	Sample accounting of the data-ready interrupt since init_MMA
+ *
+ * @parameters	uint32_t*, uint32_t*, uint32_t* - receive the samples read, the reads that found
+ * 				a sample overwritten (ZYXOW, at least one sample lost) and the failed reads
+ * @Returns		none
+ */
+void mma_int_stats(uint32_t *received, uint32_t *lost, uint32_t *errors);
+
+/*
+ * @Name		mma_cache_load
+ * @Description	Fills the register shadow from the device with a single burst read of
+ * 				F_SETUP..OFF_Z and marks every shadowed register clean
+ *
+ * @parameters	none
+ * @Returns		i2c_status_t - result of the burst read
+ */
+i2c_status_t mma_cache_load();
+
+/*
+ * @Name		mma_reg_read
+ * @Description	Returns a register value. Writable control registers are served from the shadow
+ * 				without any bus traffic, all other registers are read from the device
+ *
+ * @parameters	uint8_t - register address
+ * @Returns		uint8_t - register value (shadow value if the register is pending a flush)
+ */
+uint8_t mma_reg_read(uint8_t reg);
+
+/*
+ * @Name		mma_reg_write
+ * @Description	Updates a writable control register in the shadow and marks it dirty. Nothing is
+ * 				sent until mma_flush; registers outside the shadow are written straight away
+ *
+ * @parameters	uint8_t, uint8_t - register address and new value
+ * @Returns		none
+ */
+void mma_reg_write(uint8_t reg, uint8_t value);
+
+/*
+ * @Name		mma_reg_update
+ * @Description	Read-modify-write of a shadowed register: the bits in mask are replaced by the
+ * 				same bits of value, served from the shadow without a bus round trip
+ *
+ * @parameters	uint8_t, uint8_t, uint8_t - register address, bits to change and their new value
+ * @Returns		none
+ */
+void mma_reg_update(uint8_t reg, uint8_t mask, uint8_t value);
+
+/*
+ * @Name		mma_flush
+ * @Description	Writes all dirty shadow registers to the device. Contiguous dirty registers (and
+ * 				short gaps of clean writable ones) are combined into burst writes. If anything other
+ * 				than the ACTIVE bit changes, the first burst starts at CTRL_REG1 and puts the part in
+ * 				STANDBY, the remaining bursts follow and CTRL_REG1 is written last to go ACTIVE again,
+ * 				so an ODR or range change costs two transactions
+ *
+ * @parameters	none
+ * @Returns		i2c_status_t - I2C_OK, or the error of the first failed write (the registers not
+ * 				yet written stay dirty)
+ */
+i2c_status_t mma_flush();
+
+/*
+ * @Name		mma_reg_cached
+ * @Description	Tells whether a register is held in the writable shadow
+ *
+ * @parameters	uint8_t - register address
+ * @Returns		bool - true for writable registers between F_SETUP and OFF_Z
+ */
+bool mma_reg_cached(uint8_t reg);
+
+/*
+ * @Name		mma_reg_dirty
+ * @Description	Tells whether a shadowed register has been changed but not yet flushed
+ *
+ * @parameters	uint8_t - register address
+ * @Returns		bool - true if the register is pending a flush
+ */
+bool mma_reg_dirty(uint8_t reg);
+
+/*
+ * @Name		mma_reg_name
+ * @Description	Name of a shadowed register as in the datasheet, for the CLI
+ *
+ * @parameters	uint8_t - register address
+ * @Returns		const char* - register name, or NULL if the register is not shadowed
+ */
+const char *mma_reg_name(uint8_t reg);
 
 #endif
@@ -0,0 +1,82 @@
+/**
+ * @file    sample_timing.c
+ * @brief   Jitter, gap and drift statistics of a timestamped sample stream
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Date	05/19/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "sample_timing.h"
+
+//MACROS
+#define PPM (1000000)
+
+/*
+ * See documentation in .h file
+ */
+void sample_timing_reset(sample_timing_t *timing, uint32_t period)
+{
+	*timing = (sample_timing_t){.period = period};
+}
+
+/*
+ * See documentation in .h file
+ */
+void sample_timing_add(sample_timing_t *timing, uint32_t timestamp)
+{
+	uint32_t interval, periods;
+	int32_t deviation;
+
+	if(!timing->started || timing->period == 0)
+	{
+		timing->started = true;
+		timing->last = timestamp;
+		return;
+	}
+
+	interval = timestamp - timing->last;
+	timing->last = timestamp;
+	timing->intervals++;
+	timing->elapsed += interval;
+
+	if((uint64_t)interval * SAMPLE_TIMING_GAP_DEN > (uint64_t)timing->period * SAMPLE_TIMING_GAP_NUM)
+	{
+		//Periods spanned by the gap, rounded
+		periods = (interval + timing->period / 2) / timing->period;
+		timing->gaps++;
+		timing->missing += periods - 1;
+		return;
+	}
+
+	deviation = (int32_t)(interval - timing->period);
+	if(timing->intervals == timing->gaps + 1 || deviation < timing->jitter_min)
+		timing->jitter_min = deviation;
+	if(timing->intervals == timing->gaps + 1 || deviation > timing->jitter_max)
+		timing->jitter_max = deviation;
+	timing->jitter_abs += (deviation < 0) ? -deviation : deviation;
+}
+
+/*
+ * See documentation in .h file
+ */
+int32_t sample_timing_drift_ppm(const sample_timing_t *timing)
+{
+	uint64_t nominal = (uint64_t)(timing->intervals + timing->missing) * timing->period;
+
+	if(nominal == 0)
+		return 0;
+	return (int32_t)(((int64_t)timing->elapsed - (int64_t)nominal) * PPM / (int64_t)nominal);
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t sample_timing_jitter_mean(const sample_timing_t *timing)
+{
+	uint32_t regular = timing->intervals - timing->gaps;
+
+	return regular ? (uint32_t)(timing->jitter_abs / regular) : 0;
+}
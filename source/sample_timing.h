@@ -0,0 +1,84 @@
+/*
+ * sample_timing.h
+ *
+ * Created on: 19-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef SAMPLE_TIMING_H_
+#define SAMPLE_TIMING_H_
+
+/*
+ * Timing statistics of a stream of timestamped samples against its nominal period: inter-sample
+ * jitter, gaps (samples missing from the stream) and the drift of the sample clock against the
+ * timebase. Timestamps and periods are in timebase ticks. The functions only compute, so the
+ * accumulator builds on a Linux host as well.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+
+//MACROS
+#define SAMPLE_TIMING_GAP_NUM (3)		//An interval over 3/2 of the period is a gap
+#define SAMPLE_TIMING_GAP_DEN (2)
+
+/* public types*/
+
+//Accumulated timing of a sample stream
+typedef struct
+{
+	uint32_t period;				//Nominal sample period in ticks, 0 while unknown
+	bool started;					//The first sample has been seen
+	uint32_t last;					//Timestamp of the latest sample
+	uint32_t intervals;				//Intervals measured between consecutive samples
+	uint64_t elapsed;				//Sum of the intervals, ticks
+	int32_t jitter_min;				//Smallest and largest interval minus the period, ticks
+	int32_t jitter_max;
+	uint64_t jitter_abs;			//Sum of the absolute deviations, ticks
+	uint32_t gaps;					//Intervals of more than 3/2 of the period
+	uint32_t missing;				//Samples estimated missing in those gaps
+} sample_timing_t;
+
+/*
+ * @Name		sample_timing_reset
+ * @Description	Clears the statistics and sets the nominal period they are measured against
+ *
+ * @parameters	sample_timing_t* - the accumulator
+ * 				uint32_t - nominal sample period in ticks
+ * @Returns		none
+ */
+void sample_timing_reset(sample_timing_t *timing, uint32_t period);
+
+/*
+ * @Name		sample_timing_add
+ * @Description	Accounts the interval from the previous sample. A gap counts the samples that
+ * 				should have come in between, the jitter is taken on the non-gap intervals only
+ *
+ * @parameters	sample_timing_t* - the accumulator
+ * 				uint32_t - timestamp of the sample
+ * @Returns		none
+ */
+void sample_timing_add(sample_timing_t *timing, uint32_t timestamp);
+
+/*
+ * @Name		sample_timing_drift_ppm
+ * @Description	Drift of the sample clock: the measured time minus the nominal time of the samples
+ * 				seen (including the missing ones), relative to the nominal time. Positive when the
+ * 				samples come slower than the nominal rate
+ *
+ * @parameters	const sample_timing_t* - the accumulator
+ * @Returns		int32_t - drift in parts per million, 0 before two samples
+ */
+int32_t sample_timing_drift_ppm(const sample_timing_t *timing);
+
+/*
+ * @Name		sample_timing_jitter_mean
+ * @Description	Mean absolute deviation of the intervals from the period
+ *
+ * @parameters	const sample_timing_t* - the accumulator
+ * @Returns		uint32_t - mean deviation in ticks
+ */
+uint32_t sample_timing_jitter_mean(const sample_timing_t *timing);
+
+#endif /* SAMPLE_TIMING_H_ */
@@ -0,0 +1,70 @@
+/**
+ * @file    selftest.c
+ * @brief   Pass/fail evaluation of the accelerometer self-test samples
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Date	05/20/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include <stdbool.h>
+#include "selftest.h"
+
+//MACROS
+#define AXES (3)
+
+//Typical self-test output change of every axis
+static const int16_t typical_delta[AXES] = {SELFTEST_DELTA_X, SELFTEST_DELTA_Y, SELFTEST_DELTA_Z};
+
+/*
+ * @Name		axis_value
+ * @Description	Reads one axis of a sample
+ *
+ * @parameters	const mma_sample_t*, int - the sample, axis 0 to 2 for X, Y, Z
+ * @Returns		int16_t - the axis in counts
+ */
+static int16_t axis_value(const mma_sample_t *sample, int axis)
+{
+	return (axis == 0) ? sample->x : (axis == 1) ? sample->y : sample->z;
+}
+
+/*
+ * See documentation in .h file
+ */
+void selftest_evaluate(const mma_sample_t *off, const mma_sample_t *on, uint8_t count,
+		mma_selftest_t *result)
+{
+	int32_t sum_off, sum_on, min, max;
+	int16_t value, first;
+	bool stuck, saturated;
+
+	result->pass = (result->status == I2C_OK) && count;
+	for(int axis = 0; axis < AXES && count; axis++)
+	{
+		sum_off = sum_on = 0;
+		first = axis_value(&off[0], axis);
+		stuck = true;
+		saturated = false;
+		for(uint8_t i = 0; i < count; i++)
+		{
+			value = axis_value(&off[i], axis);
+			sum_off += value;
+			stuck &= (value == first);
+			saturated |= (value >= SELFTEST_COUNTS_MAX || value <= SELFTEST_COUNTS_MIN);
+
+			value = axis_value(&on[i], axis);
+			sum_on += value;
+			stuck &= (value == first);
+			saturated |= (value >= SELFTEST_COUNTS_MAX || value <= SELFTEST_COUNTS_MIN);
+		}
+
+		min = typical_delta[axis] * SELFTEST_MIN_NUM / SELFTEST_MIN_DEN;
+		max = typical_delta[axis] * SELFTEST_MAX_FACTOR;
+		result->delta[axis] = (sum_on - sum_off) / count;
+		result->delta_ok[axis] = result->delta[axis] >= min && result->delta[axis] <= max;
+		result->stuck[axis] = stuck;
+		result->saturated[axis] = saturated;
+		result->pass &= result->delta_ok[axis] && !stuck && !saturated;
+	}
+}
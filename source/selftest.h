@@ -0,0 +1,49 @@
+/*
+ * selftest.h
+ *
+ * Created on: 20-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef SELFTEST_H_
+#define SELFTEST_H_
+
+/*
+ * Pass/fail evaluation of the MMA8451 self-test. The samples are taken by mma_self_test in the
+ * +/-4 g range with the self-test actuation off and then on; the functions here only compute on
+ * them and touch no hardware, so the limits can be checked against simulated samples on a
+ * Linux host as well.
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include "mma8451.h"
+
+//MACROS
+//Typical self-test output change in the +/-4 g range, 14-bit counts (datasheet table 4). The
+//accepted window is half to twice the typical change
+#define SELFTEST_DELTA_X (181)
+#define SELFTEST_DELTA_Y (255)
+#define SELFTEST_DELTA_Z (1680)
+#define SELFTEST_MIN_NUM (1)
+#define SELFTEST_MIN_DEN (2)
+#define SELFTEST_MAX_FACTOR (2)
+#define SELFTEST_COUNTS_MAX (8191)		//Saturated 14-bit output
+#define SELFTEST_COUNTS_MIN (-8192)
+
+/*
+ * @Name		selftest_evaluate
+ * @Description	Fills in the per-axis deltas and verdicts of a self-test result: the mean output
+ * 				change must be within the window around the typical change, no axis may repeat
+ * 				the same value in every sample (stuck) or reach the end of the range (saturated)
+ *
+ * @parameters	const mma_sample_t* - samples with the self-test off
+ * 				const mma_sample_t* - samples with the self-test on
+ * 				uint8_t - number of samples in each array
+ * 				mma_selftest_t* - result, its status field is kept
+ * @Returns		none
+ */
+void selftest_evaluate(const mma_sample_t *off, const mma_sample_t *on, uint8_t count,
+		mma_selftest_t *result);
+
+#endif /* SELFTEST_H_ */
@@ -7,9 +7,19 @@
 
 #include "test_mma.h"
 #include "i2c.h"
+#include "mma8451.h"
+#include "timebase.h"
+#include "angle.h"
+#include "sample_timing.h"
+#include "selftest.h"
+#include "lowpass.h"
+#include "decimate.h"
+#include <stdlib.h>
+#include <math.h>
 #include "MKL25Z4.h"
 #include <assert.h>
 #include <stdio.h>
+#include <stdbool.h>
 #define NO_ACK_RXD 1
 #define ACK_RXD 0
 #define INCOMP 0
@@ -20,9 +30,292 @@
 #define SLAVE_ACK I2C0->S & I2C_S_RXAK_MASK
 #define REG_WHOAMI 0x0D
 #define DEV_ID 0x1A
+#define TIMING_PERIOD 15000U		//800 Hz in 12 MHz timebase ticks
+#define ST_ONE_G 2048				//Counts per g in the +/-4 g range of the self-test
+#define LPF_RATE_MHZ 800000U
+#define LPF_CUTOFF_MHZ 10000U
+#define LPF_STEP_SAMPLES 200		//Step response length, well past 2 time constants
+#define LPF_SETTLE_SAMPLES 1000		//The cascade has converged to the count
+#define LPF_TOL 1					//Counts, rounding of the fixed-point stage
+#define DEC_N 8
+#define DEC_BLOCKS 4
+#define DEC_STEP 4					//X alternates between 0 and this, variance 32/7 counts^2
+#define TEST_BUS_HZ 12000000U
+#define SWEEP_START_HZ 10000U
+#define SWEEP_STEP_HZ 10000U
+#define SWEEP_END_HZ 1000000U
+#define ONE_G 4096
+#define G_45DEG 2896				//1 g * cos(45 degrees) in counts
+#define ANGLE_TOL 1					//Degrees, the conversion truncates
+#define CDEG_TOL 1					//Centi-degrees, rounding of the integer conversion
+#define ATAN_SWEEP_STEP 15			//Degrees between the points checked against libm
+#define TEST_WATERMARK 4
+#define FIFO_TIMEOUT_US 50000U		//Far longer than 4 samples at any ODR down to 100 Hz
+
+//Counts of test_accelerometer, the checks of the hardware free modules add to them
+static int g_total_test,g_total_test_pass;
+
+#define test_check(value) {                                             \
+  g_total_test++;                                                       \
+  if (value) {                                                          \
+    g_total_test_pass++;                                                \
+  } else {                                                              \
+    printf("ERROR at %d\n\r", __LINE__);                                \
+  }                                                                     \
+}
+
+/*
+ * @Name		test_i2c_divider
+ * @Description	Checks the SCL divider selection against known table entries and verifies over a
+ * 				sweep of targets that the achieved rate never exceeds the target
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_i2c_divider()
+{
+	i2c_divider_t div;
+	bool sweep_ok=true;
+
+	//400 kHz is divider 30 (ICR 0x05) with no multiplier
+	div=i2c_divider_select(TEST_BUS_HZ,400000U);
+	test_check(div.mult==0 && div.icr==0x05 && div.scl_hz==400000U && div.error_ppm==0);
+
+	//100 kHz needs the x4 multiplier to hit divider 120 exactly
+	div=i2c_divider_select(TEST_BUS_HZ,100000U);
+	test_check(div.scl_hz==100000U && div.error_ppm==0);
+
+	//Faster than the fastest setting clamps to divider 20 and reports a negative error
+	div=i2c_divider_select(TEST_BUS_HZ,1000000U);
+	test_check(div.mult==0 && div.icr==0 && div.scl_hz==600000U && div.error_ppm<0);
+
+	for(uint32_t target=SWEEP_START_HZ; target<=SWEEP_END_HZ; target+=SWEEP_STEP_HZ)
+	{
+		div=i2c_divider_select(TEST_BUS_HZ,target);
+		if(div.scl_hz>target || div.error_ppm>0)
+			sweep_ok=false;
+	}
+	test_check(sweep_ok);
+}
+
+/*
+ * @Name		test_angle
+ * @Description	Checks the sample to angle conversion on synthetic samples: flat, on the long edge,
+ * 				pitched by 45 degrees and upside down
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_angle()
+{
+	mma_sample_t flat={.z=ONE_G}, edge={.y=ONE_G}, pitched={.x=-G_45DEG, .z=G_45DEG},
+			upside_down={.z=-ONE_G};
+	bool sweep_ok=true;
+
+	test_check(angle_roll(&flat)==0 && angle_pitch(&flat)==0 && angle_inclination(&flat)==0);
+
+	test_check(abs(angle_roll(&edge)-90)<=ANGLE_TOL && abs(angle_inclination(&edge)-90)<=ANGLE_TOL);
+
+	//Pitch does not leak into the roll
+	test_check(abs(angle_pitch(&pitched)-45)<=ANGLE_TOL && angle_roll(&pitched)==0);
+
+	test_check(abs(angle_roll(&upside_down)-180)<=ANGLE_TOL && abs(angle_inclination(&upside_down)-180)<=ANGLE_TOL);
+
+	//Centi-degree outputs, 45 degrees pitch comes from equal X and Z
+	test_check(angle_roll_cdeg(&edge)==9000 && abs(angle_pitch_cdeg(&pitched)-4500)<=CDEG_TOL &&
+			angle_inclination_cdeg(&upside_down)==18000 && angle_inclination_cdeg(&flat)==0);
+
+	//CORDIC kernel against libm around the circle, the seam at +/-180 wraps
+	for(int deg=-180;deg<180;deg+=ATAN_SWEEP_STEP)
+	{
+		double rad=deg*M_PI/180;
+		int16_t y=lround(ONE_G*sin(rad)),x=lround(ONE_G*cos(rad));
+		int32_t error=labs(angle_atan2_q(y,x)-lround(atan2(y,x)*180/M_PI*ANGLE_Q_ONE));
+		if(error>180*ANGLE_Q_ONE)
+			error=360*ANGLE_Q_ONE-error;
+		if(error>ANGLE_ATAN2_MAX_ERR_Q)
+			sweep_ok=false;
+	}
+	test_check(sweep_ok);
+}
+
+/*
+ * @Name		test_sample_timing
+ * @Description	Checks the timing statistics on a synthetic stream: regular samples with a one
+ * 				tick jitter, then a gap of two samples, then samples 200 ppm slow
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_sample_timing()
+{
+	sample_timing_t timing;
+	uint32_t t=0;
+
+	sample_timing_reset(&timing,TIMING_PERIOD);
+	for(int i=0;i<11;i++)
+	{
+		sample_timing_add(&timing,t+(i&1));
+		t+=TIMING_PERIOD;
+	}
+	test_check(timing.intervals==10 && timing.jitter_min==-1 && timing.jitter_max==1 && timing.gaps==0 &&
+			sample_timing_drift_ppm(&timing)==0);
+
+	//Two samples missing: one interval of three periods
+	sample_timing_reset(&timing,TIMING_PERIOD);
+	sample_timing_add(&timing,0);
+	sample_timing_add(&timing,3*TIMING_PERIOD);
+	test_check(timing.gaps==1 && timing.missing==2 && sample_timing_drift_ppm(&timing)==0);
+
+	//Timestamps wrapping around, sample clock 200 ppm slow (3 ticks a period)
+	sample_timing_reset(&timing,TIMING_PERIOD);
+	t=UINT32_MAX-TIMING_PERIOD;
+	for(int i=0;i<10;i++)
+	{
+		sample_timing_add(&timing,t);
+		t+=TIMING_PERIOD+3;
+	}
+	test_check(sample_timing_drift_ppm(&timing)==200 && timing.gaps==0);
+}
+
+/*
+ * @Name		test_selftest
+ * @Description	Checks the self-test verdicts on a simulated sensor: a healthy one lying flat, one
+ * 				with a stuck Y axis and one whose Z output is saturated
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_selftest()
+{
+	mma_sample_t off[MMA_ST_SAMPLES], on[MMA_ST_SAMPLES];
+	mma_selftest_t result;
+
+	//Flat in the 4 g range with a little noise, the actuation adds the typical change
+	for(int i=0;i<MMA_ST_SAMPLES;i++)
+	{
+		off[i]=(mma_sample_t){.x=i&1, .y=-(i&1), .z=ST_ONE_G+(i&3)};
+		on[i]=(mma_sample_t){.x=off[i].x+SELFTEST_DELTA_X, .y=off[i].y+SELFTEST_DELTA_Y,
+				.z=off[i].z+SELFTEST_DELTA_Z};
+	}
+	result=(mma_selftest_t){.status=I2C_OK};
+	selftest_evaluate(off,on,MMA_ST_SAMPLES,&result);
+	test_check(result.pass && result.delta[0]==SELFTEST_DELTA_X && result.delta[2]==SELFTEST_DELTA_Z);
+
+	for(int i=0;i<MMA_ST_SAMPLES;i++)
+		off[i].y=on[i].y=0;
+	result=(mma_selftest_t){.status=I2C_OK};
+	selftest_evaluate(off,on,MMA_ST_SAMPLES,&result);
+	test_check(!result.pass && result.stuck[1] && !result.delta_ok[1] && !result.stuck[0]);
+
+	for(int i=0;i<MMA_ST_SAMPLES;i++)
+	{
+		off[i].y=-(i&1);
+		on[i].y=off[i].y+SELFTEST_DELTA_Y;
+		on[i].z=SELFTEST_COUNTS_MAX;
+	}
+	result=(mma_selftest_t){.status=I2C_OK};
+	selftest_evaluate(off,on,MMA_ST_SAMPLES,&result);
+	test_check(!result.pass && result.saturated[2] && !result.saturated[0] && !result.stuck[1]);
+}
+
+/*
+ * @Name		test_lowpass
+ * @Description	Checks the fixed-point low-pass stage: its coefficient, the step response of one
+ * 				section against a floating point reference with the same coefficient, the DC gain
+ * 				of the cascade and the rejection of invalid settings
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_lowpass()
+{
+	lowpass_t filter;
+	mma_sample_t sample;
+	double w=2*M_PI*LPF_CUTOFF_MHZ/LPF_RATE_MHZ, alpha, reference=0;
+	bool step_ok=true;
+
+	test_check(labs(lowpass_alpha(LPF_CUTOFF_MHZ,LPF_RATE_MHZ)-lround(w/(1+w)*32768))<=1);
+
+	//Step of 1 g on Z from a primed zero, opposite steps on X and Y
+	lowpass_config(&filter,1,LPF_CUTOFF_MHZ,LPF_RATE_MHZ);
+	alpha=filter.alpha/32768.0;
+	sample=(mma_sample_t){0};
+	lowpass_apply(&filter,&sample);
+	for(int i=0;i<LPF_STEP_SAMPLES;i++)
+	{
+		sample=(mma_sample_t){.x=-ONE_G, .y=ONE_G, .z=ONE_G};
+		lowpass_apply(&filter,&sample);
+		reference+=alpha*(ONE_G-reference);
+		if(labs(sample.z-lround(reference))>LPF_TOL || sample.x!=-sample.z || sample.y!=sample.z)
+			step_ok=false;
+	}
+	test_check(step_ok);
+
+	lowpass_config(&filter,LOWPASS_MAX_ORDER,LPF_CUTOFF_MHZ,LPF_RATE_MHZ);
+	sample=(mma_sample_t){0};
+	lowpass_apply(&filter,&sample);
+	for(int i=0;i<LPF_SETTLE_SAMPLES;i++)
+	{
+		sample=(mma_sample_t){.x=G_45DEG, .y=-G_45DEG, .z=-ONE_G};
+		lowpass_apply(&filter,&sample);
+	}
+	test_check(sample.x==G_45DEG && sample.y==-G_45DEG && sample.z==-ONE_G);
+
+	test_check(!lowpass_config(&filter,1,LPF_RATE_MHZ/2,LPF_RATE_MHZ) &&
+			!lowpass_config(&filter,LOWPASS_MAX_ORDER+1,LPF_CUTOFF_MHZ,LPF_RATE_MHZ) &&
+			lowpass_config(&filter,0,0,LPF_RATE_MHZ));
+}
+
+/*
+ * @Name		test_decimate
+ * @Description	Checks the decimator: rounding of the block means, one output per block, the noise
+ * 				estimate on a known pattern and the rejection of invalid factors
+ *
+ * @parameters	None
+ * @Returns		None
+ */
+static void test_decimate()
+{
+	decimator_t dec;
+	mma_sample_t sample;
+	int outputs=0;
+
+	//Means of 1.5, -1.5 and 0.25 round to 2, -2 and 0
+	decimator_config(&dec,4);
+	for(int i=0;i<4;i++)
+	{
+		sample=(mma_sample_t){.x=1+(i&1), .y=-1-(i&1), .z=(i==3), .timestamp=i};
+		outputs+=decimator_push(&dec,&sample);
+	}
+	test_check(outputs==1 && dec.out.x==2 && dec.out.y==-2 && dec.out.z==0 && dec.out.timestamp==3);
+
+	outputs=0;
+	decimator_config(&dec,DEC_N);
+	for(int i=0;i<DEC_N*DEC_BLOCKS;i++)
+	{
+		sample=(mma_sample_t){.x=(i&1)*DEC_STEP, .y=ONE_G, .z=-ONE_G};
+		outputs+=decimator_push(&dec,&sample);
+	}
+	test_check(outputs==DEC_BLOCKS && dec.blocks==DEC_BLOCKS && dec.out.x==DEC_STEP/2 &&
+			decimator_variance(&dec,0)==(32<<DECIMATE_VAR_Q)/7 && decimator_variance(&dec,1)==0 &&
+			decimator_variance(&dec,2)==0);
+
+	test_check(!decimator_config(&dec,0) && !decimator_config(&dec,DECIMATE_MAX_N+1) && decimator_config(&dec,1) &&
+			decimator_push(&dec,&sample) && decimator_variance(&dec,0)==0);
+}
+
 void test_accelerometer()
 {
-	int g_total_test=0,g_total_test_pass=0;
+	g_total_test=0;
+	g_total_test_pass=0;
+
+	test_i2c_divider();
+	test_angle();
+	test_sample_timing();
+	test_selftest();
+	test_lowpass();
+	test_decimate();
 //	g_total_test++;
 //		i2c_start_seq();
 //		if(i2c_rxByte(0x00 ,REG_WHOAMI)==0xFF)
@@ -34,6 +327,25 @@ void test_accelerometer()
 		g_total_test_pass++;
 	for(int i=0;i<4;i++);
 
+	//Same register read through the interrupt driven engine, the CPU only waits for the flag
+	uint8_t who_am_i=0;
+	i2c_xfer_t xfer={.dev_addr=MMA_ADDR, .reg=REG_WHOAMI, .dir=I2C_READ, .buf=&who_am_i, .len=1};
+	g_total_test++;
+	if(i2c_submit(&xfer))
+	{
+		if(i2c_wait(&xfer)==I2C_OK && who_am_i==DEV_ID)
+			g_total_test_pass++;
+	}
+
+	//A slave that is not on the bus must end with a NACK instead of hanging the engine
+	xfer.dev_addr=DUMMY_ADDR;
+	g_total_test++;
+	if(i2c_submit(&xfer))
+	{
+		if(i2c_wait(&xfer)==I2C_ERR_NACK)
+			g_total_test_pass++;
+	}
+
 //	g_total_test++;
 //	i2c_start_seq();
 //	I2C0->D = MMA_ADDR;
@@ -55,3 +367,31 @@ void test_accelerometer()
 	printf("Accelerometer Implementation : passed %d/%d test cases\n\r",g_total_test_pass,g_total_test);
 }
 
+
+void test_mma_fifo()
+{
+	int total=0,passed=0;
+	uint8_t drained=0;
+	uint32_t start;
+
+	//Fill mode with a small watermark: the first block must hold at least the watermark
+	total++;
+	if(mma_fifo_config(MMA_FIFO_FILL,TEST_WATERMARK)==I2C_OK)
+	{
+		start=timebase_now();
+		while(drained==0 && timebase_now()-start<TIMEBASE_US(FIFO_TIMEOUT_US))
+			mma_fifo_poll(&drained);
+		if(drained>=TEST_WATERMARK && drained<=MMA_FIFO_SIZE)
+			passed++;
+	}
+
+	//An invalid watermark is refused and switching the FIFO off is accepted
+	total++;
+	if(mma_fifo_config(MMA_FIFO_CIRCULAR,MMA_FIFO_SIZE+1)==I2C_ERR_ARG)
+		passed++;
+	total++;
+	if(mma_fifo_config(MMA_FIFO_OFF,0)==I2C_OK)
+		passed++;
+
+	printf("MMA8451 FIFO : passed %d/%d test cases\n\r",passed,total);
+}
@@ -9,5 +9,6 @@
 #define TEST_MMA_H_
 
 void test_accelerometer();
+void test_mma_fifo();
 
 #endif /* TEST_MMA_H_ */
@@ -0,0 +1,41 @@
+/**
+ * @file    timebase.c
+ * @brief   Free running hardware timebase on PIT channel 0, used to timestamp samples and
+ * 			measure bus and CPU time of the drivers
+ *
+ * @author	Venkat Sai Krishna Tata
+ * @Date	05/10/2021
+ */
+
+//INCLUDES
+#include <stdint.h>
+#include "MKL25Z4.h"
+#include "timebase.h"
+
+//MACROS
+#define TIMEBASE_CH (0)
+#define FULL_RANGE (0xFFFFFFFFU)
+
+/*
+ * See documentation in .h file
+ */
+void init_timebase()
+{
+	//Clock gating to the PIT and enable the module, timers keep running in debug mode
+	SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+	PIT->MCR = 0;
+
+	//Load the full 32-bit range and start the channel without interrupts
+	PIT->CHANNEL[TIMEBASE_CH].TCTRL = 0;
+	PIT->CHANNEL[TIMEBASE_CH].LDVAL = FULL_RANGE;
+	PIT->CHANNEL[TIMEBASE_CH].TCTRL = PIT_TCTRL_TEN_MASK;
+}
+
+/*
+ * See documentation in .h file
+ */
+uint32_t timebase_now()
+{
+	//The PIT counts down from the load value, invert it to get an up-counting time
+	return ~PIT->CHANNEL[TIMEBASE_CH].CVAL;
+}
@@ -0,0 +1,39 @@
+/*
+ * timebase.h
+ *
+ * Created on: 10-May-2021
+ * Author: Venkat Sai Krishna Tata
+ */
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+//INCLUDES
+#include <stdint.h>
+
+//MACROS
+#define TIMEBASE_HZ (12000000U)			//PIT runs from the bus clock (24 MHz core / OUTDIV4 of 2)
+#define TIMEBASE_CYCLES_PER_TICK (2)	//Core clock cycles per timebase tick
+#define TIMEBASE_US(us) ((us) * (TIMEBASE_HZ / 1000000U))	//Microseconds to timebase ticks
+
+/*
+ * @Name		init_timebase
+ * @Description	Starts PIT channel 0 as a free running 32-bit counter clocked from the bus clock.
+ * 				The channel reloads with the full range so differences of two timebase_now()
+ * 				readings stay valid across the wrap (about every 358 seconds)
+ *
+ * @parameters	none
+ * @Returns		none
+ */
+void init_timebase();
+
+/*
+ * @Name		timebase_now
+ * @Description	Reads the free running counter as an up-counting value in timebase ticks
+ *
+ * @parameters	none
+ * @Returns		uint32_t - current time in ticks of 1/TIMEBASE_HZ seconds
+ */
+uint32_t timebase_now();
+
+#endif /* TIMEBASE_H_ */